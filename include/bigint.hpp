@@ -0,0 +1,118 @@
+#pragma once
+
+#include "prelude.hpp"
+
+namespace ysh::types {
+
+/**
+ * @brief The arbitrary-precision integer type in ysh.
+ * The magnitude is stored as little-endian 32-bit limbs without leading zeros (zero has no limbs), so
+ * every value has exactly one representation. Division truncates toward zero, like int_t's.
+ * Entities only hold a bigint_t when the value doesn't fit in an int_t: Int operations that overflow
+ * are redone on bigint_t, and bigint_t results that fit are turned back into int_t.
+ */
+class bigint_t {
+public:
+    using limb_type = std::uint32_t;
+    using wide_type = std::uint64_t;
+    using magnitude_type = std::vector<limb_type>;
+
+    bigint_t() noexcept = default;
+
+    explicit bigint_t(long long value);
+
+    /**
+     * @brief Parse an optionally signed integer literal.
+     *
+     * @param digits The digits, in the given base (2 to 36). Letters are case-insensitive.
+     * @param base The radix.
+     * @return bigint_t
+     * @throws std::invalid_argument if there are no digits or an invalid one.
+     */
+    static bigint_t parse(std::string_view digits, int base = 10);
+
+    /**
+     * @brief Build a value from its magnitude, as returned by @ref limbs, and its sign. Leading zero
+     * limbs are dropped.
+     */
+    static bigint_t from_limbs(magnitude_type limbs, bool negative) {
+        return bigint_t(std::move(limbs), negative);
+    }
+
+    /**
+     * @brief Raise to a power by repeated squaring.
+     */
+    static bigint_t pow(bigint_t base, std::uint64_t exp);
+
+    /**
+     * @brief The truncated quotient and the remainder (which takes the sign of the dividend).
+     * @pre not rhs.zero()
+     */
+    static std::pair<bigint_t, bigint_t> divmod(bigint_t const& lhs, bigint_t const& rhs);
+
+    /**
+     * @brief Whether the value is representable as a long long.
+     */
+    [[nodiscard]]
+    bool fits() const noexcept;
+
+    [[nodiscard]]
+    bool negative() const noexcept {
+        return m_negative;
+    }
+
+    [[nodiscard]]
+    bool zero() const noexcept {
+        return m_limbs.empty();
+    }
+
+    [[nodiscard]]
+    magnitude_type const& limbs() const noexcept {
+        return m_limbs;
+    }
+
+    [[nodiscard]]
+    std::string to_string() const;
+
+    /**
+     * @brief Convert to a long long. The value wraps around if it doesn't fit.
+     */
+    explicit operator long long() const noexcept;
+
+    explicit operator long double() const noexcept;
+
+    explicit operator bool() const noexcept {
+        return not zero();
+    }
+
+    bigint_t operator -() const;
+
+    friend bigint_t operator +(bigint_t const& lhs, bigint_t const& rhs);
+
+    friend bigint_t operator -(bigint_t const& lhs, bigint_t const& rhs);
+
+    friend bigint_t operator *(bigint_t const& lhs, bigint_t const& rhs);
+
+    friend bigint_t operator /(bigint_t const& lhs, bigint_t const& rhs);
+
+    friend bigint_t operator %(bigint_t const& lhs, bigint_t const& rhs);
+
+    friend bigint_t operator <<(bigint_t const& lhs, std::size_t shift);
+
+    /**
+     * @brief Arithmetic right shift, i.e. division by a power of two rounding toward negative infinity.
+     */
+    friend bigint_t operator >>(bigint_t const& lhs, std::size_t shift);
+
+    friend bool operator ==(bigint_t const& lhs, bigint_t const& rhs) noexcept = default;
+
+    friend std::strong_ordering operator <=>(bigint_t const& lhs, bigint_t const& rhs) noexcept;
+
+private:
+    bigint_t(magnitude_type limbs, bool negative) noexcept;
+
+    magnitude_type m_limbs;
+    bool m_negative = false;
+};
+
+} // namespace ysh::types
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ysh.hpp"
+
+namespace ysh {
+
+/**
+ * @brief The built-in functions visible to every script, such as map, filter and take. They are
+ * looked up after the user's variables, so a script may shadow them. Functions taking more than one
+ * argument take a tuple, e.g.
+ * @code map $ (f, 1..1000000) @endcode
+ * Given a Seq, map, filter and take return a Seq without generating any element; given a List, they
+ * return a List. Chained on a Seq, they run as one fused loop (see seq_t); seq makes a Seq of a List
+ * for that, and count counts the elements. dict, keys, values, has and group build and inspect Dicts;
+ * a Dict is also applied to a key to look it up, e.g.
+ * @code (dict $ pairs) $ key @endcode
+ * unique drops duplicate elements, comparing them by hash. sort, sum, min and max work on Lists
+ * and Seqs; on large Lists they run on the thread pool (see parallel.hpp), and so do map and filter
+ * when given a built-in without side effects, e.g. sum. Any other Func may have some (say, send), so
+ * they call it in order on the calling thread.
+ * chan makes a Chan, which send, recv and close work on, and whose values seq receives as a Seq (see
+ * chan_t). await waits for the value of a Future, e.g. of an async block (see pipeline.hpp). sleep
+ * waits on a timer of the event loop (see event_loop.hpp).
+ * save and load write and read values in the binary format (see serialize.hpp), and write and read
+ * text; given Lists of files, load, read and write go through many of them at once (see io_ring.hpp).
+ * plugin loads the commands of a plugin (see plugin.hpp), and ffi binds a C function of a shared
+ * library (see ffi.hpp).
+ *
+ * @return env_t const& The built-in functions by name.
+ */
+env_t const& builtins();
+
+} // namespace ysh
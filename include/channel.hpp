@@ -0,0 +1,370 @@
+#pragma once
+
+#include "prelude.hpp"
+
+namespace ysh {
+
+namespace detail {
+
+/**
+ * @brief Sleep until @param word is woken, unless it no longer holds @param expected. It may also return
+ * spuriously, so callers check their condition again.
+ */
+void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected) noexcept;
+
+/**
+ * @brief Wake up to @param count threads sleeping on @param word.
+ */
+void futex_wake(std::atomic<std::uint32_t>& word, int count) noexcept;
+
+/**
+ * @brief How many times a side checks again before going to sleep: a full or empty channel is usually
+ * only so for a moment while both sides are running. Past the first @ref k_channel_busy_spins checks, a
+ * side yields the CPU between checks, so that the other one gets to run even when they share a core.
+ */
+inline constexpr auto k_channel_spins = 128;
+inline constexpr auto k_channel_busy_spins = 120;
+
+/**
+ * @brief Wait a little before checking a channel again, the @param spins th time in a row.
+ */
+inline void channel_backoff(int spins) noexcept {
+    if (spins >= k_channel_busy_spins) {
+        std::this_thread::yield();
+    }
+}
+
+inline constexpr std::size_t k_cache_line = 64;
+
+inline std::uint32_t channel_capacity(std::size_t capacity) {
+    return std::uint32_t(std::bit_ceil(std::clamp(capacity, 2uz, 1uz << 30)));
+}
+
+} // namespace detail
+
+/**
+ * @brief A bounded channel from one producer thread to one consumer thread. It's a ring buffer, so
+ * neither side takes a lock or makes a system call while the other keeps up. A side only sleeps (on a
+ * futex) when the channel is full or empty, and is woken by the other one.
+ * The producer closes the channel when it's done: the consumer reads the values left, then sees the end.
+ * The consumer hangs up when it wants no more values: the producer's pushes then fail, as writing to
+ * a pipe nobody reads does.
+ */
+template<typename T>
+class spsc_channel {
+public:
+    explicit spsc_channel(std::size_t capacity = 1024)
+        : m_capacity(detail::channel_capacity(capacity)), m_slots(m_capacity) {}
+
+    spsc_channel(spsc_channel const&) = delete;
+
+    spsc_channel& operator =(spsc_channel const&) = delete;
+
+    /**
+     * @brief Push @param value, waiting for room if the channel is full. Producer only.
+     * @return bool Whether the value was pushed. Once the consumer hung up, pushes fail as soon as the
+     * values already in the channel fill it (the producer doesn't check on every push).
+     */
+    bool push(T value) {
+        auto tail = m_tail.load(std::memory_order_relaxed) & k_index_mask;
+        auto spins = 0;
+        while (true) {
+            auto head = m_head_cache;
+            if (distance(head, tail) < m_capacity) {
+                break;
+            }
+            auto word = m_head.load(std::memory_order_acquire);
+            if (word & k_closed) {
+                return false;
+            }
+            m_head_cache = word & k_index_mask;
+            if (distance(m_head_cache, tail) < m_capacity) {
+                break;
+            }
+            if (++spins < detail::k_channel_spins) {
+                detail::channel_backoff(spins);
+                continue;
+            }
+            sleep(m_producer_waiting, m_head, word);
+        }
+        m_slots[tail & (m_capacity - 1)].value.emplace(std::move(value));
+        m_tail.store((tail + 1) & k_index_mask, std::memory_order_release);
+        wake(m_consumer_waiting, m_tail);
+        return true;
+    }
+
+    /**
+     * @brief Pop the next value, waiting for one if the channel is empty. Consumer only.
+     * @return std::optional<T> The value, or nothing once the channel is closed and empty.
+     */
+    std::optional<T> pop() {
+        auto head = m_head.load(std::memory_order_relaxed) & k_index_mask;
+        auto spins = 0;
+        while (m_tail_cache == head) {
+            auto word = m_tail.load(std::memory_order_acquire);
+            m_tail_cache = word & k_index_mask;
+            if (m_tail_cache != head) {
+                break;
+            }
+            if (word & k_closed) {
+                return std::nullopt;
+            }
+            if (++spins < detail::k_channel_spins) {
+                detail::channel_backoff(spins);
+                continue;
+            }
+            sleep(m_consumer_waiting, m_tail, word);
+        }
+        auto& slot = m_slots[head & (m_capacity - 1)].value;
+        auto result = std::optional<T>(std::move(*slot));
+        slot.reset();
+        m_head.store((head + 1) & k_index_mask, std::memory_order_release);
+        wake(m_producer_waiting, m_head);
+        return result;
+    }
+
+    /**
+     * @brief Mark the end of the values. Producer only, and only once.
+     */
+    void close() noexcept {
+        m_tail.fetch_or(k_closed, std::memory_order_release);
+        detail::futex_wake(m_tail, 1);
+    }
+
+    /**
+     * @brief Make the producer's pushes fail from now on. Consumer only.
+     */
+    void hang_up() noexcept {
+        m_head.fetch_or(k_closed, std::memory_order_release);
+        detail::futex_wake(m_head, 1);
+    }
+
+    /**
+     * @brief Whether the consumer hung up, for a producer that would rather not wait for its pushes to
+     * fail, e.g. one that only writes now and then.
+     */
+    [[nodiscard]]
+    bool hung_up() const noexcept {
+        return m_head.load(std::memory_order_acquire) & k_closed;
+    }
+
+private:
+    // The indices wrap around at 2^31: the top bit of each marks its side as closed, and changing it
+    // wakes the other side.
+    static constexpr std::uint32_t k_closed = 1u << 31;
+    static constexpr std::uint32_t k_index_mask = k_closed - 1;
+
+    struct alignas(detail::k_cache_line) padded_flag {
+        std::atomic<bool> value = false;
+    };
+
+    struct slot_t {
+        std::optional<T> value;
+    };
+
+    static std::uint32_t distance(std::uint32_t head, std::uint32_t tail) noexcept {
+        return (tail - head) & k_index_mask;
+    }
+
+    /**
+     * @brief Sleep on @param word, still @param seen, after telling the other side through @param waiting.
+     */
+    static void sleep(padded_flag& waiting, std::atomic<std::uint32_t>& word, std::uint32_t seen) noexcept {
+        waiting.value.store(true, std::memory_order_relaxed);
+        // Pairs with the fence in wake: either the other side sees the flag, or this one sees its update.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (word.load(std::memory_order_relaxed) == seen) {
+            detail::futex_wait(word, seen);
+        }
+    }
+
+    static void wake(padded_flag& waiting, std::atomic<std::uint32_t>& word) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Cleared here rather than by the sleeper, which may take a while to run: one wake per sleep.
+        if (waiting.value.load(std::memory_order_relaxed) && waiting.value.exchange(false, std::memory_order_relaxed)) {
+            detail::futex_wake(word, 1);
+        }
+    }
+
+    std::uint32_t const m_capacity;
+    std::vector<slot_t> m_slots;
+    // Written by the consumer.
+    alignas(detail::k_cache_line) std::atomic<std::uint32_t> m_head = 0;
+    std::uint32_t m_tail_cache = 0;
+    padded_flag m_consumer_waiting;
+    // Written by the producer.
+    alignas(detail::k_cache_line) std::atomic<std::uint32_t> m_tail = 0;
+    std::uint32_t m_head_cache = 0;
+    padded_flag m_producer_waiting;
+};
+
+/**
+ * @brief A bounded channel from any number of producer threads to any number of consumer threads, e.g.
+ * for several stages feeding one. Each slot carries a sequence number saying whose turn it is, so
+ * producers and consumers claim slots with a compare-and-swap rather than a lock; a side sleeps on a
+ * futex only when the channel is full or empty.
+ * The channel is closed once each of its @p producers called @ref close.
+ */
+template<typename T>
+class mpmc_channel {
+public:
+    explicit mpmc_channel(std::size_t capacity = 1024, std::size_t producers = 1)
+        : m_capacity(detail::channel_capacity(capacity)), m_slots(m_capacity), m_producers(producers) {
+        for (auto i = 0uz; i < m_capacity; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpmc_channel(mpmc_channel const&) = delete;
+
+    mpmc_channel& operator =(mpmc_channel const&) = delete;
+
+    /**
+     * @brief Push @param value, waiting for room if the channel is full.
+     * @return bool Whether the value was pushed, i.e. the consumers haven't hung up.
+     */
+    bool push(T value) {
+        auto spins = 0;
+        while (true) {
+            auto event = m_popped.load(std::memory_order_acquire);
+            if (m_hung_up.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (this->try_push(value)) {
+                notify(m_pushed, m_consumers_waiting);
+                return true;
+            }
+            if (++spins < detail::k_channel_spins) {
+                detail::channel_backoff(spins);
+                continue;
+            }
+            wait(m_popped, m_producers_waiting, event);
+        }
+    }
+
+    /**
+     * @brief Pop a value, waiting for one if the channel is empty.
+     * @return std::optional<T> The value, or nothing once the channel is closed and empty.
+     */
+    std::optional<T> pop() {
+        auto spins = 0;
+        while (true) {
+            auto event = m_pushed.load(std::memory_order_acquire);
+            auto closed = m_producers.load(std::memory_order_acquire) == 0;
+            if (auto result = this->try_pop()) {
+                notify(m_popped, m_producers_waiting);
+                return result;
+            }
+            // Everything pushed before the last close is visible by now, so empty means done.
+            if (closed) {
+                return std::nullopt;
+            }
+            if (++spins < detail::k_channel_spins) {
+                detail::channel_backoff(spins);
+                continue;
+            }
+            wait(m_pushed, m_consumers_waiting, event);
+        }
+    }
+
+    /**
+     * @brief Tell the channel a producer is done. Each producer calls this once.
+     */
+    void close() noexcept {
+        if (m_producers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_pushed.fetch_add(1, std::memory_order_seq_cst);
+            detail::futex_wake(m_pushed, std::numeric_limits<int>::max());
+        }
+    }
+
+    /**
+     * @brief Make the pushes fail from now on.
+     */
+    void hang_up() noexcept {
+        m_hung_up.store(true, std::memory_order_release);
+        m_popped.fetch_add(1, std::memory_order_seq_cst);
+        detail::futex_wake(m_popped, std::numeric_limits<int>::max());
+    }
+
+private:
+    struct alignas(detail::k_cache_line) slot_t {
+        std::atomic<std::size_t> sequence;
+        std::optional<T> value;
+    };
+
+    bool try_push(T& value) {
+        auto position = m_enqueue.load(std::memory_order_relaxed);
+        while (true) {
+            auto& slot = m_slots[position & (m_capacity - 1)];
+            auto sequence = slot.sequence.load(std::memory_order_acquire);
+            auto lag = std::intptr_t(sequence) - std::intptr_t(position);
+            if (lag == 0) {
+                if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value.emplace(std::move(value));
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0) {
+                return false;
+            }
+            else {
+                position = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> try_pop() {
+        auto position = m_dequeue.load(std::memory_order_relaxed);
+        while (true) {
+            auto& slot = m_slots[position & (m_capacity - 1)];
+            auto sequence = slot.sequence.load(std::memory_order_acquire);
+            auto lag = std::intptr_t(sequence) - std::intptr_t(position + 1);
+            if (lag == 0) {
+                if (m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    auto result = std::optional<T>(std::move(*slot.value));
+                    slot.value.reset();
+                    slot.sequence.store(position + m_capacity, std::memory_order_release);
+                    return result;
+                }
+            }
+            else if (lag < 0) {
+                return std::nullopt;
+            }
+            else {
+                position = m_dequeue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Sleep until @param event moves past @param seen, after telling the other side through
+     * @param waiting.
+     */
+    static void wait(std::atomic<std::uint32_t>& event, std::atomic<std::uint32_t>& waiting, std::uint32_t seen) noexcept {
+        waiting.fetch_add(1, std::memory_order_seq_cst);
+        detail::futex_wait(event, seen);
+    }
+
+    static void notify(std::atomic<std::uint32_t>& event, std::atomic<std::uint32_t>& waiting) noexcept {
+        event.fetch_add(1, std::memory_order_seq_cst);
+        // Every sleeper is woken, since they're no longer counted: the ones with nothing to do sleep again.
+        if (waiting.load(std::memory_order_seq_cst) != 0 && waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+            detail::futex_wake(event, std::numeric_limits<int>::max());
+        }
+    }
+
+    std::size_t const m_capacity;
+    std::vector<slot_t> m_slots;
+    alignas(detail::k_cache_line) std::atomic<std::size_t> m_enqueue = 0;
+    alignas(detail::k_cache_line) std::atomic<std::size_t> m_dequeue = 0;
+    // Bumped on every push and pop, for the other side to sleep on.
+    alignas(detail::k_cache_line) std::atomic<std::uint32_t> m_pushed = 0;
+    std::atomic<std::uint32_t> m_consumers_waiting = 0;
+    alignas(detail::k_cache_line) std::atomic<std::uint32_t> m_popped = 0;
+    std::atomic<std::uint32_t> m_producers_waiting = 0;
+    std::atomic<std::size_t> m_producers;
+    std::atomic<bool> m_hung_up = false;
+};
+
+} // namespace ysh
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "prelude.hpp"
+
+namespace ysh {
+
+/**
+ * @brief A request to a ysh server: what a fresh ysh process would have been started with.
+ * On the wire, it's the length of the payload, then the payload: the counts of the arguments and of the
+ * environment variables (32 bits each), then the arguments, the environment variables and the working
+ * directory, each terminated by a NUL. The stdin, stdout and stderr of the client are passed along
+ * with the length as SCM_RIGHTS. The reply is the exit code (32 bits).
+ */
+struct request_t {
+    std::vector<std::string> arguments {};
+    std::vector<std::string> environment {};
+    std::string directory {};
+};
+
+/**
+ * @brief The socket a server listens on unless told otherwise: $YSH_SOCKET if it's set, else ysh.sock
+ * in $XDG_RUNTIME_DIR, else /tmp/ysh-<uid>.sock.
+ */
+stdf::path default_socket();
+
+/**
+ * @brief The full interpreter the thin client runs when there's no server: $YSH_INTERPRETER if it's set,
+ * else YSH_INTERPRETER_PATH, as the client was built with. It's a path rather than a name looked up in
+ * $PATH, since that would find the client itself if it's installed as ysh.
+ */
+stdf::path interpreter_path();
+
+/**
+ * @brief Send @param request over the connected socket @param fd, along with @param fds.
+ * @return bool Whether the whole request was sent.
+ */
+bool send_request(int fd, request_t const& request, std::span<int const> fds);
+
+/**
+ * @brief Receive a request sent by @ref send_request over the connected socket @param fd. The
+ * descriptors passed along are appended to @param fds.
+ * @return std::optional<request_t> The request, unless the connection broke or the request is malformed.
+ */
+std::optional<request_t> receive_request(int fd, std::vector<int>& fds);
+
+/**
+ * @brief Whether the other end of the connected Unix socket @param fd runs as the same user as this
+ * process. Anyone may create a socket at a path such as /tmp/ysh-<uid>.sock first, so neither side
+ * trusts the other before checking.
+ */
+bool peer_is_owner(int fd);
+
+/**
+ * @brief Have the server listening on @param socket run ysh as if this process were it: with its
+ * arguments, environment, working directory and stdio. The client doesn't initialize any of the
+ * interpreter, so it can be linked on its own into a thin executable. Nothing is sent to a server
+ * running as another user (see @ref peer_is_owner).
+ *
+ * @return std::optional<int> The exit code, or nothing if the server can't be reached or isn't trusted.
+ */
+std::optional<int> forward_request(stdf::path const& socket, int argc, char* argv[]);
+
+/**
+ * @brief Entry of the thin client: forward the run to the server, or, if there's none, execute the
+ * interpreter at @ref interpreter_path with the same arguments. Like @ref ysh_main, it's meant to be
+ * called from the main of an executable of its own.
+ */
+int client_main(int argc, char* argv[]);
+
+/**
+ * @brief Serve the requests coming to @param socket from a pool of @param pool_size warm interpreters.
+ * An interpreter is a process forked from the server once it's initialized (the static tables, and the
+ * variables set by the init script, if any), blocked in accept(). It serves a single request on the
+ * stdio of the client, replies with the exit code and exits; the server forks a fresh one in its place.
+ * So a request costs neither an exec nor any initialization, and requests can't see each other's state.
+ *
+ * @return int Only returns, with EXIT_FAILURE, if the socket can't be set up.
+ */
+int serve(stdf::path const& socket, std::size_t pool_size);
+
+} // namespace ysh
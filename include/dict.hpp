@@ -0,0 +1,141 @@
+#pragma once
+
+#include "prelude.hpp"
+
+namespace ysh::types {
+
+class entity;
+
+/**
+ * @brief The dictionary type in ysh: a hash table from entities to entities, keyed consistently with
+ * operator ==, e.g. 1 and 1.0 are the same key.
+ * The table uses open addressing in the style of SwissTable. Next to the slots there is one control
+ * byte per slot, which is either empty, deleted, or the low 7 bits of the hash of the key in the
+ * slot. A lookup probes groups of k_group_width control bytes at once (with SSE2 where available),
+ * and only compares the keys whose 7 bits match, so it rarely touches a slot it doesn't need.
+ */
+class dict_t {
+public:
+    using value_type = std::pair<entity, entity>;
+
+    static constexpr std::size_t k_group_width = 16;
+
+    class iterator {
+    public:
+        using value_type = dict_t::value_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() noexcept = default;
+
+        value_type const& operator *() const noexcept;
+
+        value_type const* operator ->() const noexcept;
+
+        iterator& operator ++() noexcept;
+
+        iterator operator ++(int) noexcept {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+
+        friend bool operator ==(iterator const& lhs, iterator const& rhs) noexcept {
+            return lhs.m_index == rhs.m_index;
+        }
+
+    private:
+        friend class dict_t;
+
+        iterator(dict_t const* dict, std::size_t index) noexcept;
+
+        dict_t const* m_dict = nullptr;
+        std::size_t m_index = 0;
+    };
+
+    dict_t() noexcept = default;
+
+    dict_t(dict_t const& other);
+
+    dict_t(dict_t&& other) noexcept;
+
+    ~dict_t();
+
+    dict_t& operator =(dict_t other) noexcept;
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return m_size;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    /**
+     * @return entity const* The value bound to @param key, or nullptr if there is none.
+     */
+    [[nodiscard]]
+    entity const* find(entity const& key) const;
+
+    [[nodiscard]]
+    bool contains(entity const& key) const {
+        return this->find(key) != nullptr;
+    }
+
+    /**
+     * @brief Bind @param key to @param value, unless @param key is already bound.
+     * @return std::pair<entity*, bool> The value bound to @param key, and whether it was inserted.
+     */
+    std::pair<entity*, bool> try_emplace(entity key, entity value);
+
+    /**
+     * @brief Bind @param key to @param value, replacing any previous binding.
+     * @return bool Whether @param key is new.
+     */
+    bool insert_or_assign(entity key, entity value);
+
+    /**
+     * @return bool Whether @param key was bound.
+     */
+    bool erase(entity const& key);
+
+    /**
+     * @brief Make room for @param count keys in total without rehashing.
+     */
+    void reserve(std::size_t count);
+
+    [[nodiscard]]
+    iterator begin() const noexcept;
+
+    [[nodiscard]]
+    iterator end() const noexcept {
+        return iterator(this, m_capacity);
+    }
+
+    /**
+     * @brief Whether both dictionaries bind the same keys to equal values, in any order.
+     */
+    friend bool operator ==(dict_t const& lhs, dict_t const& rhs);
+
+private:
+    /**
+     * @return std::size_t The slot holding @param key, or m_capacity if there is none.
+     */
+    std::size_t find_slot(entity const& key, std::size_t hash) const;
+
+    /**
+     * @brief Claim a free slot for a new key with @param hash, growing the table if needed.
+     */
+    std::size_t claim_slot(std::size_t hash);
+
+    void rehash(std::size_t capacity);
+
+    std::unique_ptr<std::int8_t[]> m_control;
+    value_type* m_slots = nullptr;
+    std::size_t m_capacity = 0;     // 0 or a power of two, at least k_group_width
+    std::size_t m_size = 0;
+    std::size_t m_growth_left = 0;  // free slots left before the load factor is exceeded
+};
+
+} // namespace ysh::types
@@ -1,11 +1,20 @@
 #pragma once
 #include "prelude.hpp"
+#include "bigint.hpp"
+#include "rope.hpp"
+#include "dict.hpp"
 
 namespace ysh {
 
 template<typename T>
 concept arithmetic = std::is_arithmetic_v<T>;
 
+/**
+ * @brief Arithmetic types, plus the arbitrary-precision integer.
+ */
+template<typename T>
+concept numeric = arithmetic<T> || std::same_as<T, types::bigint_t>;
+
 namespace types {
 
 class entity;
@@ -62,8 +71,6 @@ using list_t = std::vector<entity>;
 
 using real_t = long double;
 
-using str_t = std::string;
-
 /**
  * @brief The tuple type in ysh.
  * type tuple = empty | (entity, tuple)
@@ -133,23 +140,207 @@ struct tuple_t {
     entity value() const;
 };
 
+/**
+ * @brief The lazy sequence type in ysh. A sequence holds the recipe for its elements rather than the
+ * elements themselves, so it takes constant memory however long it is. Every pass over a sequence
+ * restarts the recipe, and copies of a sequence share it.
+ * A recipe is a source (a coroutine, a range or a List) followed by stages: map, filter and take add a
+ * stage to a copy of the recipe rather than wrapping the sequence in another one. So a chain of them
+ * is fused into a single loop over the source, each element going through every stage before the next
+ * one is generated, with nothing buffered in between.
+ * @example
+ * @code map $ (f, 1..1000000) @endcode only ever holds one element at a time.
+ */
+class seq_t {
+public:
+    using source_type = std::function<generator<entity> ()>;
+
+    explicit seq_t(source_type source);
+
+    /**
+     * @brief The Ints from @param first to @param last, both inclusive.
+     */
+    static seq_t range(int_t first, int_t last);
+
+    /**
+     * @brief The elements of @param list, which the sequence keeps.
+     */
+    static seq_t of(list_t list);
+
+    /**
+     * @brief Start a new pass over the elements.
+     */
+    [[nodiscard]]
+    generator<entity> iterate() const;
+
+    /**
+     * @brief Make a pass over the elements, passing each to @param sink until it returns false. Unlike
+     * @ref iterate, the pass doesn't suspend between elements: it's one loop over the source, so prefer
+     * this when consuming a whole sequence.
+     * @return bool Whether @param sink took every element.
+     */
+    bool for_each(std::function<bool (entity const&)> const& sink) const;
+
+    [[nodiscard]]
+    seq_t map(func_t func) const;
+
+    [[nodiscard]]
+    seq_t filter(func_t pred) const;
+
+    /**
+     * @brief The first @param count elements. No element past them is ever generated.
+     */
+    [[nodiscard]]
+    seq_t take(std::size_t count) const;
+
+    /**
+     * @brief Generate all the elements into a list.
+     */
+    [[nodiscard]]
+    list_t to_list() const;
+
+    /**
+     * @brief Whether the two sequences share the same recipe. Sequences are never compared by elements,
+     * since that could take forever.
+     */
+    friend bool operator ==(seq_t const& lhs, seq_t const& rhs) noexcept {
+        return lhs.m_recipe == rhs.m_recipe;
+    }
+
+private:
+    struct recipe;
+
+    explicit seq_t(std::shared_ptr<recipe const> recipe) noexcept
+        : m_recipe(std::move(recipe)) {}
+
+    std::shared_ptr<recipe const> m_recipe;
+};
+
+/**
+ * @brief The channel type in ysh: a bounded queue that any number of threads send entities to and
+ * receive them from, e.g. blocks running in parallel passing their results back. Copies of a channel
+ * are the same channel.
+ * A channel is closed once: receivers then get the values left in it, then the end, and sends fail.
+ * @example
+ * @code results <- chan $ 64 @endcode
+ */
+class chan_t {
+public:
+    explicit chan_t(std::size_t capacity);
+
+    /**
+     * @brief Send @param value, waiting for room if the channel is full.
+     * @return bool Whether the value was sent, i.e. the channel wasn't closed.
+     */
+    bool send(entity value) const;
+
+    /**
+     * @brief Receive the next value, waiting for one if the channel is empty.
+     * @return std::optional<entity> The value, or nothing once the channel is closed and empty.
+     */
+    [[nodiscard]]
+    std::optional<entity> receive() const;
+
+    /**
+     * @brief Close the channel. Values sent before, including by sends still waiting for room, are
+     * still received. Closing a closed channel does nothing.
+     */
+    void close() const;
+
+    /**
+     * @brief The values received from now until the channel is closed, as a Seq. Unlike other Seqs,
+     * each pass takes values out of the channel, so a value goes to one pass only.
+     */
+    [[nodiscard]]
+    seq_t received() const;
+
+    /**
+     * @brief Whether the two are the same channel.
+     */
+    friend bool operator ==(chan_t const& lhs, chan_t const& rhs) noexcept {
+        return lhs.m_state == rhs.m_state;
+    }
+
+private:
+    struct state;
+
+    std::shared_ptr<state> m_state;
+};
+
+/**
+ * @brief The future type in ysh: the value of a computation running on a thread of its own, e.g. an
+ * async block (see pipeline.hpp), available once it's done. Copies of a future share the computation,
+ * and the last one to go waits for it to end.
+ */
+class future_t {
+public:
+    using task_type = std::function<entity ()>;
+
+    /**
+     * @brief Start running @param task on a new thread. An exception it throws becomes its value, as an
+     * Error.
+     */
+    explicit future_t(task_type task);
+
+    /**
+     * @brief Whether the computation is done, i.e. @ref get doesn't wait.
+     */
+    [[nodiscard]]
+    bool ready() const noexcept;
+
+    /**
+     * @brief The value, waiting for the computation to end if it hasn't yet.
+     */
+    [[nodiscard]]
+    entity const& get() const;
+
+    /**
+     * @brief Whether the two share the same computation.
+     */
+    friend bool operator ==(future_t const& lhs, future_t const& rhs) noexcept {
+        return lhs.m_state == rhs.m_state;
+    }
+
+private:
+    struct state;
+
+    std::shared_ptr<state> m_state;
+};
+
 /**
  * @brief The entity type in ysh.
- * type entity = int | real | str | func | list | tuple | error;
+ * type entity = int | real | str | func | list | tuple | error | seq | dict | chan | future;
+ * Ints too large for int_t are held as bigint_t (with the BIGINT tag), but are still Ints to scripts.
  */
 class entity {
 public:
-    using value_type = std::variant<int_t, real_t, str_t, list_t, tuple_t, func_t, error_t>;
+    using value_type = std::variant<int_t, real_t, str_t, list_t, tuple_t, func_t, error_t, bigint_t, seq_t, dict_t, chan_t, future_t>;
 
     enum type {
-        INT, REAL, STR, LIST, TUPLE, FUNC, ERROR
+        INT, REAL, STR, LIST, TUPLE, FUNC, ERROR, BIGINT, SEQ, DICT, CHAN, FUTURE
+    };
+
+    /**
+     * @brief What an entity points to: its value, and the hash of the value once it has been asked for
+     * (see @ref hash). Copies of the payload keep the hash, since they are equal.
+     */
+    struct payload {
+        value_type value;
+        mutable std::atomic<std::size_t> hash = 0;  // 0 until computed
+
+        template<typename T, typename... Args>
+        explicit payload(std::in_place_type_t<T> tag, Args&&... args)
+            : value(tag, FWD(args)...) {}
+
+        payload(payload const& other)
+            : value(other.value), hash(other.hash.load(std::memory_order_relaxed)) {}
     };
 
     struct value_deleter {
-        void operator ()(value_type* value) const;
+        void operator ()(payload* value) const;
     };
 
-    using value_ptr = std::unique_ptr<value_type, value_deleter>;
+    using value_ptr = std::unique_ptr<payload, value_deleter>;
 
     entity() = default;
 
@@ -162,13 +353,54 @@ public:
 
     ~entity() = default;
 
+    /**
+     * @brief Access the value in place.
+     * @throws std::runtime_error if the value isn't a @tparam T.
+     */
     template<contained_by<value_type> T>
-    T& get();
+    T const& get() const {
+        if (auto const* value = m_value ? std::get_if<T>(&m_value->value) : nullptr) {
+            return *value;
+        }
+        throw std::runtime_error("Wrong type!");
+    }
+
+    /**
+     * @brief Access the value in place, to modify it. This forgets the cached hash, so the reference
+     * must not be used to modify the value after the hash is asked for again.
+     */
+    template<contained_by<value_type> T>
+    T& get() {
+        auto& value = const_cast<T&>(std::as_const(*this).get<T>());
+        m_value->hash.store(0, std::memory_order_relaxed);
+        return value;
+    }
+
+    /**
+     * @brief A hash of the value, consistent with operator ==: equal numbers hash the same whatever
+     * their types, and so do equal strings, lists, tuples and dictionaries.
+     * The hashes of strings and containers are computed once and cached in the payload, where
+     * operator == uses them to tell unequal values apart without comparing them.
+     */
+    [[nodiscard]]
+    std::size_t hash() const;
+
+    /**
+     * @brief Whether the two values are equal. Unlike operator ==, which throws on values of unrelated
+     * types, this just tells they're different, so it's suitable for comparing keys.
+     */
+    [[nodiscard]]
+    bool equivalent(entity const& other) const;
 
     template<typename T>
     [[nodiscard]]
     bool is() const noexcept;
 
+    [[nodiscard]]
+    type kind() const noexcept {
+        return m_type;
+    }
+
     entity& operator =(entity const& other);
 
     entity& operator =(entity&& other) noexcept = default;
@@ -215,6 +447,8 @@ public:
 
     friend entity operator_zip(entity const& lhs, entity const& rhs);
 
+    friend entity operator_range(entity const& lhs, entity const& rhs);
+
     explicit operator bool() const;
 
     explicit operator int_t() const;
@@ -229,6 +463,10 @@ public:
 
     explicit operator func_t() const;
 
+    explicit operator seq_t() const;
+
+    explicit operator dict_t() const;
+
     explicit operator error_t() const;
 
     explicit operator std::partial_ordering() const;
@@ -247,12 +485,207 @@ public:
     static type of(T&& arg) noexcept;
 
 private:
+    /**
+     * @brief The payload as a const lvalue. Visitors are always applied to this, so that the overloads
+     * taking specific types by const reference win over the generic ones taking auto&&.
+     */
+    [[nodiscard]]
+    value_type const& value() const noexcept {
+        return m_value->value;
+    }
+
+    /**
+     * @brief Access the payload, knowing its type from the type tag.
+     */
+    template<typename T>
+    [[nodiscard]]
+    T const& unchecked() const noexcept {
+        return *std::get_if<T>(&m_value->value);
+    }
+
+    /**
+     * @return std::size_t The hash of the value if it's known, otherwise 0.
+     */
+    [[nodiscard]]
+    std::size_t cached_hash() const noexcept {
+        return m_value ? m_value->hash.load(std::memory_order_relaxed) : 0;
+    }
+
+    [[nodiscard]]
+    std::size_t compute_hash() const;
+
+    [[nodiscard]]
+    bool is_integral() const noexcept {
+        return m_type == INT || m_type == BIGINT;
+    }
+
+    [[nodiscard]]
+    bool is_number() const noexcept {
+        return m_type == INT || m_type == REAL || m_type == BIGINT;
+    }
+
+    /**
+     * @pre is_integral()
+     */
+    [[nodiscard]]
+    bigint_t as_bigint() const {
+        return m_type == INT ? bigint_t(unchecked<int_t>()) : unchecked<bigint_t>();
+    }
+
+    /**
+     * @pre is_number()
+     */
+    [[nodiscard]]
+    real_t as_real() const noexcept {
+        switch (m_type) {
+            case INT:    return real_t(unchecked<int_t>());
+            case BIGINT: return real_t(unchecked<bigint_t>());
+            default:     return unchecked<real_t>();
+        }
+    }
+
+    /**
+     * @brief The fast path of the operators on numbers. The operands are dispatched on their type tags
+     * instead of visiting the variant: Int op Int is applied as is, any combination involving a Real
+     * is applied to Reals, and the remaining combinations of Ints are applied to bigint_t.
+     * @pre lhs.is_number() && rhs.is_number()
+     */
+    template<typename Op>
+    static auto arithmetic(entity const& lhs, entity const& rhs, Op&& op) {
+        if (lhs.m_type == INT && rhs.m_type == INT) [[likely]] {
+            return op(lhs.unchecked<int_t>(), rhs.unchecked<int_t>());
+        }
+        if (lhs.m_type == REAL || rhs.m_type == REAL) {
+            return op(lhs.as_real(), rhs.as_real());
+        }
+        return op(lhs.as_bigint(), rhs.as_bigint());
+    }
+
+    /**
+     * @brief Shift an Int by @param shift bits, the other way if it's negative. Left shifts promote the
+     * value to bigint_t if the result doesn't fit; right shifts round toward negative infinity.
+     * @pre value.is_integral() && shift.is_integral()
+     */
+    static entity shift(entity const& value, entity const& shift, bool left);
+
+    /**
+     * @brief Like @ref arithmetic, for the operators defined on Ints only.
+     * @pre lhs.is_integral() && rhs.is_integral()
+     */
+    template<typename Op>
+    static auto integral(entity const& lhs, entity const& rhs, Op&& op) {
+        if (lhs.m_type == INT && rhs.m_type == INT) [[likely]] {
+            return op(lhs.unchecked<int_t>(), rhs.unchecked<int_t>());
+        }
+        return op(lhs.as_bigint(), rhs.as_bigint());
+    }
+
     value_ptr m_value;
-    type m_type;
+    type m_type = ERROR;
 };
+
+template<not_of<entity> T>
+entity::entity(T&& value) {
+    using enum type;
+    using type = TYPE(value);
+
+    if constexpr (std::is_integral_v<type>) {
+        m_value = value_ptr(new payload(std::in_place_type<int_t>, value));
+        m_type = INT;
+    }
+    else if constexpr (std::is_floating_point_v<type>) {
+        m_value = value_ptr(new payload(std::in_place_type<real_t>, value));
+        m_type = REAL;
+    }
+    else if constexpr (std::same_as<bigint_t, type>) {
+        // Keep the invariant that BIGINT is only used for values that don't fit in an int_t.
+        if (value.fits()) {
+            m_value = value_ptr(new payload(std::in_place_type<int_t>, int_t(value)));
+            m_type = INT;
+        }
+        else {
+            m_value = value_ptr(new payload(std::in_place_type<bigint_t>, FWD(value)));
+            m_type = BIGINT;
+        }
+    }
+    else if constexpr (std::same_as<str_t, type> || std::convertible_to<type, std::string>) {
+        m_value = value_ptr(new payload(std::in_place_type<str_t>, FWD(value)));
+        m_type = STR;
+    }
+    else if constexpr (std::same_as<list_t, type>) {
+        m_value = value_ptr(new payload(std::in_place_type<list_t>, FWD(value)));
+        m_type = LIST;
+    }
+    else if constexpr (std::same_as<tuple_t, type>) {
+        m_value = value_ptr(new payload(std::in_place_type<tuple_t>, FWD(value)));
+        m_type = TUPLE;
+    }
+    else if constexpr (std::same_as<func_t, type>) {
+        m_value = value_ptr(new payload(std::in_place_type<func_t>, FWD(value)));
+        m_type = FUNC;
+    }
+    else if constexpr (std::same_as<seq_t, type>) {
+        m_value = value_ptr(new payload(std::in_place_type<seq_t>, FWD(value)));
+        m_type = SEQ;
+    }
+    else if constexpr (std::same_as<dict_t, type>) {
+        m_value = value_ptr(new payload(std::in_place_type<dict_t>, FWD(value)));
+        m_type = DICT;
+    }
+    else if constexpr (std::same_as<chan_t, type>) {
+        m_value = value_ptr(new payload(std::in_place_type<chan_t>, FWD(value)));
+        m_type = CHAN;
+    }
+    else if constexpr (std::same_as<future_t, type>) {
+        m_value = value_ptr(new payload(std::in_place_type<future_t>, FWD(value)));
+        m_type = FUTURE;
+    }
+    else if constexpr (std::convertible_to<type, error_t>) {
+        m_value = value_ptr(new payload(std::in_place_type<error_t>, FWD(value)));
+        m_type = ERROR;
+    }
+    else {
+        m_value = value_ptr(new payload(std::in_place_type<error_t>, "Unsupported type"));
+        m_type = ERROR;
+    }
+}
+
+// Defined here rather than in entity.cpp, since callers construct tuples from iterators of their own.
+template<typename InputIt>
+tuple_t::tuple_t(InputIt first, InputIt last) : tuple_t() {
+    auto* tupptr = this;
+    while (first != last) {
+        tupptr->data = data_ptr(new data_type(std::make_pair(*first++, tuple_t())));
+        tupptr = &tupptr->content().second;
+    }
+}
+
+/**
+ * @brief @param base ^ 2, computed as base * base for an Int or a Real. Anything else, a bigint
+ * included, is raised to the power of 2 by ^, which fails the same way it does.
+ */
+entity square(entity const& base);
+
 } // namespace types
 
 // Bring class entity out of the types namespace.
 using entity_t = types::entity;
 
-} // namespace ysh
\ No newline at end of file
+} // namespace ysh
+
+/**
+ * @brief Entities as keys of the standard unordered containers.
+ */
+template<>
+struct std::hash<ysh::types::entity> {
+    std::size_t operator ()(ysh::types::entity const& ent) const {
+        return ent.hash();
+    }
+};
+
+template<>
+struct std::equal_to<ysh::types::entity> {
+    bool operator ()(ysh::types::entity const& lhs, ysh::types::entity const& rhs) const {
+        return lhs.equivalent(rhs);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "prelude.hpp"
+
+#include <signal.h>
+
+namespace ysh {
+
+/**
+ * @brief A loop supervising the child processes, file descriptors and timers of the thread running it,
+ * with a single epoll: a child is watched through a pidfd, a timer is a timerfd, so the thread sleeps
+ * in one place until any of them is ready, however many there are, and neither polls nor needs a
+ * thread per job. Each thread has its own (see @ref local), e.g. an async block supervising its jobs.
+ *
+ * While children are watched, an interrupt (Ctrl-C) is read from a signalfd rather than taking the
+ * shell down: the terminal sends it to the children too, which are what it's meant for. SIGPIPE is
+ * read from it too, so that writing to a child that exited is only a failed write. Both are sent to
+ * the whole process, so the threads ysh starts block them for good (see @ref block_loop_signals):
+ * otherwise the kernel could hand them to one of those, where they'd take the shell down after all.
+ * The programs those threads start don't inherit that (see @ref exec_child).
+ */
+class event_loop {
+public:
+    /**
+     * @brief Called with the status of a child that exited, as waitpid returns it.
+     */
+    using child_handler = std::function<void (int status)>;
+    /**
+     * @brief Called with the epoll events of a descriptor that's ready. Returns whether to keep
+     * watching it.
+     */
+    using fd_handler = std::function<bool (std::uint32_t events)>;
+    using timer_handler = std::function<void ()>;
+
+    /**
+     * @brief The loop of the current thread.
+     */
+    static event_loop& local();
+
+    /**
+     * @throws error_t if the epoll can't be set up.
+     */
+    event_loop();
+
+    event_loop(event_loop const&) = delete;
+
+    event_loop& operator =(event_loop const&) = delete;
+
+    ~event_loop();
+
+    /**
+     * @brief Call @param on_exit once the child @param pid exits, and reap it. On kernels without
+     * pidfds, the child is waited for once nothing else is left to watch.
+     */
+    void watch_child(pid_t pid, child_handler on_exit);
+
+    /**
+     * @brief Call @param on_ready whenever @param fd is ready for @param events (EPOLLIN, EPOLLOUT),
+     * until it returns false. The loop then closes @param fd, which it owns from now on.
+     */
+    void watch(int fd, std::uint32_t events, fd_handler on_ready);
+
+    /**
+     * @brief Call @param on_expiry once @param delay has passed.
+     */
+    void after(std::chrono::nanoseconds delay, timer_handler on_expiry);
+
+    /**
+     * @brief Dispatch events until nothing is left to watch. Handlers may watch more.
+     */
+    void run();
+
+    /**
+     * @brief Whether anything is left to watch.
+     */
+    [[nodiscard]]
+    bool empty() const noexcept {
+        return m_watches.empty() && m_unwatched.empty();
+    }
+
+private:
+    struct watch_t {
+        int fd = -1;
+        pid_t pid = 0;
+        bool is_timer = false;
+        child_handler on_exit {};
+        fd_handler on_ready {};
+        timer_handler on_expiry {};
+    };
+
+    /**
+     * @brief Start watching the descriptor of @param watch for @param events.
+     */
+    void add(std::uint32_t events, watch_t watch);
+
+    /**
+     * @brief Dispatch @param events to the watch @param id, and drop it if it's done.
+     */
+    void dispatch(std::uint64_t id, std::uint32_t events);
+
+    /**
+     * @brief Read and drop the signals pending on the signalfd.
+     */
+    void drain_signals() noexcept;
+
+    int m_epoll = -1;
+    int m_signals = -1;
+    std::size_t m_children = 0;
+    std::uint64_t m_next_id = 0;
+    std::unordered_map<std::uint64_t, watch_t> m_watches;
+    // The children that couldn't get a pidfd.
+    std::vector<std::pair<pid_t, child_handler>> m_unwatched;
+};
+
+/**
+ * @brief Holds interrupts off the current thread while it lives, for a thread waiting on children that
+ * the loops of other threads supervise: an interrupt is the children's business, as in
+ * @ref event_loop::run. One that came in meanwhile is dropped once the guard is gone, rather than
+ * delivered then.
+ */
+class interrupt_guard {
+public:
+    interrupt_guard() noexcept;
+
+    interrupt_guard(interrupt_guard const&) = delete;
+
+    interrupt_guard& operator =(interrupt_guard const&) = delete;
+
+    ~interrupt_guard();
+
+private:
+    sigset_t m_saved;
+};
+
+/**
+ * @brief Block the signals the loops read, SIGINT and SIGPIPE, on the current thread for good. Every
+ * thread ysh starts calls it first thing, so that only the threads running a loop, which read them, or
+ * the main thread, take them.
+ */
+void block_loop_signals() noexcept;
+
+/**
+ * @brief In a child just forked, run the program @param argv, searched for in PATH. It starts with no
+ * signals blocked, and SIGINT and SIGPIPE doing what they do by default, whatever the thread that
+ * forked it had done with them. If it can't be run, @param failed is written to stderr followed by the
+ * reason (a fixed message for the common ones, the errno otherwise), and the child exits with 127.
+ * Only makes calls that are safe between fork and exec, as the child of a process with several
+ * threads must.
+ */
+[[noreturn]]
+void exec_child(char* const argv[], std::string_view failed) noexcept;
+
+/**
+ * @brief Wait for the child @param pid to exit, on the loop of the current thread.
+ * @return int Its exit code, or 128 plus the signal that terminated it.
+ */
+int wait_child(pid_t pid);
+
+/**
+ * @brief The exit code a shell reports for the waitpid @param status of a child.
+ */
+[[nodiscard]]
+inline int exit_code(int status) noexcept {
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+} // namespace ysh
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "ysh.hpp"
+
+namespace ysh {
+
+/**
+ * @brief The opcodes of a compiled expression. A compiled expression is a flat postfix program
+ * running on an operand stack.
+ */
+enum opcode_t : unsigned char {
+    YSH_PUSH,   // push a constant
+    YSH_LOAD,   // push the value of a variable
+    YSH_STORE,  // assign the top of the stack to a variable (the value stays on the stack)
+    YSH_APPLY,  // pop two operands and push the result of a built-in operator
+    YSH_SQUARE  // replace the top of the stack with its square (see types::square)
+};
+
+/**
+ * @brief A single step of a compiled expression.
+ */
+struct instruction_t {
+    opcode_t opcode;
+    builtin_operator_t op = YSH_NON_BUILTIN;    // YSH_APPLY only
+    input_t name {};                            // YSH_LOAD and YSH_STORE only
+    entity_t value {};                          // YSH_PUSH only
+};
+
+/**
+ * @brief An expression compiled from its source text. The names referenced by the instructions are
+ * views into the source, which is kept on the heap so that the views survive moving the expression.
+ * The source is null if the names refer to storage that outlives the expression, e.g. a compiled
+ * script (see script_cache.hpp).
+ */
+struct expression_t {
+    std::unique_ptr<std::string const> source {};
+    std::vector<instruction_t> code {};
+
+    /**
+     * @brief The distinct variables read by the expression, in order of first appearance.
+     */
+    std::vector<input_t> reads {};
+
+    /**
+     * @brief Whether the result depends on nothing but the values of the variables read. Expressions
+     * that assign variables or apply functions are never pure.
+     */
+    bool pure = true;
+};
+
+/**
+ * @brief A cache of compiled expressions and of the results of pure ones.
+ * A remembered result is keyed by the compiled expression plus the generations of the variables it
+ * reads, so it is invalidated as soon as any of those variables is reassigned.
+ */
+class expression_cache {
+public:
+    /**
+     * @brief Keeps every entry of a cache while it exists. A full cache is cleared to make room, but
+     * only while nothing pins it, so an expression being evaluated, and the names it binds, stay valid
+     * however deeply evaluations nest, e.g. through a Func evaluating expressions of its own.
+     */
+    class pin {
+    public:
+        explicit pin(expression_cache& cache) noexcept
+            : m_cache(cache) {
+            ++m_cache.m_pins;
+        }
+
+        pin(pin const&) = delete;
+
+        pin& operator =(pin const&) = delete;
+
+        ~pin() {
+            --m_cache.m_pins;
+        }
+
+    private:
+        expression_cache& m_cache;
+    };
+
+    /**
+     * @brief Compile an expression, or fetch its compiled form if it was seen before.
+     *
+     * @param expr The source of the expression (without the surrounding parentheses).
+     * @return expression_t const& The compiled expression, owned by the cache: it stays valid while the
+     * cache is pinned, and until the next expression is added otherwise.
+     */
+    expression_t const& compile(input_t expr);
+
+    /**
+     * @brief Add an expression compiled elsewhere, unless one was already compiled from the same source.
+     *
+     * @param compiled The compiled expression, which must have a source of its own.
+     */
+    void insert(expression_t compiled);
+
+    /**
+     * @brief Recall the result of a pure expression evaluated before.
+     *
+     * @param expr A compiled expression owned by this cache.
+     * @param env The environment the expression is evaluated in.
+     * @return std::optional<entity_t> The result, if it's still valid in this environment.
+     */
+    std::optional<entity_t> recall(expression_t const& expr, env_t const& env) const;
+
+    /**
+     * @brief Remember the result of an expression. Results of impure expressions are ignored.
+     */
+    void remember(expression_t const& expr, env_t const& env, entity_t const& result);
+
+    /**
+     * @brief Drop every entry, which mustn't be done while the cache is pinned.
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief The cache of the current thread.
+     */
+    static expression_cache& local();
+
+private:
+    struct memo_t {
+        std::vector<generation_t> generations {};
+        entity_t result {};
+    };
+
+    static constexpr std::size_t k_max_entries = 4096;
+
+    /**
+     * @brief Clear the cache if it's full and nothing pins it.
+     */
+    void make_room() noexcept;
+
+    std::size_t m_pins = 0;
+
+    // Keys are views into the source of the expressions they map to.
+    std::unordered_map<input_t, expression_t, typename input_t::hash> m_compiled;
+    std::unordered_map<expression_t const*, memo_t> m_memos;
+};
+
+/**
+ * @brief Apply a built-in binary operator.
+ */
+entity_t apply(builtin_operator_t op, entity_t const& lhs, entity_t const& rhs);
+
+/**
+ * @brief Compile an expression without consulting any cache.
+ *
+ * @param expr The source of the expression (without the surrounding parentheses).
+ * @return expression_t
+ */
+expression_t compile(input_t expr);
+
+/**
+ * @brief Optimize a compiled expression in place. Constant subexpressions are folded, e.g.
+ * @code 60 * 60 * 24 -> 86400 @endcode
+ * the left-hand side of ; is dropped if computing it has no effect and can't fail, e.g.
+ * @code (1 + 2); x -> x @endcode
+ * squaring is reduced to a multiplication, for Ints and Reals (see types::square), and algebraic
+ * identities are simplified where the operands are known to be numbers, e.g.
+ * @code x ^ 2 -> x * x, (x < y) * 1 -> x < y, (x = y) + 0 -> x = y @endcode
+ * The identities don't hold for other types ("str" + 0 is an error), and nothing is known of the type
+ * of a variable, so x + 0 is left alone.
+ *
+ * @param expr
+ */
+void optimize(expression_t& expr);
+
+/**
+ * @brief Work out the variables read by a compiled expression and whether it's pure, from its code.
+ */
+void analyze(expression_t& expr);
+
+/**
+ * @brief Run a compiled expression.
+ *
+ * @param expr The compiled expression.
+ * @param env The environment to read and assign variables in.
+ * @return entity_t The value left on the operand stack.
+ */
+entity_t run(expression_t const& expr, env_t& env);
+
+/**
+ * @brief A Func written in a script, e.g. @code "x" -> "x * 2" @endcode Calling it binds the parameter
+ * to its argument and runs the body, compiled once when the Func is made, in which any other name is
+ * looked up in the session. It keeps the source of its body, so that a session snapshot can save it
+ * and compile it again (see session.hpp).
+ */
+struct abstraction_t {
+    std::string param;
+    std::shared_ptr<expression_t const> body;
+
+    entity_t operator ()(entity_t arg) const;
+};
+
+/**
+ * @brief Make the Func taking @param param to the value of @param body.
+ * @return entity_t The Func, or an Error if @param param isn't a name or @param body doesn't compile.
+ */
+entity_t abstraction(std::string param, std::string_view body);
+
+} // namespace ysh
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "entity.hpp"
+
+namespace ysh {
+
+/**
+ * @brief The signature of a C function, written as the result type followed by the parameter types in
+ * parentheses, e.g. "d(dd)" for double (*)(double, double). The types are:
+ * - i: int, l: long (both from and to Int),
+ * - d: double (from Int or Real, to Real),
+ * - s: char const* (from and to Str),
+ * - v: void (result only; the call returns an empty tuple).
+ * A function may take up to 6 integer or string parameters and up to 8 doubles. Variadic functions,
+ * structs and floats aren't supported.
+ */
+struct foreign_signature {
+    char result;
+    std::vector<char> params {};
+
+    /**
+     * @throws error_t if @param signature is malformed or takes too many parameters.
+     */
+    static foreign_signature parse(std::string_view signature);
+};
+
+/**
+ * @brief Bind the C function @param symbol of the shared library @param library (say, libm.so.6) as a
+ * Func, so that scripts call it directly. A function of one parameter is called with the argument
+ * itself, and a function of several with a tuple, like the built-ins. Arguments of the wrong kind
+ * make the call return an Error. Nothing checks that @param signature matches the function.
+ *
+ * @throws error_t if the library or the symbol can't be found, or this platform isn't supported.
+ */
+types::func_t bind_foreign(std::string const& library, std::string const& symbol, std::string_view signature);
+
+} // namespace ysh
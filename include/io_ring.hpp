@@ -0,0 +1,72 @@
+#pragma once
+
+#include "prelude.hpp"
+
+namespace ysh {
+
+/**
+ * @brief How many files a ring has in flight at once, and the size of the registered buffer each of
+ * them is read into.
+ */
+inline constexpr std::size_t k_ring_files = 64;
+inline constexpr std::size_t k_ring_buffer_size = 1 << 15;
+
+/**
+ * @brief A file read whole by @ref io_ring::read: its contents, or the errno that stopped it.
+ */
+struct file_contents_t {
+    std::string data;
+    int error = 0;
+};
+
+/**
+ * @brief Whole-file I/O on many files at once, with as few system calls as possible. Files are handled
+ * in batches of up to @ref k_ring_files: the opens of a batch are submitted to an io_uring together,
+ * then its reads, into buffers registered with the kernel up front, then its closes, so a batch costs
+ * a handful of system calls rather than several per file. Where io_uring isn't available (an old
+ * kernel, or a sandbox forbidding it), the files are read and written with plain system calls.
+ * Each thread has its own ring (see @ref local).
+ */
+class io_ring {
+public:
+    /**
+     * @brief The ring of the current thread.
+     */
+    static io_ring& local();
+
+    io_ring();
+
+    io_ring(io_ring const&) = delete;
+
+    io_ring& operator =(io_ring const&) = delete;
+
+    ~io_ring();
+
+    /**
+     * @brief Whether the files go through an io_uring rather than plain system calls.
+     */
+    [[nodiscard]]
+    bool is_uring() const noexcept {
+        return m_ring != nullptr;
+    }
+
+    /**
+     * @brief Read each of the files at @param paths whole.
+     */
+    [[nodiscard]]
+    std::vector<file_contents_t> read(std::span<std::string const> paths);
+
+    /**
+     * @brief Write each of @param contents to the file at the same index of @param paths, creating it
+     * or replacing what it held.
+     * @return std::vector<int> For each file, 0 or the errno that stopped it.
+     */
+    std::vector<int> write(std::span<std::string const> paths, std::span<std::string_view const> contents);
+
+private:
+    struct ring;
+
+    std::unique_ptr<ring> m_ring;
+};
+
+} // namespace ysh
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "ysh.hpp"
+
+namespace ysh {
+
+/**
+ * @brief The native types that convert to and from entities: the entity itself, bool and the other
+ * arithmetic types, strings, and vectors of any of these.
+ */
+template<typename T>
+concept marshallable = std::same_as<T, entity_t> || arithmetic<T> || std::same_as<T, std::string> ||
+    std::same_as<T, std::string_view> || std::same_as<T, char const*> ||
+    requires { typename T::value_type; requires std::same_as<T, std::vector<typename T::value_type>>; };
+
+/**
+ * @brief Whether a @tparam T converted from an entity refers into it, i.e. is a view of a Str or a
+ * vector of those, rather than holding a copy.
+ */
+template<typename T>
+consteval bool borrows_entity() {
+    if constexpr (std::same_as<T, std::string_view> || std::same_as<T, char const*>) {
+        return true;
+    }
+    else if constexpr (requires { typename T::value_type; requires std::same_as<T, std::vector<typename T::value_type>>; }) {
+        return borrows_entity<typename T::value_type>();
+    }
+    else {
+        return false;
+    }
+}
+
+/**
+ * @brief Convert a native value to an entity. Vectors become Lists.
+ */
+template<typename T>
+entity_t to_entity(T const& value) {
+    using type = std::decay_t<T>;
+    if constexpr (std::same_as<type, entity_t>) {
+        return value;
+    }
+    else if constexpr (std::integral<type>) {
+        return entity_t(types::int_t(value));
+    }
+    else if constexpr (std::floating_point<type>) {
+        return entity_t(types::real_t(value));
+    }
+    else if constexpr (std::convertible_to<type, std::string_view>) {
+        return entity_t(types::str_t(std::string(std::string_view(value))));
+    }
+    else {
+        auto result = types::list_t();
+        result.reserve(value.size());
+        for (auto const& elem : value) {
+            result.push_back(to_entity(elem));
+        }
+        return entity_t(std::move(result));
+    }
+}
+
+/**
+ * @brief Convert an entity to a native value. Ints convert to floating-point types too, and anything
+ * converts to bool, as in a condition. A std::string_view or a char const* (which is '\0'-terminated)
+ * is a view into the Str itself, valid as long as @param value or a copy of it is alive.
+ * @throws error_t if the entity is of another kind, or an Int doesn't fit in @tparam T.
+ */
+template<typename T>
+T from_entity(entity_t const& value) {
+    auto const expect = [&value](entity_t::type kind) {
+        if (value.kind() != kind) {
+            types::throw_standard_error("Expected " + entity_t::name(kind) + ", got " + entity_t::name(value.kind()));
+        }
+    };
+    if constexpr (std::same_as<T, entity_t>) {
+        return value;
+    }
+    else if constexpr (std::same_as<T, bool>) {
+        return bool(value);
+    }
+    else if constexpr (std::integral<T>) {
+        auto const out_of_range = [](std::string const& digits) {
+            auto const target = (std::is_signed_v<T> ? "int" : "uint") + std::to_string(8 * sizeof(T));
+            types::throw_standard_error("Int out of range for " + target + ": " + digits);
+        };
+        if (value.kind() == entity_t::BIGINT) {
+            out_of_range(value.get<types::bigint_t>().to_string());
+        }
+        expect(entity_t::INT);
+        auto result = value.get<types::int_t>();
+        if (not std::in_range<T>(result)) {
+            out_of_range(std::to_string(result));
+        }
+        return T(result);
+    }
+    else if constexpr (std::floating_point<T>) {
+        if (value.kind() != entity_t::INT && value.kind() != entity_t::BIGINT) {
+            expect(entity_t::REAL);
+        }
+        return T(types::real_t(value));
+    }
+    else if constexpr (std::same_as<T, std::string>) {
+        expect(entity_t::STR);
+        return value.get<types::str_t>().str();
+    }
+    else if constexpr (std::same_as<T, std::string_view>) {
+        expect(entity_t::STR);
+        return value.get<types::str_t>().view();
+    }
+    else if constexpr (std::same_as<T, char const*>) {
+        expect(entity_t::STR);
+        return value.get<types::str_t>().data();
+    }
+    else {
+        expect(entity_t::LIST);
+        auto result = T();
+        result.reserve(value.get<types::list_t>().size());
+        for (auto const& elem : value.get<types::list_t>()) {
+            result.push_back(from_entity<typename T::value_type>(elem));
+        }
+        return result;
+    }
+}
+
+/**
+ * @brief An interpreter embedded in a C++ host, so that scripts run in-process instead of in a ysh
+ * process of their own. It's reusable: its variables persist from one call to the next, and the
+ * expressions it evaluates are compiled once per thread (see expression_cache). Each instance has its
+ * own @ref interpreter, so instances on different threads run independently; a single instance must
+ * only be used by one thread at a time.
+ * @code
+ * auto ysh = ysh::embedded_interpreter();
+ * ysh.define("scale", [](double x) { return x * 2.5; });
+ * ysh.set("xs", std::vector { 1, 2, 3 });
+ * auto total = ysh.evaluate<double>("sum $ (map $ (scale, xs))");
+ * @endcode
+ */
+class embedded_interpreter {
+public:
+    embedded_interpreter() = default;
+
+    embedded_interpreter(embedded_interpreter const&) = delete;
+
+    embedded_interpreter& operator =(embedded_interpreter const&) = delete;
+
+    /**
+     * @brief Evaluate an expression (without the surrounding parentheses). Variables it assigns are
+     * kept for the following calls.
+     * @throws error_t if the expression is malformed.
+     */
+    entity_t evaluate(std::string_view expr);
+
+    template<marshallable T>
+    T evaluate(std::string_view expr) {
+        static_assert(not borrows_entity<T>(), "the result would refer into a value that's gone: use std::string");
+        return from_entity<T>(this->evaluate(expr));
+    }
+
+    /**
+     * @brief Tokenize a script line (see @ref ysh::tokenize). The tokens are views into @param line.
+     */
+    [[nodiscard]]
+    std::vector<std::pair<token_t, input_t>> tokenize(std::string_view line) const;
+
+    /**
+     * @brief Run a shell on this interpreter, streaming from @param is and to @param os.
+     */
+    int run(std::istream& is, std::ostream& os);
+
+    /**
+     * @brief Run the script at @param path from its compiled form (see script_cache.hpp).
+     */
+    int run(stdf::path const& path, std::ostream& os);
+
+    void set(std::string_view name, entity_t value);
+
+    template<marshallable T>
+    void set(std::string_view name, T const& value) {
+        this->set(name, to_entity(value));
+    }
+
+    /**
+     * @brief The value of a variable set by the host or by a script, if any.
+     */
+    [[nodiscard]]
+    std::optional<entity_t> get(std::string_view name) const;
+
+    /**
+     * @brief Make a host function callable from scripts as @param name. Its arguments and result are
+     * converted with @ref from_entity and @ref to_entity; a function taking several arguments is called
+     * with a tuple, as the built-ins are. Exceptions thrown by the function, and arguments that don't
+     * convert, become Errors. Arguments taken as views, e.g. std::string_view, are valid for the call.
+     */
+    template<typename R, typename... Args>
+        requires (marshallable<std::remove_cvref_t<Args>> && ...)
+    void define(std::string_view name, std::function<R (Args...)> func) {
+        this->set(name, entity_t(types::func_t([func = std::move(func)](entity_t args) -> entity_t {
+            try {
+                auto elems = types::list_t();
+                if constexpr (sizeof...(Args) == 1) {
+                    elems.push_back(std::move(args));
+                }
+                else if constexpr (sizeof...(Args) > 1) {
+                    if (args.kind() != entity_t::TUPLE || (elems = types::list_t(args)).size() != sizeof...(Args)) {
+                        return types::standard_error("Expected a tuple of " + std::to_string(sizeof...(Args)) + " arguments");
+                    }
+                }
+                return [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+                    if constexpr (std::is_void_v<R>) {
+                        func(from_entity<std::remove_cvref_t<Args>>(elems[Is])...);
+                        return entity_t(types::tuple_t());
+                    }
+                    else {
+                        return to_entity(func(from_entity<std::remove_cvref_t<Args>>(elems[Is])...));
+                    }
+                }(std::index_sequence_for<Args...>());
+            }
+            catch (std::exception const& e) {
+                return types::standard_error(e.what());
+            }
+        })));
+    }
+
+    template<typename F>
+    void define(std::string_view name, F func) {
+        this->define(name, std::function(std::move(func)));
+    }
+
+    [[nodiscard]]
+    interpreter& state() noexcept {
+        return m_session;
+    }
+
+private:
+    /**
+     * @brief A name owned by this instance, since the variables are keyed by views.
+     */
+    input_t intern(std::string_view name);
+
+    interpreter m_session;
+    std::unordered_set<std::string> m_names;
+};
+
+} // namespace ysh
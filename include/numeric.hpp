@@ -0,0 +1,37 @@
+#pragma once
+
+#include "entity.hpp"
+
+namespace ysh {
+
+/**
+ * @brief The length of the numeric literal at the start of @param text, which must start with a digit.
+ * This only finds where the literal ends; @ref parse_number tells whether it's well-formed.
+ */
+std::size_t number_length(std::string_view text);
+
+/**
+ * @brief Parse a numeric literal in a single pass. Accepted forms:
+ * @code 42  1_000_000  0x7fff_ffff  0b1010  0o755  3.14  6.02e23  1e-9 @endcode
+ * with an optional sign. Underscores may only separate digits. An integer becomes an Int, promoted
+ * to an arbitrary-precision one if it doesn't fit in int_t; a literal with a fraction or an exponent
+ * becomes a Real (long double).
+ *
+ * @param text The literal.
+ * @return entity_t
+ * @throws error_t (a grammar error) if @param text is not a numeric literal.
+ */
+entity_t parse_number(std::string_view text);
+
+/**
+ * @brief Format a Real as the shortest text that parses back to the same value. The text always
+ * reads as a Real, e.g. 2 is formatted as "2.0" rather than "2".
+ */
+std::string format_real(types::real_t value);
+
+/**
+ * @brief Format an Int in base 10.
+ */
+std::string format_int(types::int_t value);
+
+} // namespace ysh
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "prelude.hpp"
+
+namespace ysh {
+
+/**
+ * @brief The number of elements below which the bulk algorithms don't bother with threads.
+ */
+inline constexpr std::size_t k_parallel_threshold = 1 << 15;
+
+/**
+ * @brief The shared pool of worker threads, one fewer than the hardware threads, since the thread
+ * handing out work takes part in it too. Workers are started on first use.
+ */
+class thread_pool {
+public:
+    using task_type = std::function<void ()>;
+
+    static thread_pool& instance();
+
+    thread_pool(thread_pool const&) = delete;
+
+    thread_pool& operator =(thread_pool const&) = delete;
+
+    ~thread_pool();
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return m_workers.size();
+    }
+
+    void submit(task_type task);
+
+private:
+    explicit thread_pool(std::size_t size);
+
+    void work(std::stop_token token);
+
+    std::mutex m_mutex;
+    std::condition_variable_any m_ready;
+    std::deque<task_type> m_tasks;
+    std::vector<std::jthread> m_workers;
+};
+
+/**
+ * @brief Call @param func on every index in [0, @param count), on the pool and the current thread. The
+ * current thread keeps taking indices until there are none left, so it never waits for a worker that
+ * hasn't started, and parallel_for may be called from inside @param func.
+ * @throws The first exception thrown by @param func, once all the calls have returned.
+ */
+void parallel_for(std::size_t count, std::function<void (std::size_t)> const& func);
+
+/**
+ * @brief How many chunks to split @param size elements into: 1 below k_parallel_threshold, else one per
+ * thread.
+ */
+[[nodiscard]]
+std::size_t parallel_chunks(std::size_t size) noexcept;
+
+/**
+ * @brief Sort [@param first, @param last) by sorting chunks in parallel, then merging them pairwise in
+ * parallel rounds. The merges are stable, so the whole sort is stable if @param sort is.
+ */
+template<std::random_access_iterator It, typename Compare>
+void parallel_sort(It first, It last, Compare comp, auto sort) {
+    auto const size = std::size_t(last - first);
+    auto const chunks = parallel_chunks(size);
+    auto const bound = [=](std::size_t chunk) {
+        return first + std::ptrdiff_t(size * chunk / chunks);
+    };
+    parallel_for(chunks, [&](std::size_t chunk) {
+        sort(bound(chunk), bound(chunk + 1), comp);
+    });
+    for (auto width = 1uz; width < chunks; width *= 2) {
+        parallel_for((chunks + 2 * width - 1) / (2 * width), [&](std::size_t pair) {
+            auto lo = pair * 2 * width;
+            auto mid = std::min(lo + width, chunks);
+            auto hi = std::min(lo + 2 * width, chunks);
+            std::inplace_merge(bound(lo), bound(mid), bound(hi), comp);
+        });
+    }
+}
+
+template<std::random_access_iterator It, typename Compare = std::less<>>
+void parallel_sort(It first, It last, Compare comp = {}) {
+    parallel_sort(first, last, comp, [](It lo, It hi, Compare const& cmp) {
+        std::sort(lo, hi, cmp);
+    });
+}
+
+template<std::random_access_iterator It, typename Compare = std::less<>>
+void parallel_stable_sort(It first, It last, Compare comp = {}) {
+    parallel_sort(first, last, comp, [](It lo, It hi, Compare const& cmp) {
+        std::stable_sort(lo, hi, cmp);
+    });
+}
+
+/**
+ * @brief Fold each chunk of @param elems with @param fold (given the first element of the chunk and the
+ * rest), in parallel, then fold the results of the chunks in order with @param combine.
+ * @pre not elems.empty()
+ */
+template<typename T, typename Fold, typename Combine>
+auto parallel_reduce(std::span<T> elems, Fold fold, Combine combine) {
+    using result_type = std::invoke_result_t<Fold, T&, std::span<T>>;
+    auto const chunks = std::min(parallel_chunks(elems.size()), elems.size());
+    auto results = std::vector<std::optional<result_type>>(chunks);
+    parallel_for(chunks, [&](std::size_t chunk) {
+        auto lo = elems.size() * chunk / chunks;
+        auto hi = elems.size() * (chunk + 1) / chunks;
+        results[chunk].emplace(fold(elems[lo], elems.subspan(lo + 1, hi - lo - 1)));
+    });
+    auto result = std::move(*results[0]);
+    for (auto chunk = 1uz; chunk < chunks; ++chunk) {
+        result = combine(std::move(result), std::move(*results[chunk]));
+    }
+    return result;
+}
+
+} // namespace ysh
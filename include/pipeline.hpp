@@ -0,0 +1,212 @@
+#pragma once
+
+#include "channel.hpp"
+#include "ysh.hpp"
+
+namespace ysh {
+
+/**
+ * @brief A stage of a pipeline: a command and its (ungrouped) arguments, as passed to @ref execute.
+ */
+struct pipeline_stage_t {
+    input_t command;
+    std::vector<input_t> args;
+};
+
+/**
+ * @brief The values passed from a stage of a pipeline to the next one, read in the order they were
+ * written. Values pass as they are: nothing is rendered or parsed on the way. A pipe is one of:
+ * - a List the stages fill and read one after the other;
+ * - an end of a channel between stages running side by side on threads of their own;
+ * - the values a generator yields, e.g. those of Func stages, computed as they're read;
+ * - a sink taking each value as it's written, e.g. to render it at the end of the pipeline.
+ * A pipe that's destroyed is done with: the read end of a channel hangs up, and the write end closes
+ * it, so that neither side waits for the other one forever.
+ */
+class object_pipe {
+public:
+    using channel_type = spsc_channel<entity_t>;
+    /**
+     * @brief Takes a value written to the pipe, and returns whether it takes more.
+     */
+    using sink_type = std::function<bool (entity_t)>;
+
+    enum end_type {
+        READ_END, WRITE_END
+    };
+
+    object_pipe() = default;
+
+    explicit object_pipe(types::list_t values) noexcept
+        : m_state(buffer_t { .values = std::move(values), .next = 0 }) {}
+
+    /**
+     * @brief An end of @param channel: the pipe reads from it or writes to it, as @param end says.
+     */
+    object_pipe(std::shared_ptr<channel_type> channel, end_type end) noexcept
+        : m_state(channel_end_t { .channel = std::move(channel), .end = end }) {}
+
+    explicit object_pipe(generator<entity_t> values) noexcept
+        : m_state(generated_t { .values = std::move(values) }) {}
+
+    explicit object_pipe(sink_type sink) noexcept
+        : m_state(std::move(sink)) {}
+
+    object_pipe(object_pipe&& other) noexcept = default;
+
+    object_pipe& operator =(object_pipe&& other) noexcept {
+        std::swap(m_state, other.m_state);
+        return *this;
+    }
+
+    ~object_pipe();
+
+    /**
+     * @brief Pass @param value on, waiting for the next stage to catch up if it's running behind.
+     * @return bool Whether the next stage still reads values. Once it doesn't, there's no point in
+     * writing more.
+     */
+    bool write(entity_t value);
+
+    /**
+     * @brief Whether the next stage still reads values, for a stage that would rather not wait for its
+     * writes to fail, e.g. one that only writes now and then.
+     */
+    [[nodiscard]]
+    bool reading() const noexcept;
+
+    /**
+     * @brief The next value, waiting for the previous stage to write it if need be, or nothing once
+     * every value was read.
+     */
+    std::optional<entity_t> read();
+
+    /**
+     * @brief Whether a value can be read right away, i.e. @ref read won't wait for one. It may still
+     * be false when one can.
+     */
+    [[nodiscard]]
+    bool ready() const noexcept;
+
+    /**
+     * @brief Read every value left.
+     */
+    types::list_t drain();
+
+    /**
+     * @brief Read no more: the previous stage sees its writes fail, and @ref read returns nothing from
+     * now on.
+     */
+    void hang_up() noexcept;
+
+private:
+    // Value-initialized, i.e. read from the start: a default member initializer would keep the pipe
+    // from being default-constructible within its own definition.
+    struct buffer_t {
+        types::list_t values;
+        std::size_t next;
+    };
+
+    struct channel_end_t {
+        std::shared_ptr<channel_type> channel;
+        end_type end;
+    };
+
+    struct generated_t {
+        generator<entity_t> values;
+        generator<entity_t>::iterator next {};
+        bool started = false;
+    };
+
+    std::variant<buffer_t, channel_end_t, generated_t, sink_type> m_state;
+};
+
+/**
+ * @brief The values the previous stage of the pipeline passed to the command running on the current
+ * thread. An in-process command (see plugin.hpp) reads them from here instead of std::cin.
+ */
+object_pipe& local_input();
+
+/**
+ * @brief Where the command running on the current thread writes its values for the next stage. What it
+ * prints to @ref local_stdout instead is passed on too, one Str per line, after the values (see
+ * @ref execute).
+ */
+object_pipe& local_output();
+
+/**
+ * @brief Where the command running on the current thread prints text, rather than std::cout, which
+ * every thread shares. Outside of a pipeline, it writes to the standard output.
+ */
+std::ostream& local_stdout();
+
+/**
+ * @brief Whether the in-process commands of a pipeline run side by side (see @ref execute). They only
+ * gain from it if there's more than one core to run them on: on a single one, passing values through a
+ * channel just costs more than passing a List.
+ */
+inline std::atomic<bool> g_side_by_side = std::thread::hardware_concurrency() > 1;
+
+/**
+ * @brief Render @param value as text for an external process or the terminal: Strs as they are, other
+ * scalars as operator str_t() formats them, Lists and Tuples as their elements separated by tabs, and
+ * Dicts and Seqs as an element (or a key and its value) per line.
+ */
+void render(entity_t const& value, std::ostream& os);
+
+/**
+ * @brief Run a pipeline, e.g. the stages of @code ls | sort | take (3) | wc -l @endcode
+ * Each stage is one of:
+ * - an in-process command (see @ref execute), which reads and writes values with @ref local_input and
+ *   @ref local_output;
+ * - a Func, i.e. a built-in function or a variable holding one, applied to a Seq of the values coming
+ *   in, after the values of its arguments if it has any: take (3) above evaluates take $ (3, values).
+ *   The Seq reads the values as the Func passes over it, so take stops reading after three of them,
+ *   and it only reads them once. A List or Seq the Func returns is passed on element by element,
+ *   anything else as one value. A name is only taken for a Func past the first stage and without
+ *   options (-r, say), so that sort -r and seq 1 5 still run the external commands; /usr/bin/sort
+ *   always does. await, which names no command, is a Func in the first stage too, where it's applied
+ *   to its arguments only;
+ * - an external command, run on a new process.
+ * Values pass from stage to stage as they're written. They're only rendered as text (see @ref render)
+ * for an external stage, or at the end of the pipeline, as they come out of it; the output of an
+ * external stage becomes values, one Str per line, as it's printed, for a stage that isn't external.
+ * Adjacent external stages run side by side, connected by pipes, supervised by an event loop (see
+ * event_loop.hpp): that of the current thread if they end the pipeline, or else that of a thread of
+ * their own, which passes their lines on. Adjacent Func stages run as one: each is applied to what the
+ * one before returned, so that map, filter and take add stages to a single Seq (see seq_t), generated
+ * in one loop by whatever reads its values, on its thread. In-process commands run side by side, each
+ * on a thread of its own, passing values through channels (see channel.hpp), if @ref g_side_by_side
+ * says so; otherwise, each one runs to its end before the stage after it reads its values. A stage that
+ * ends closes its side of the channels, so the one after it sees the end of its input, and the one
+ * before it sees its writes fail: an external command then gets SIGPIPE. Either way, a stage passes on
+ * the same values. While the stages run, they may read the session (see @ref interpreter), but not
+ * change it.
+ *
+ * @param os Where the values out of the last stage are rendered, one per line. An external last stage
+ * writes to the standard output itself.
+ * @return int The exit code of the last stage.
+ */
+int execute(std::vector<pipeline_stage_t> const& stages, std::ostream& os);
+
+/**
+ * @brief Run a command line of the shell, i.e. pipelines separated by ; tokens, one after the other,
+ * each with its stages separated by | tokens. Lines that don't start with a name (say, comments) aren't
+ * commands, and are left alone.
+ * A pipeline of the form @code async name { commands } @endcode doesn't wait for the commands: it
+ * starts running them on a thread of their own, in a copy of the session, and binds name to a Future
+ * of the values out of their last pipeline right away. The Future is waited for only when the values
+ * are needed, e.g. by @code await name | sort @endcode or await $ name in an expression, so slow
+ * commands started one after the other overlap:
+ * @code async a { ssh host1 uptime } ; async b { ssh host2 uptime } ; await a ; await b @endcode
+ * The commands of a block write to the standard output whatever isn't part of its value, and can pass
+ * values back through a Chan they share with the session (see chan_t).
+ * A pipeline of the form @code let name value @endcode binds name in the variables of the session to
+ * the value of value, evaluated as an argument of a Func stage is, e.g.
+ * @code let limit (60 * 60) ; let twice ("x" -> "x + x") ; echo (twice $ limit) @endcode
+ *
+ * @return std::optional<int> The exit code of the last pipeline, if the line is a command line.
+ */
+std::optional<int> execute(std::vector<std::pair<token_t, input_t>> const& tokens, std::ostream& os);
+
+} // namespace ysh
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ysh.hpp"
+
+namespace ysh {
+
+/**
+ * @brief What a plugin adds commands to: the interpreter loading it.
+ */
+class plugin_registry {
+public:
+    explicit plugin_registry(interpreter& session) noexcept
+        : m_session(session) {}
+
+    /**
+     * @brief Add the command @param name, run in-process by @ref execute. Its options are bound by
+     * @ref prepare with @param options before it runs, so it reads them back with @ref local_options
+     * and @ref local_arguments, as the built-in commands do. In a pipeline, it exchanges values with the
+     * stages next to it through @ref local_input and @ref local_output, and prints text to
+     * @ref local_stdout (see pipeline.hpp).
+     * The names must outlive the plugin (string literals do: plugins are never unloaded).
+     */
+    void add(input_t name, command_t command, optmap_t options = {});
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return m_added;
+    }
+
+private:
+    interpreter& m_session;
+    std::size_t m_added = 0;
+};
+
+/**
+ * @brief The signature of the entry point of a plugin. A plugin is a shared object exporting it with C
+ * linkage under the name @ref k_plugin_entry, e.g.
+ * @code
+ * extern "C" void ysh_plugin(ysh::plugin_registry& registry) {
+ *     registry.add("greet", greet_main, { { "name", 'n' } });
+ * }
+ * @endcode
+ * Plugins call back into ysh (say, local_arguments), so the executable must export its symbols
+ * (-rdynamic), and the plugin must be built with the same compiler and standard library.
+ */
+using plugin_entry_t = void (*)(plugin_registry&);
+
+inline constexpr auto k_plugin_entry = "ysh_plugin";
+
+/**
+ * @brief Load the plugin at @param path into the current interpreter. The plugin stays loaded for the
+ * rest of the process; loading it again only registers its commands again.
+ *
+ * @return std::size_t The number of commands added.
+ * @throws error_t if the plugin can't be loaded or has no entry point.
+ */
+std::size_t load_plugin(stdf::path const& path);
+
+} // namespace ysh
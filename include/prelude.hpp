@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <any>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <bitset>
 #include <charconv>
 #include <chrono>
@@ -10,6 +12,7 @@
 #include <compare>
 #include <complex>
 #include <concepts>
+#include <condition_variable>
 #include <coroutine>
 #include <cstdint>
 #include <cstdlib>
@@ -81,7 +84,7 @@ struct is_contained_by<T, std::variant<Head, Tail...>>
 } // namespace detail
 
 template<typename T, typename U>
-concept not_of = !std::same_as<T, std::decay_t<U>>;
+concept not_of = !std::same_as<std::decay_t<T>, std::decay_t<U>>;
 
 template<typename F, typename T>
 concept returning = requires(F f) {
@@ -91,40 +94,111 @@ concept returning = requires(F f) {
 template<typename T, typename Variant>
 concept contained_by = detail::is_contained_by<T, Variant>::value;
 
+/**
+ * @brief A lazy, single-pass sequence of values produced by a coroutine. The coroutine runs until
+ * its next co_yield only when the consumer advances, so nothing is computed ahead of time.
+ * @tparam T The type of the yielded values. It may be incomplete where the generator is declared.
+ */
 template<typename T>
 class generator {
 public:
     struct promise_type {
-        int value;
+        // The yielded object lives until the coroutine is resumed, so its address is all we need.
+        T const* value = nullptr;
 
-        std::suspend_always initial_suspend() {
+        std::suspend_always initial_suspend() noexcept {
             return {};
         }
 
-        std::suspend_always final_suspend() {
+        std::suspend_always final_suspend() noexcept {
             return {};
         }
 
-        generator get_return_object() {
-            return { handle_type::from_promise(*this) };
+        generator get_return_object() noexcept {
+            return generator(handle_type::from_promise(*this));
         }
 
+        [[noreturn]]
         void unhandled_exception() {
             throw;
         }
 
-        void return_void() {}
+        void return_void() noexcept {}
 
-        std::suspend_always yield_value(int val) {
-            value = val;
+        std::suspend_always yield_value(T const& val) noexcept {
+            value = std::addressof(val);
             return {};
         }
+
+        template<typename U>
+        void await_transform(U&&) = delete;
     };
 
     using handle_type = std::coroutine_handle<promise_type>;
 
+    class iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() noexcept = default;
+
+        explicit iterator(handle_type h) noexcept
+            : m_handle(h) {}
+
+        T const& operator *() const noexcept {
+            return *m_handle.promise().value;
+        }
+
+        iterator& operator ++() {
+            m_handle.resume();
+            return *this;
+        }
+
+        void operator ++(int) {
+            ++*this;
+        }
+
+        friend bool operator ==(iterator const& it, std::default_sentinel_t) noexcept {
+            return not it.m_handle || it.m_handle.done();
+        }
+
+    private:
+        handle_type m_handle;
+    };
+
+    generator(generator const&) = delete;
+
+    generator(generator&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    generator& operator =(generator other) noexcept {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+
+    ~generator() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    /**
+     * @brief Run the coroutine up to its first value. Only call this once.
+     */
+    iterator begin() {
+        if (m_handle) {
+            m_handle.resume();
+        }
+        return iterator(m_handle);
+    }
+
+    std::default_sentinel_t end() const noexcept {
+        return {};
+    }
+
 private:
-    generator(handle_type h)
+    explicit generator(handle_type h) noexcept
         : m_handle(h) {}
 
     handle_type m_handle;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "prelude.hpp"
+
+namespace ysh::types {
+
+/**
+ * @brief The string type in ysh, represented as a rope. Concatenating two long strings makes a node
+ * pointing to both instead of copying them, so building a string piece by piece is amortized O(1)
+ * per piece. Short pieces appended to a rope are merged into its last chunk, so a rope has about
+ * one node per k_chunk_size characters however it was built.
+ * The characters are only laid out contiguously when they are needed as such (see @ref view), and
+ * the result is cached in the node. Strings are immutable, so copies share everything.
+ */
+class str_t {
+public:
+    /**
+     * @brief Strings up to this size are always stored flat.
+     */
+    static constexpr std::size_t k_chunk_size = 256;
+
+    str_t() noexcept = default;
+
+    str_t(std::string value);
+
+    str_t(std::string_view value);
+
+    str_t(char const* value);
+
+    /**
+     * @brief Repeat a string, allocating the result once.
+     */
+    static str_t repeat(str_t const& unit, std::size_t count);
+
+    [[nodiscard]]
+    std::size_t size() const noexcept;
+
+    [[nodiscard]]
+    bool empty() const noexcept {
+        return this->size() == 0;
+    }
+
+    /**
+     * @brief The characters of the string, flattening it if it's a concatenation. The view is valid as
+     * long as this string (or a copy of it) is alive.
+     */
+    [[nodiscard]]
+    std::string_view view() const;
+
+    /**
+     * @brief Same as view().data(). The characters are followed by a '\0'.
+     */
+    [[nodiscard]]
+    char const* data() const {
+        return this->view().data();
+    }
+
+    [[nodiscard]]
+    std::string str() const {
+        return std::string(this->view());
+    }
+
+    friend str_t operator +(str_t const& lhs, str_t const& rhs);
+
+    friend bool operator ==(str_t const& lhs, str_t const& rhs);
+
+    friend std::strong_ordering operator <=>(str_t const& lhs, str_t const& rhs);
+
+    /**
+     * @brief Write the string piece by piece, without flattening it.
+     */
+    friend std::ostream& operator <<(std::ostream& os, str_t const& str);
+
+private:
+    struct node;
+
+    using node_ptr = std::shared_ptr<node const>;
+
+    explicit str_t(node_ptr node) noexcept
+        : m_node(std::move(node)) {}
+
+    /**
+     * @brief Call @param func on each flat piece of the string, in order.
+     */
+    void for_each_piece(std::invocable<std::string_view> auto&& func) const;
+
+    node_ptr m_node;    // nullptr for the empty string
+};
+
+} // namespace ysh::types
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "expression.hpp"
+#include "serialize.hpp"
+
+namespace ysh {
+
+/**
+ * @brief A script compiled ahead of running it: its lines (with continuations joined), the tokens of
+ * each line and the compiled form of each expression token.
+ * The compiled form is cached in the binary format (see serialize.hpp) under __yshcache__ next to the
+ * script, stamped with the path, size, modification time and content hash of the script. As long as
+ * the script is unchanged, loading it is a single mmap of the cache: the tokens and the names in the
+ * compiled expressions are views into the mapping, and nothing is tokenized or compiled again.
+ */
+class compiled_script {
+public:
+    static constexpr auto k_cache_dir = "__yshcache__";
+
+    /**
+     * @brief Load the script at @param path from its cache if it's up to date, or compile it and
+     * write the cache otherwise. A cache that can't be written is silently skipped.
+     * @throws error_t if the script can't be read.
+     */
+    explicit compiled_script(stdf::path const& path);
+
+    // The tokens are views into the script, so it stays where it is.
+    compiled_script(compiled_script const&) = delete;
+
+    compiled_script& operator =(compiled_script const&) = delete;
+
+    /**
+     * @brief The number of lines.
+     */
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return m_lines.size() - 1;
+    }
+
+    /**
+     * @brief Whether the script was loaded from its cache rather than compiled.
+     */
+    [[nodiscard]]
+    bool cached() const noexcept {
+        return m_cached;
+    }
+
+    /**
+     * @brief The tokens of the line @param line, as @ref tokenize would have split it.
+     * @throws std::runtime_error as @ref tokenize does, if the line couldn't be tokenized.
+     */
+    [[nodiscard]]
+    std::vector<std::pair<token_t, input_t>> tokens(std::size_t line) const;
+
+    /**
+     * @brief Whether running the script may do anything a session snapshot can't restore (see
+     * session.hpp), e.g. print or run a command. Only lines starting with a name run (see
+     * @ref execute), so comments, blank lines and bare expressions have no effects, and neither have
+     * let lines computing a value without applying a Func, other than plugin to load a plugin.
+     */
+    [[nodiscard]]
+    bool has_effects() const;
+
+    /**
+     * @brief Add the compiled expressions of the script to @param cache, so that evaluating them
+     * doesn't compile them again. The entries are copies, which don't refer to the script.
+     */
+    void prime(expression_cache& cache) const;
+
+    /**
+     * @brief Where the compiled form of the script at @param path is cached.
+     */
+    static stdf::path cache_path(stdf::path const& path);
+
+private:
+    void attach(std::string_view data);
+
+    std::optional<mapped_file> m_file;
+    std::string m_buffer;
+    bool m_cached = false;
+
+    std::string_view m_text;
+    std::span<types::int_t const> m_lines;
+    std::span<types::int_t const> m_tokens;
+    std::vector<std::pair<input_t, expression_t>> m_expressions;
+};
+
+/**
+ * @brief Load the script at @param path (see @ref compiled_script).
+ */
+std::shared_ptr<compiled_script const> load_script(stdf::path const& path);
+
+/**
+ * @brief Run a compiled script, streaming to @param os. A line that fails is reported on stderr, and
+ * the lines after it still run.
+ */
+int shell(compiled_script const& script, std::ostream& os);
+
+} // namespace ysh
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "entity.hpp"
+
+namespace ysh {
+
+/**
+ * @brief A read-only view of a file mapped into memory. The file is never read as a whole: pages are
+ * loaded by the kernel as the bytes are touched.
+ */
+class mapped_file {
+public:
+    /**
+     * @throws error_t if the file can't be opened or mapped.
+     */
+    explicit mapped_file(stdf::path const& path);
+
+    mapped_file(mapped_file&& other) noexcept;
+
+    mapped_file& operator =(mapped_file&& other) noexcept;
+
+    ~mapped_file();
+
+    [[nodiscard]]
+    std::string_view bytes() const noexcept {
+        return { static_cast<char const*>(m_data), m_size };
+    }
+
+private:
+    void* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+/**
+ * @brief A record of the binary entity format, read in place.
+ * An encoded buffer is a 16-byte header (magic, version, and the layout of Reals) followed by the
+ * root record. Every record starts 8-aligned with its tag, and its children come after it:
+ * - Int: the value. Real: the value, as laid out in memory. Int (bigint): the sign and the limbs.
+ * - Str, Error: the length, then the characters.
+ * - List, Tuple: the count, then the offsets of the elements, so that any of them is reached in O(1).
+ * - Dict: the count, then the offsets of the keys and values, in pairs.
+ * - Lists of Ints only, or of Reals only: the count, then the values as a contiguous array, which can
+ *   be used directly from the buffer (see @ref ints and @ref reals).
+ * Reading a record only touches the bytes of that record, so a large mapped file costs nothing until
+ * the parts that are needed are read.
+ */
+class record_view {
+public:
+    enum tag_type : std::uint32_t {
+        INT = 1, REAL, BIGINT, STR, ERROR, LIST, TUPLE, DICT, INT_ARRAY, REAL_ARRAY
+    };
+
+    /**
+     * @brief The root record of an encoded buffer. The buffer must outlive the view and everything read
+     * from it.
+     * @throws error_t if the header is invalid.
+     */
+    static record_view root(std::string_view data);
+
+    [[nodiscard]]
+    tag_type tag() const noexcept {
+        return m_tag;
+    }
+
+    /**
+     * @brief The kind of entity the record decodes to. Arrays decode to Lists.
+     */
+    [[nodiscard]]
+    entity_t::type kind() const noexcept;
+
+    /**
+     * @brief The number of elements of a List, Tuple or array, the number of bindings of a Dict, or the
+     * length of a Str or Error.
+     */
+    [[nodiscard]]
+    std::size_t size() const;
+
+    /**
+     * @brief The record of the element @param index of a List or Tuple, or, for a Dict, of the key
+     * (even indices) or value (odd indices) of the binding @param index / 2.
+     */
+    [[nodiscard]]
+    record_view child(std::size_t index) const;
+
+    /**
+     * @brief Decode the element @param index of a List, Tuple or array.
+     */
+    [[nodiscard]]
+    entity_t at(std::size_t index) const;
+
+    [[nodiscard]]
+    types::int_t as_int() const;
+
+    [[nodiscard]]
+    types::real_t as_real() const;
+
+    /**
+     * @brief The characters of a Str or an Error, in place.
+     */
+    [[nodiscard]]
+    std::string_view as_str() const;
+
+    /**
+     * @brief The elements of an array of Ints, in place.
+     */
+    [[nodiscard]]
+    std::span<types::int_t const> ints() const;
+
+    /**
+     * @brief The elements of an array of Reals, in place.
+     */
+    [[nodiscard]]
+    std::span<types::real_t const> reals() const;
+
+    /**
+     * @brief Decode the whole record.
+     */
+    [[nodiscard]]
+    entity_t to_entity() const;
+
+private:
+    record_view(std::string_view data, std::size_t offset);
+
+    std::string_view m_data;
+    std::size_t m_offset;
+    tag_type m_tag;
+};
+
+/**
+ * @brief Whether @param value can be encoded, i.e. neither is nor holds a Func, a Seq, a Chan or a
+ * Future.
+ */
+[[nodiscard]]
+bool serializable(entity_t const& value);
+
+/**
+ * @brief Encode an entity in the binary format.
+ * @throws error_t if the entity is or holds a Func, a Seq, a Chan or a Future.
+ */
+[[nodiscard]]
+std::string encode(entity_t const& value);
+
+/**
+ * @throws error_t if @param data isn't a valid encoding.
+ */
+[[nodiscard]]
+entity_t decode(std::string_view data);
+
+/**
+ * @brief Encode @param value into the file at @param path, replacing it atomically.
+ * @return std::size_t The size of the file.
+ */
+std::size_t save(stdf::path const& path, entity_t const& value);
+
+/**
+ * @brief Decode the file at @param path, mapping it rather than reading it.
+ */
+[[nodiscard]]
+entity_t load(stdf::path const& path);
+
+} // namespace ysh
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ysh.hpp"
+
+namespace ysh {
+
+/**
+ * @brief Save the state of the current interpreter into a session snapshot at @param path, in the
+ * binary format (see serialize.hpp), stamped with the size and modification time of each of
+ * @param sources, i.e. the scripts that were run to set it up. The state is the variables, the
+ * source of the Funcs written in the scripts (see abstraction_t), and the plugins loaded, whose
+ * commands are registered again by loading them again. A session can only be saved whole: if a
+ * variable holds any other Func, a Seq, a Chan or a Future (say, an ffi binding), or a command was
+ * registered other than by a plugin, no snapshot is taken, and the one at @param path is removed, so
+ * that the sources run again next time.
+ *
+ * @return std::size_t The size of the snapshot.
+ * @throws error_t if the snapshot can't be taken or written.
+ */
+std::size_t save_session(stdf::path const& path, std::vector<stdf::path> const& sources);
+
+/**
+ * @brief Restore the state of the current interpreter from the session snapshot at @param path, if it
+ * was taken after running exactly @param sources as they are now: the plugins are loaded again, the
+ * Funcs compiled again, and the variables bound. The snapshot is mapped for the rest of the process,
+ * and the names of the variables refer to it directly.
+ *
+ * @return bool Whether the snapshot was restored. If it wasn't (it's missing, stale or corrupt, or a
+ * plugin no longer loads), the sources have to be run again.
+ */
+bool restore_session(stdf::path const& path, std::vector<stdf::path> const& sources);
+
+} // namespace ysh
@@ -21,101 +21,110 @@ struct string : public std::string_view {
         : base_type(other) {}
 
     string(string const& other) noexcept
-        : base_type(other.data()) {}
+        : base_type(other) {}
 
     string& operator =(string const& other) noexcept {
         base_type::operator =(other);
         return *this;
     }
 
+    /**
+     * @brief Turn a position returned by std::string_view's find family into an iterator. A failed
+     * search (npos) yields the end iterator.
+     */
+    [[nodiscard]]
+    iterator_type to_iterator(size_type pos) const noexcept {
+        return pos == npos ? this->end() : this->begin() + pos;
+    }
+
     [[nodiscard]]
     iterator_type find(char c) const noexcept {
-        return this->begin() + this->base_type::find(c);
+        return this->to_iterator(base_type::find(c));
     }
 
     [[nodiscard]]
     iterator_type find(string const& str) const noexcept {
-        return this->begin() + this->base_type::find(str);
+        return this->to_iterator(base_type::find(str));
     }
 
     iterator_type find(char c, iterator_type pos) const noexcept {
-        return this->begin() + this->base_type::find(c, pos - this->begin());
+        return this->to_iterator(base_type::find(c, pos - this->begin()));
     }
 
     iterator_type find(string const& str, iterator_type pos) const noexcept {
-        return this->begin() + this->base_type::find(str, pos - this->begin());
+        return this->to_iterator(base_type::find(str, pos - this->begin()));
     }
 
     [[nodiscard]]
     iterator_type find_first_not_of(char c) const noexcept {
-        return this->begin() + this->base_type::find_first_not_of(c);
+        return this->to_iterator(base_type::find_first_not_of(c));
     }
 
     [[nodiscard]]
     iterator_type find_first_not_of(string const& str) const noexcept {
-        return this->begin() + this->base_type::find_first_not_of(str);
+        return this->to_iterator(base_type::find_first_not_of(str));
     }
 
     iterator_type find_first_not_of(char c, iterator_type pos) const noexcept {
-        return this->begin() + this->base_type::find_first_not_of(c, pos - this->begin());
+        return this->to_iterator(base_type::find_first_not_of(c, pos - this->begin()));
     }
 
     iterator_type find_first_not_of(string const& str, iterator_type pos) const noexcept {
-        return this->begin() + base_type::find_first_not_of(str, pos - this->begin());
+        return this->to_iterator(base_type::find_first_not_of(str, pos - this->begin()));
     }
 
     [[nodiscard]]
     iterator_type find_first_of(char c) const noexcept {
-        return this->begin() + this->base_type::find_first_of(c);
+        return this->to_iterator(base_type::find_first_of(c));
     }
 
     [[nodiscard]]
     iterator_type find_first_of(string const& str) const noexcept {
-        return this->begin() + this->base_type::find_first_of(str);
+        return this->to_iterator(base_type::find_first_of(str));
     }
 
     iterator_type find_first_of(char c, iterator_type pos) const noexcept {
-        return this->begin() + base_type::find_first_of(c, pos - this->begin());
+        return this->to_iterator(base_type::find_first_of(c, pos - this->begin()));
     }
 
     iterator_type find_first_of(string const& str, iterator_type pos) const noexcept {
-        return this->begin() + base_type::find_first_of(str, pos - this->begin());
+        return this->to_iterator(base_type::find_first_of(str, pos - this->begin()));
     }
 
     [[nodiscard]]
     iterator_type find_last_not_of(char c) const noexcept {
-        return this->begin() + this->base_type::find_last_not_of(c);
+        return this->to_iterator(base_type::find_last_not_of(c));
     }
 
     [[nodiscard]]
     iterator_type find_last_not_of(string const& str) const noexcept {
-        return this->begin() + this->base_type::find_last_not_of(str);
+        return this->to_iterator(base_type::find_last_not_of(str));
     }
 
     iterator_type find_last_not_of(char c, iterator_type pos) const noexcept {
-        return this->begin() + this->base_type::find_last_not_of(c, pos - this->begin());
+        return this->to_iterator(base_type::find_last_not_of(c, pos - this->begin()));
     }
 
     iterator_type find_last_not_of(string const& str, iterator_type pos) const noexcept {
-        return this->begin() + this->base_type::find_last_not_of(str, pos - this->begin());
+        return this->to_iterator(base_type::find_last_not_of(str, pos - this->begin()));
     }
 
     [[nodiscard]]
     iterator_type find_last_of(char c) const noexcept {
-        return this->begin() + this->base_type::find_last_of(c);
+        return this->to_iterator(base_type::find_last_of(c));
     }
 
     [[nodiscard]]
     iterator_type find_last_of(string const& str) const noexcept {
-        return this->begin() + this->base_type::find_last_of(str);
+        return this->to_iterator(base_type::find_last_of(str));
     }
 
     iterator_type find_last_of(char c, iterator_type pos) const noexcept {
-        return this->begin() + base_type::find_last_of(c, pos - this->begin());
+        return this->to_iterator(base_type::find_last_of(c, pos - this->begin()));
     }
 
     iterator_type find_last_of(string const& str, iterator_type pos) const noexcept {
-        return this->begin() + this->base_type::find_last_of(str, pos - this->begin());
+        return this->to_iterator(base_type::find_last_of(str, pos - this->begin()));
     }
 
     static material_type join(std::vector<string> words, string const& sep) {
@@ -184,10 +193,20 @@ struct string : public std::string_view {
         return { this->begin(), this->end() };
     }
 
+    /**
+     * @brief Parse the whole string as a number.
+     * @throws std::invalid_argument if it isn't a number, std::out_of_range if the number doesn't fit in T.
+     */
     template<arithmetic T>
     explicit operator T() const {
-        T result;
-        std::from_chars(this->begin(), this->end(), result);
+        auto result = T();
+        auto [ptr, ec] = std::from_chars(this->data(), this->data() + this->size(), result);
+        if (ec == std::errc::result_out_of_range) {
+            throw std::out_of_range("Number out of range: " + std::string(*this));
+        }
+        if (ec != std::errc() || ptr != this->data() + this->size()) {
+            throw std::invalid_argument("Not a number: " + std::string(*this));
+        }
         return result;
     }
 };
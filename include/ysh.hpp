@@ -31,7 +31,22 @@ using enum_t = unsigned long long;
  */
 using input_t = ::ysh::string;
 
-using env_t = std::unordered_map<input_t, entity_t>;
+/**
+ * @brief The generation of a variable. Every assignment stamps the variable with a fresh
+ * generation (unique across all environments), so anything derived from its value can
+ * tell whether it's still up to date by comparing generations.
+ */
+using generation_t = std::uint64_t;
+
+/**
+ * @brief A variable slot in an environment.
+ */
+struct variable_t {
+    entity_t value;
+    generation_t generation{};
+};
+
+using env_t = std::unordered_map<input_t, variable_t, typename input_t::hash>;
 
 /**
  * @brief Mapping long options to short ones based on the command being called.
@@ -73,6 +88,7 @@ enum builtin_operator_t : unsigned char {
     YSH_NE,     // !=
     YSH_OR,     // |
     YSH_POW,    // ^
+    YSH_RANGE,  // ..
     YSH_SEQ,    // ;
     YSH_SHL,    // <<
     YSH_SHR,    // >>
@@ -83,19 +99,61 @@ enum builtin_operator_t : unsigned char {
 inline ysh::string const k_alpha = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
 inline ysh::string const k_digits = "0123456789";
 inline ysh::string const k_alnum = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
-inline ysh::string const k_operators = "@$%^&*-+=|:<,>.?/";
-
-extern std::string g_line;
-extern bool g_is_running;
-extern std::mutex g_mutex;
-extern stdf::path g_current_path;
-extern std::unordered_map<input_t, command_t> g_command_map;
-extern env_t g_variables;
+inline ysh::string const k_operators = "!@$%^&*-+=|:;<,>.?/";
+
+/**
+ * @brief The state of a session. A thread runs on behalf of one interpreter at a time, the one bound
+ * to it by a @ref scope, so sessions on different threads share nothing but the built-ins and never
+ * contend with each other. Threads that haven't bound one share the default interpreter. The stages of
+ * a pipeline run on behalf of the session that runs it, on several threads at once (see @ref execute):
+ * while it runs, they may read the session, e.g. look up variables and commands, but not change it.
+ */
+class interpreter {
+public:
+    /**
+     * @brief Binds an interpreter to the current thread while it lives, and restores the one bound
+     * before when it's destroyed.
+     */
+    class scope {
+    public:
+        explicit scope(interpreter& session) noexcept;
+
+        scope(scope const&) = delete;
+
+        scope& operator =(scope const&) = delete;
+
+        ~scope();
+
+    private:
+        interpreter* m_previous;
+    };
+
+    interpreter();
+
+    interpreter(interpreter const&) = delete;
+
+    interpreter& operator =(interpreter const&) = delete;
+
+    /**
+     * @brief The interpreter bound to the current thread, or the default one.
+     */
+    static interpreter& current() noexcept;
+
+    stdf::path current_path;
+    std::unordered_map<input_t, command_t, typename input_t::hash> command_map;
+    // The options of the commands in command_map, for prepare.
+    std::unordered_map<input_t, optmap_t, typename input_t::hash> option_maps;
+    env_t variables;
+    // The plugins loaded, in order, and the commands they registered: loading them again registers
+    // those, as restoring a session snapshot does.
+    std::vector<stdf::path> plugins;
+    std::unordered_set<input_t, typename input_t::hash> plugin_commands;
+};
 inline std::unordered_set<input_t, typename input_t::hash> g_left_associative = {
-    "^", "*", "/", "%", "+", "-", "<", ">", "=", "!=", "<=", ">=", "&", "|", ",", ";"
+    "^", "*", "/", "%", "+", "++", "-", "..", "<", ">", "=", "!=", "<=", ">=", "&", "|", ";"
 };
 inline std::unordered_set<input_t, typename input_t::hash> g_right_associative = {
-    "$", ":", "<-", "->"
+    "$", ":", "<-", "->", ","
 };
 inline std::unordered_map<input_t, int, typename input_t::hash> g_precedence = {
     { "$", 100 },
@@ -103,7 +161,8 @@ inline std::unordered_map<input_t, int, typename input_t::hash> g_precedence = {
     { "<-", 85 },
     { "^", 80 },
     { "*", 70 }, { "/", 70 }, { "%", 70 },
-    { "+", 60 }, { "-", 60 },
+    { "+", 60 }, { "++", 60 }, { "-", 60 },
+    { "..", 55 },
     { "<", 50 }, { ">", 50 }, { "=", 50 }, { "!=", 50 }, { "<=", 50 }, { ">=", 50 },
     { "&", 40 }, { "|", 40 },
     { "<<", 30 }, { ">>", 30 },
@@ -114,11 +173,22 @@ inline std::unordered_map<input_t, int, typename input_t::hash> g_precedence = {
 
 
 /**
- * @brief Execute a single command, probably on a new process.
+ * @brief Assign a value to a variable, stamping it with a fresh generation.
+ *
+ * @param env The environment holding the variable.
+ * @param name The variable name.
+ * @param value The new value.
+ * @return entity_t const& The stored value.
+ */
+entity_t const& assign(env_t& env, input_t name, entity_t value);
+
+/**
+ * @brief Execute a single command. Commands of the current interpreter (e.g. added by plugins) run
+ * in-process, with their arguments bound by @ref prepare; anything else runs on a new process.
  * 
  * @param cmd A command name, which will be further processed in this function.
  * @param args The (ungrouped) arguments of the command, including options.
- * @return int Whether the execution is successfully carried out.
+ * @return int The exit code of the command.
  */
 int execute(input_t cmd, std::vector<input_t> const& args);
 
@@ -146,14 +216,15 @@ entity_t evaluate(input_t expr, env_t& env);
  */
 std::vector<input_t> forward_args(int argc, char* argv[]);
 
-auto function(input_t name) {
+inline auto function(input_t name) {
     static auto const fnmap = std::unordered_map<input_t, builtin_operator_t, typename input_t::hash> {
+        { "->", YSH_ABSTR },
         { "+",  YSH_ADD },
         { "&",  YSH_AND },
         { "$",  YSH_APP },
         { "<-", YSH_ASSIGN },
-        { ":",  YSH_CONCAT },
-        { ",",  YSH_CONS },
+        { "++", YSH_CONCAT },
+        { ":",  YSH_CONS },
         { "/",  YSH_DIV },
         { "=",  YSH_EQ },
         { ">=", YSH_GE },
@@ -165,10 +236,12 @@ auto function(input_t name) {
         { "!=", YSH_NE },
         { "|",  YSH_OR },
         { "^",  YSH_POW },
+        { "..", YSH_RANGE },
         { ";",  YSH_SEQ },
         { "<<", YSH_SHL },
         { ">>", YSH_SHR },
-        { "-",  YSH_SUB }
+        { "-",  YSH_SUB },
+        { ",",  YSH_ZIP }
     };
     return fnmap.at(name);
 }
@@ -209,6 +282,27 @@ std::vector<input_t>& local_arguments(char opt = '\0');
 
 std::vector<input_t>& local_arguments(enum_t opt);
 
+/**
+ * @brief Get the options of the command running on the current thread, as parsed by @ref prepare.
+ */
+enum_t& local_options();
+
+/**
+ * @brief Look a variable up, first in the given environment, then among the variables of the current
+ * interpreter and finally among the built-in functions.
+ *
+ * @param env The innermost environment.
+ * @param name The variable name.
+ * @return variable_t const* The variable slot, or nullptr if the variable is unbound.
+ */
+variable_t const* lookup(env_t const& env, input_t name);
+
+/**
+ * @brief Generate a fresh variable generation. Generations are strictly increasing, so a
+ * variable that has never been assigned (generation 0) is older than any assignment.
+ */
+generation_t next_generation() noexcept;
+
 /**
  * @brief Turn an option (as a character) to its enum_t form. For example, 'B' => 2, 'C' => 4
  * 
@@ -225,12 +319,22 @@ int order(char opt);
 
 std::ostream& output_stream(input_t name);
 
-void prepare(std::vector<input_t> const& args);
+/**
+ * @brief Parse the arguments of a command: options and packs are looked up in @param optmap (long
+ * ones by name, short ones by their character), the arguments of packs are bound to their options
+ * and the rest to the command itself (see @ref local_arguments). The options parsed are also kept
+ * for @ref local_options.
+ *
+ * @return enum_t The options parsed.
+ * @throws std::runtime_error if an option isn't in @param optmap.
+ */
+enum_t prepare(std::vector<input_t> const& args, optmap_t const& optmap);
 
 int run_separate_process(returning<int> auto&& program);
 
 /**
- * @brief Start a shell streaming from @param is and to @param os.
+ * @brief Start a shell streaming from @param is and to @param os. Each command line runs as
+ * pipelines separated by ; (see pipeline.hpp).
  * 
  * @param is The input stream.
  * @param os The output stream.
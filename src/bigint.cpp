@@ -0,0 +1,455 @@
+#include "../include/bigint.hpp"
+
+namespace ysh::types {
+
+using limb_type = bigint_t::limb_type;
+using wide_type = bigint_t::wide_type;
+using magnitude_type = bigint_t::magnitude_type;
+
+/**
+ * @brief Operands with fewer limbs than this are multiplied by the schoolbook method, which beats
+ * Karatsuba's bookkeeping on small inputs.
+ */
+static constexpr std::size_t k_karatsuba_threshold = 32;
+
+static constexpr int k_limb_bits = 32;
+
+static void trim(magnitude_type& mag) noexcept {
+    while (!mag.empty() && mag.back() == 0) {
+        mag.pop_back();
+    }
+}
+
+static std::strong_ordering compare(std::span<limb_type const> lhs, std::span<limb_type const> rhs) noexcept {
+    if (lhs.size() != rhs.size()) {
+        return lhs.size() <=> rhs.size();
+    }
+    for (auto i = lhs.size(); i-- > 0; ) {
+        if (lhs[i] != rhs[i]) {
+            return lhs[i] <=> rhs[i];
+        }
+    }
+    return std::strong_ordering::equal;
+}
+
+static magnitude_type add(std::span<limb_type const> lhs, std::span<limb_type const> rhs) {
+    if (lhs.size() < rhs.size()) {
+        std::swap(lhs, rhs);
+    }
+    auto result = magnitude_type(lhs.size() + 1);
+    auto carry = wide_type();
+    for (auto i = 0uz; i < lhs.size(); ++i) {
+        carry += wide_type(lhs[i]) + (i < rhs.size() ? rhs[i] : 0);
+        result[i] = limb_type(carry);
+        carry >>= k_limb_bits;
+    }
+    result.back() = limb_type(carry);
+    trim(result);
+    return result;
+}
+
+/**
+ * @pre lhs >= rhs
+ */
+static magnitude_type subtract(std::span<limb_type const> lhs, std::span<limb_type const> rhs) {
+    auto result = magnitude_type(lhs.size());
+    auto borrow = wide_type();
+    for (auto i = 0uz; i < lhs.size(); ++i) {
+        auto diff = wide_type(lhs[i]) - (i < rhs.size() ? rhs[i] : 0) - borrow;
+        result[i] = limb_type(diff);
+        borrow = diff >> 63;
+    }
+    trim(result);
+    return result;
+}
+
+/**
+ * @brief Add @param rhs into @param acc shifted by @param offset limbs. The accumulator must be large
+ * enough to hold the sum.
+ */
+static void add_into(magnitude_type& acc, std::span<limb_type const> rhs, std::size_t offset) {
+    auto carry = wide_type();
+    auto i = 0uz;
+    for (; i < rhs.size(); ++i) {
+        carry += wide_type(acc[offset + i]) + rhs[i];
+        acc[offset + i] = limb_type(carry);
+        carry >>= k_limb_bits;
+    }
+    for (; carry != 0; ++i) {
+        carry += acc[offset + i];
+        acc[offset + i] = limb_type(carry);
+        carry >>= k_limb_bits;
+    }
+}
+
+static magnitude_type multiply_schoolbook(std::span<limb_type const> lhs, std::span<limb_type const> rhs) {
+    auto result = magnitude_type(lhs.size() + rhs.size());
+    for (auto i = 0uz; i < lhs.size(); ++i) {
+        auto carry = wide_type();
+        for (auto j = 0uz; j < rhs.size(); ++j) {
+            carry += wide_type(lhs[i]) * rhs[j] + result[i + j];
+            result[i + j] = limb_type(carry);
+            carry >>= k_limb_bits;
+        }
+        result[i + rhs.size()] = limb_type(carry);
+    }
+    trim(result);
+    return result;
+}
+
+/**
+ * @brief Karatsuba multiplication: with x = x1 B + x0 and y = y1 B + y0,
+ * @code x y = z2 B^2 + (z1 - z2 - z0) B + z0, where z2 = x1 y1, z0 = x0 y0, z1 = (x1 + x0)(y1 + y0) @endcode
+ * which takes three half-size products instead of four.
+ */
+static magnitude_type multiply(std::span<limb_type const> lhs, std::span<limb_type const> rhs) {
+    if (lhs.size() < rhs.size()) {
+        std::swap(lhs, rhs);
+    }
+    if (rhs.empty()) {
+        return {};
+    }
+    if (rhs.size() < k_karatsuba_threshold) {
+        return multiply_schoolbook(lhs, rhs);
+    }
+
+    auto half = (lhs.size() + 1) / 2;
+    auto result = magnitude_type(lhs.size() + rhs.size() + 1);
+
+    // Lopsided operands: split the longer one only, and multiply each half by the shorter one.
+    if (rhs.size() <= half) {
+        add_into(result, multiply(lhs.first(half), rhs), 0);
+        add_into(result, multiply(lhs.subspan(half), rhs), half);
+        trim(result);
+        return result;
+    }
+
+    auto const split = [half](std::span<limb_type const> limbs) {
+        auto low = limbs.first(half);
+        while (!low.empty() && low.back() == 0) {
+            low = low.first(low.size() - 1);
+        }
+        return std::pair(low, limbs.subspan(half));
+    };
+    auto [x0, x1] = split(lhs);
+    auto [y0, y1] = split(rhs);
+
+    auto z0 = multiply(x0, y0);
+    auto z2 = multiply(x1, y1);
+    auto z1 = multiply(add(x0, x1), add(y0, y1));
+    z1 = subtract(subtract(z1, z0), z2);
+
+    add_into(result, z0, 0);
+    add_into(result, z1, half);
+    add_into(result, z2, 2 * half);
+    trim(result);
+    return result;
+}
+
+static limb_type divide_small(magnitude_type& mag, limb_type divisor) noexcept {
+    auto rem = wide_type();
+    for (auto i = mag.size(); i-- > 0; ) {
+        auto cur = (rem << k_limb_bits) | mag[i];
+        mag[i] = limb_type(cur / divisor);
+        rem = cur % divisor;
+    }
+    trim(mag);
+    return limb_type(rem);
+}
+
+static void multiply_add_small(magnitude_type& mag, limb_type factor, limb_type addend) {
+    auto carry = wide_type(addend);
+    for (auto& limb : mag) {
+        carry += wide_type(limb) * factor;
+        limb = limb_type(carry);
+        carry >>= k_limb_bits;
+    }
+    if (carry != 0) {
+        mag.push_back(limb_type(carry));
+    }
+}
+
+/**
+ * @brief Knuth's algorithm D (TAOCP 4.3.1), in the formulation of Hacker's Delight.
+ * @pre divisor has at least two limbs and dividend >= divisor
+ */
+static std::pair<magnitude_type, magnitude_type> divide_knuth(std::span<limb_type const> dividend, std::span<limb_type const> divisor) {
+    auto const m = dividend.size();
+    auto const n = divisor.size();
+    auto const shift = std::countl_zero(divisor.back());
+
+    // Normalize so that the top limb of the divisor has its highest bit set.
+    auto vn = magnitude_type(n);
+    auto un = magnitude_type(m + 1);
+    for (auto i = n; i-- > 1; ) {
+        vn[i] = (divisor[i] << shift) | (shift ? wide_type(divisor[i - 1]) >> (k_limb_bits - shift) : 0);
+    }
+    vn[0] = divisor[0] << shift;
+    un[m] = shift ? limb_type(wide_type(dividend[m - 1]) >> (k_limb_bits - shift)) : 0;
+    for (auto i = m; i-- > 1; ) {
+        un[i] = (dividend[i] << shift) | (shift ? wide_type(dividend[i - 1]) >> (k_limb_bits - shift) : 0);
+    }
+    un[0] = dividend[0] << shift;
+
+    auto constexpr base = wide_type(1) << k_limb_bits;
+    auto quotient = magnitude_type(m - n + 1);
+
+    for (auto j = m - n + 1; j-- > 0; ) {
+        auto num = (wide_type(un[j + n]) << k_limb_bits) | un[j + n - 1];
+        auto qhat = num / vn[n - 1];
+        auto rhat = num % vn[n - 1];
+        while (qhat >= base || qhat * vn[n - 2] > ((rhat << k_limb_bits) | un[j + n - 2])) {
+            --qhat;
+            rhat += vn[n - 1];
+            if (rhat >= base) {
+                break;
+            }
+        }
+
+        // Multiply and subtract.
+        auto borrow = std::int64_t();
+        for (auto i = 0uz; i < n; ++i) {
+            auto product = qhat * vn[i];
+            auto diff = std::int64_t(un[i + j]) - borrow - std::int64_t(product & 0xFFFFFFFF);
+            un[i + j] = limb_type(diff);
+            borrow = std::int64_t(product >> k_limb_bits) - (diff >> k_limb_bits);
+        }
+        auto diff = std::int64_t(un[j + n]) - borrow;
+        un[j + n] = limb_type(diff);
+
+        quotient[j] = limb_type(qhat);
+        // The estimate was one too large: add the divisor back.
+        if (diff < 0) {
+            --quotient[j];
+            auto carry = wide_type();
+            for (auto i = 0uz; i < n; ++i) {
+                carry += wide_type(un[i + j]) + vn[i];
+                un[i + j] = limb_type(carry);
+                carry >>= k_limb_bits;
+            }
+            un[j + n] += limb_type(carry);
+        }
+    }
+
+    auto remainder = magnitude_type(n);
+    for (auto i = 0uz; i < n; ++i) {
+        remainder[i] = (un[i] >> shift) | (shift ? limb_type(wide_type(un[i + 1]) << (k_limb_bits - shift)) : 0);
+    }
+    trim(quotient);
+    trim(remainder);
+    return { std::move(quotient), std::move(remainder) };
+}
+
+static std::pair<magnitude_type, magnitude_type> divide(std::span<limb_type const> dividend, std::span<limb_type const> divisor) {
+    if (compare(dividend, divisor) < 0) {
+        return { {}, { dividend.begin(), dividend.end() } };
+    }
+    if (divisor.size() == 1) {
+        auto quotient = magnitude_type(dividend.begin(), dividend.end());
+        auto rem = divide_small(quotient, divisor[0]);
+        return { std::move(quotient), rem ? magnitude_type { rem } : magnitude_type() };
+    }
+    return divide_knuth(dividend, divisor);
+}
+
+bigint_t::bigint_t(magnitude_type limbs, bool negative) noexcept
+    : m_limbs(std::move(limbs)), m_negative(negative) {
+    trim(m_limbs);
+    m_negative &= not m_limbs.empty();
+}
+
+bigint_t::bigint_t(long long value)
+    : m_negative(value < 0) {
+    // Negate in unsigned arithmetic so that LLONG_MIN doesn't overflow.
+    auto mag = m_negative ? ~wide_type(value) + 1 : wide_type(value);
+    while (mag != 0) {
+        m_limbs.push_back(limb_type(mag));
+        mag >>= k_limb_bits;
+    }
+}
+
+bigint_t bigint_t::parse(std::string_view digits, int base) {
+    auto negative = false;
+    if (!digits.empty() && (digits.front() == '-' || digits.front() == '+')) {
+        negative = digits.front() == '-';
+        digits.remove_prefix(1);
+    }
+    if (digits.empty() || base < 2 || base > 36) {
+        throw std::invalid_argument("bigint_t::parse: no digits");
+    }
+
+    // Feed the digits in chunks as large as a limb can take.
+    auto chunk_size = 0;
+    auto chunk_base = wide_type(1);
+    while (chunk_base * base <= std::numeric_limits<limb_type>::max()) {
+        chunk_base *= base;
+        ++chunk_size;
+    }
+
+    auto mag = magnitude_type();
+    mag.reserve(digits.size() * std::bit_width(unsigned(base)) / k_limb_bits + 1);
+    while (!digits.empty()) {
+        auto chunk = digits.substr(0, chunk_size);
+        digits.remove_prefix(chunk.size());
+        auto value = limb_type();
+        auto factor = limb_type(1);
+        for (auto ch : chunk) {
+            auto digit = isdigit(ch) ? ch - '0' : isalpha(ch) ? tolower(ch) - 'a' + 10 : base;
+            if (digit >= base) {
+                throw std::invalid_argument("bigint_t::parse: invalid digit");
+            }
+            value = value * base + digit;
+            factor *= base;
+        }
+        multiply_add_small(mag, factor, value);
+    }
+    return { std::move(mag), negative };
+}
+
+bigint_t bigint_t::pow(bigint_t base, std::uint64_t exp) {
+    auto result = bigint_t(1);
+    while (exp > 0) {
+        if (exp & 1) {
+            result = result * base;
+        }
+        if ((exp >>= 1) > 0) {
+            base = base * base;
+        }
+    }
+    return result;
+}
+
+std::pair<bigint_t, bigint_t> bigint_t::divmod(bigint_t const& lhs, bigint_t const& rhs) {
+    auto [quotient, remainder] = divide(lhs.m_limbs, rhs.m_limbs);
+    return {
+        bigint_t(std::move(quotient), lhs.m_negative != rhs.m_negative),
+        bigint_t(std::move(remainder), lhs.m_negative)
+    };
+}
+
+bool bigint_t::fits() const noexcept {
+    if (m_limbs.size() > 2) {
+        return false;
+    }
+    auto mag = wide_type();
+    for (auto i = m_limbs.size(); i-- > 0; ) {
+        mag = (mag << k_limb_bits) | m_limbs[i];
+    }
+    auto limit = wide_type(std::numeric_limits<long long>::max());
+    return mag <= limit + (m_negative ? 1 : 0);
+}
+
+std::string bigint_t::to_string() const {
+    if (m_limbs.empty()) {
+        return "0";
+    }
+    // Peel off nine decimal digits at a time.
+    auto constexpr chunk_base = limb_type(1'000'000'000);
+    auto mag = m_limbs;
+    auto chunks = std::vector<limb_type>();
+    while (!mag.empty()) {
+        chunks.push_back(divide_small(mag, chunk_base));
+    }
+
+    auto result = std::string(m_negative ? "-" : "");
+    result.reserve(chunks.size() * 9 + 1);
+    result += std::to_string(chunks.back());
+    for (auto i = chunks.size() - 1; i-- > 0; ) {
+        auto digits = std::to_string(chunks[i]);
+        result.append(9 - digits.size(), '0');
+        result += digits;
+    }
+    return result;
+}
+
+bigint_t::operator long long() const noexcept {
+    auto mag = wide_type();
+    for (auto i = std::min(m_limbs.size(), 2uz); i-- > 0; ) {
+        mag = (mag << k_limb_bits) | m_limbs[i];
+    }
+    return static_cast<long long>(m_negative ? ~mag + 1 : mag);
+}
+
+bigint_t::operator long double() const noexcept {
+    auto result = 0.0L;
+    for (auto i = m_limbs.size(); i-- > 0; ) {
+        result = std::ldexp(result, k_limb_bits) + m_limbs[i];
+    }
+    return m_negative ? -result : result;
+}
+
+bigint_t bigint_t::operator -() const {
+    return { m_limbs, !m_negative };
+}
+
+bigint_t operator +(bigint_t const& lhs, bigint_t const& rhs) {
+    if (lhs.m_negative == rhs.m_negative) {
+        return { add(lhs.m_limbs, rhs.m_limbs), lhs.m_negative };
+    }
+    if (compare(lhs.m_limbs, rhs.m_limbs) >= 0) {
+        return { subtract(lhs.m_limbs, rhs.m_limbs), lhs.m_negative };
+    }
+    return { subtract(rhs.m_limbs, lhs.m_limbs), rhs.m_negative };
+}
+
+bigint_t operator -(bigint_t const& lhs, bigint_t const& rhs) {
+    return lhs + -rhs;
+}
+
+bigint_t operator *(bigint_t const& lhs, bigint_t const& rhs) {
+    return { multiply(lhs.m_limbs, rhs.m_limbs), lhs.m_negative != rhs.m_negative };
+}
+
+bigint_t operator /(bigint_t const& lhs, bigint_t const& rhs) {
+    return bigint_t::divmod(lhs, rhs).first;
+}
+
+bigint_t operator %(bigint_t const& lhs, bigint_t const& rhs) {
+    return bigint_t::divmod(lhs, rhs).second;
+}
+
+bigint_t operator <<(bigint_t const& lhs, std::size_t shift) {
+    if (lhs.zero()) {
+        return lhs;
+    }
+    auto limbs = shift / k_limb_bits;
+    auto bits = shift % k_limb_bits;
+    auto result = magnitude_type(limbs + lhs.m_limbs.size() + 1);
+    for (auto i = 0uz; i < lhs.m_limbs.size(); ++i) {
+        auto wide = wide_type(lhs.m_limbs[i]) << bits;
+        result[limbs + i] |= limb_type(wide);
+        result[limbs + i + 1] |= limb_type(wide >> k_limb_bits);
+    }
+    return { std::move(result), lhs.m_negative };
+}
+
+bigint_t operator >>(bigint_t const& lhs, std::size_t shift) {
+    if (lhs.m_negative) {
+        // floor(-a / 2^n) = -((a - 1) / 2^n) - 1
+        return -((-lhs - bigint_t(1)) >> shift) - bigint_t(1);
+    }
+    auto limbs = shift / k_limb_bits;
+    auto bits = shift % k_limb_bits;
+    if (limbs >= lhs.m_limbs.size()) {
+        return {};
+    }
+    auto result = magnitude_type(lhs.m_limbs.size() - limbs);
+    for (auto i = 0uz; i < result.size(); ++i) {
+        auto wide = wide_type(lhs.m_limbs[limbs + i]);
+        if (limbs + i + 1 < lhs.m_limbs.size()) {
+            wide |= wide_type(lhs.m_limbs[limbs + i + 1]) << k_limb_bits;
+        }
+        result[i] = limb_type(wide >> bits);
+    }
+    return { std::move(result), false };
+}
+
+std::strong_ordering operator <=>(bigint_t const& lhs, bigint_t const& rhs) noexcept {
+    if (lhs.m_negative != rhs.m_negative) {
+        return lhs.m_negative ? std::strong_ordering::less : std::strong_ordering::greater;
+    }
+    auto cmp = compare(lhs.m_limbs, rhs.m_limbs);
+    return lhs.m_negative ? 0 <=> cmp : cmp;
+}
+
+} // namespace ysh::types
@@ -0,0 +1,844 @@
+#include "../include/builtins.hpp"
+#include "../include/event_loop.hpp"
+#include "../include/ffi.hpp"
+#include "../include/io_ring.hpp"
+#include "../include/parallel.hpp"
+#include "../include/plugin.hpp"
+#include "../include/serialize.hpp"
+
+namespace ysh {
+
+using types::chan_t;
+using types::dict_t;
+using types::func_t;
+using types::int_t;
+using types::list_t;
+using types::real_t;
+using types::seq_t;
+using types::str_t;
+
+/**
+ * @brief Unpack the tuple of arguments of a built-in function.
+ *
+ * @param args The argument passed to the function.
+ * @param count The number of arguments expected.
+ * @return std::optional<list_t> The arguments in order, or nothing if there are not @param count of them.
+ */
+static std::optional<list_t> unpack(entity_t const& args, std::size_t count) {
+    if (args.kind() != entity_t::TUPLE) {
+        return std::nullopt;
+    }
+    auto result = list_t(args);
+    if (result.size() != count) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+static entity_t usage(std::string const& signature) {
+    return types::standard_error("Usage: " + signature);
+}
+
+/**
+ * @brief Call @param func on each element of a List or a Seq, without copying the List, or on each value
+ * received from a Chan until it's closed.
+ * @return bool Whether @param xs is a List, a Seq or a Chan.
+ */
+static bool for_each_elem(entity_t const& xs, std::invocable<entity_t const&> auto&& func) {
+    switch (xs.kind()) {
+    case entity_t::SEQ:
+    case entity_t::CHAN:
+        seq_t(xs).for_each([&func](entity_t const& elem) {
+            func(elem);
+            return true;
+        });
+        return true;
+    case entity_t::LIST:
+        stdr::for_each(xs.get<list_t>(), func);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Whether @param key can be a key of a Dict. Functions, errors and sequences can't be compared
+ * by value, so they can't.
+ */
+static bool hashable(entity_t const& key) {
+    return key.kind() != entity_t::FUNC && key.kind() != entity_t::ERROR && key.kind() != entity_t::SEQ;
+}
+
+static bool parallel_safe(func_t const& func, list_t const& elems);
+
+static entity_t builtin_map(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    if (not unpacked || (*unpacked)[0].kind() != entity_t::FUNC) {
+        return usage("map $ (Func, List | Seq)");
+    }
+    auto func = func_t((*unpacked)[0]);
+    auto const& xs = (*unpacked)[1];
+    switch (xs.kind()) {
+    case entity_t::SEQ:
+        return entity_t(seq_t(xs).map(std::move(func)));
+    case entity_t::LIST: {
+        // Large lists are mapped in parallel if func can be called from several threads at once.
+        auto const& elems = xs.get<list_t>();
+        auto result = list_t(elems.size());
+        auto const chunks = parallel_safe(func, elems) ? parallel_chunks(elems.size()) : 1uz;
+        auto& session = interpreter::current();
+        parallel_for(chunks, [&](std::size_t chunk) {
+            auto bound = interpreter::scope(session);
+            for (auto i = elems.size() * chunk / chunks; i < elems.size() * (chunk + 1) / chunks; ++i) {
+                result[i] = func(elems[i]);
+            }
+        });
+        return entity_t(std::move(result));
+    }
+    default:
+        return usage("map $ (Func, List | Seq)");
+    }
+}
+
+static entity_t builtin_filter(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    if (not unpacked || (*unpacked)[0].kind() != entity_t::FUNC) {
+        return usage("filter $ (Func, List | Seq)");
+    }
+    auto pred = func_t((*unpacked)[0]);
+    auto const& xs = (*unpacked)[1];
+    switch (xs.kind()) {
+    case entity_t::SEQ:
+        return entity_t(seq_t(xs).filter(std::move(pred)));
+    case entity_t::LIST: {
+        auto const& elems = xs.get<list_t>();
+        auto keep = std::vector<char>(elems.size());
+        auto const chunks = parallel_safe(pred, elems) ? parallel_chunks(elems.size()) : 1uz;
+        auto& session = interpreter::current();
+        parallel_for(chunks, [&](std::size_t chunk) {
+            auto bound = interpreter::scope(session);
+            for (auto i = elems.size() * chunk / chunks; i < elems.size() * (chunk + 1) / chunks; ++i) {
+                keep[i] = bool(pred(elems[i]));
+            }
+        });
+        auto result = list_t();
+        for (auto i = 0uz; i < elems.size(); ++i) {
+            if (keep[i]) {
+                result.push_back(elems[i]);
+            }
+        }
+        return entity_t(std::move(result));
+    }
+    default:
+        return usage("filter $ (Func, List | Seq)");
+    }
+}
+
+static entity_t builtin_take(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    if (not unpacked || (*unpacked)[0].kind() != entity_t::INT || types::int_t((*unpacked)[0]) < 0) {
+        return usage("take $ (Int, List | Seq)");
+    }
+    auto count = std::size_t(types::int_t((*unpacked)[0]));
+    auto const& xs = (*unpacked)[1];
+    switch (xs.kind()) {
+    case entity_t::SEQ:
+        return entity_t(seq_t(xs).take(count));
+    case entity_t::LIST: {
+        auto elems = list_t(xs);
+        elems.resize(std::min(count, elems.size()));
+        return entity_t(std::move(elems));
+    }
+    default:
+        return usage("take $ (Int, List | Seq)");
+    }
+}
+
+static generator<entity_t> generate_unique(seq_t seq) {
+    auto seen = std::unordered_set<entity_t>();
+    for (auto const& elem : seq.iterate()) {
+        if (seen.insert(elem).second) {
+            co_yield elem;
+        }
+    }
+}
+
+/**
+ * @brief Drop the elements equal to an earlier one, keeping the order of the others. Elements are
+ * compared by hash first, so this takes linear time.
+ */
+static entity_t builtin_unique(entity_t xs) {
+    switch (xs.kind()) {
+    case entity_t::SEQ:
+        return entity_t(seq_t([seq = xs.get<seq_t>()] {
+            return generate_unique(seq);
+        }));
+    case entity_t::LIST: {
+        auto const& elems = xs.get<list_t>();
+        auto seen = std::unordered_set<entity_t>();
+        seen.reserve(elems.size());
+        auto result = list_t();
+        for (auto const& elem : elems) {
+            if (seen.insert(elem).second) {
+                result.push_back(elem);
+            }
+        }
+        return entity_t(std::move(result));
+    }
+    default:
+        return usage("unique $ (List | Seq)");
+    }
+}
+
+/**
+ * @brief The kind of all the elements, if they are all of the same kind.
+ */
+static std::optional<entity_t::type> common_kind(list_t const& elems) {
+    if (elems.empty()) {
+        return std::nullopt;
+    }
+    auto kind = elems.front().kind();
+    if (stdr::all_of(elems, [kind](entity_t const& elem) { return elem.kind() == kind; })) {
+        return kind;
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Whether @param lhs goes before @param rhs.
+ * @throws std::invalid_argument if they are unordered, e.g. a NaN, rather than letting an algorithm
+ * work with an inconsistent order.
+ */
+static bool ordered_before(entity_t const& lhs, entity_t const& rhs) {
+    auto cmp = lhs <=> rhs;
+    if (cmp == std::partial_ordering::unordered) {
+        throw std::invalid_argument("Unordered elements: " + entity_t::name(lhs.kind()) + " and " + entity_t::name(rhs.kind()));
+    }
+    return cmp < 0;
+}
+
+/**
+ * @brief Sort the elements by the keys @param key extracts. The keys are sorted next to the indices of
+ * their elements, which keeps the comparisons in cache, and the elements are moved into place once.
+ */
+static list_t sort_by_key(list_t elems, auto key) {
+    using key_type = decltype(key(elems.front()));
+    auto keys = std::vector<std::pair<key_type, std::size_t>>();
+    keys.reserve(elems.size());
+    for (auto i = 0uz; i < elems.size(); ++i) {
+        keys.emplace_back(key(elems[i]), i);
+    }
+    parallel_sort(keys.begin(), keys.end(), [](auto const& lhs, auto const& rhs) {
+        return lhs.first < rhs.first;
+    });
+    auto result = list_t();
+    result.reserve(elems.size());
+    for (auto const& [_, index] : keys) {
+        result.push_back(std::move(elems[index]));
+    }
+    return result;
+}
+
+/**
+ * @brief Sort the elements in ascending order. Lists of Ints, Reals or Strs are sorted by their raw
+ * values; other lists are sorted stably with operator <=>.
+ */
+static entity_t builtin_sort(entity_t xs) {
+    if (xs.kind() != entity_t::LIST && xs.kind() != entity_t::SEQ) {
+        return usage("sort $ (List | Seq)");
+    }
+    auto elems = xs.kind() == entity_t::LIST ? std::move(xs.get<list_t>()) : xs.get<seq_t>().to_list();
+    try {
+        switch (common_kind(elems).value_or(entity_t::ERROR)) {
+        case entity_t::INT:
+            return entity_t(sort_by_key(std::move(elems), [](entity_t const& elem) { return elem.get<int_t>(); }));
+        case entity_t::REAL:
+            if (stdr::any_of(elems, [](entity_t const& elem) { return std::isnan(elem.get<real_t>()); })) {
+                return types::standard_error("Unordered elements: NaN");
+            }
+            return entity_t(sort_by_key(std::move(elems), [](entity_t const& elem) { return elem.get<real_t>(); }));
+        case entity_t::STR:
+            return entity_t(sort_by_key(std::move(elems), [](entity_t const& elem) { return elem.get<str_t>().view(); }));
+        default:
+            parallel_stable_sort(elems.begin(), elems.end(), ordered_before);
+            return entity_t(std::move(elems));
+        }
+    }
+    catch (std::exception const& e) {
+        return types::standard_error(e.what());
+    }
+}
+
+/**
+ * @brief Add up the elements with operator +, or return 0 if there are none. Lists of Ints and Reals
+ * are added up as raw values, unless an Int sum overflows.
+ */
+static entity_t builtin_sum(entity_t xs) {
+    if (xs.kind() == entity_t::SEQ) {
+        // Ints or Reals are added up as raw values until an element of another kind or an overflow.
+        auto raw = std::optional<entity_t::type>();
+        auto ints = int_t(0);
+        auto reals = real_t(0);
+        auto result = std::optional<entity_t>();
+        xs.get<seq_t>().for_each([&](entity_t const& elem) {
+            if (not raw && not result) {
+                if (elem.kind() != entity_t::INT && elem.kind() != entity_t::REAL) {
+                    result = elem;
+                    return true;
+                }
+                raw = elem.kind();
+            }
+            if (raw == entity_t::INT && elem.kind() == entity_t::INT) {
+                if (auto sum = int_t(); not __builtin_add_overflow(ints, elem.get<int_t>(), &sum)) {
+                    ints = sum;
+                    return true;
+                }
+            }
+            else if (raw == entity_t::REAL && elem.kind() == entity_t::REAL) {
+                reals += elem.get<real_t>();
+                return true;
+            }
+            if (raw) {
+                result = *raw == entity_t::INT ? entity_t(ints) : entity_t(reals);
+                raw.reset();
+            }
+            result = *result + elem;
+            return true;
+        });
+        if (raw) {
+            return *raw == entity_t::INT ? entity_t(ints) : entity_t(reals);
+        }
+        return result.value_or(entity_t(0));
+    }
+    if (xs.kind() != entity_t::LIST) {
+        return usage("sum $ (List | Seq)");
+    }
+    auto const& elems = xs.get<list_t>();
+    if (elems.empty()) {
+        return entity_t(0);
+    }
+    auto const span = std::span(elems);
+    switch (common_kind(elems).value_or(entity_t::ERROR)) {
+    case entity_t::INT: {
+        auto const add = [](std::optional<int_t> lhs, std::optional<int_t> rhs) -> std::optional<int_t> {
+            auto result = int_t();
+            if (not lhs || not rhs || __builtin_add_overflow(*lhs, *rhs, &result)) {
+                return std::nullopt;
+            }
+            return result;
+        };
+        auto sum = parallel_reduce(span, [&add](entity_t const& first, std::span<entity_t const> rest) {
+            auto result = std::optional(first.get<int_t>());
+            for (auto const& elem : rest) {
+                result = add(result, elem.get<int_t>());
+            }
+            return result;
+        }, add);
+        if (sum) {
+            return entity_t(*sum);
+        }
+        // Overflowed: fall back to operator +, which promotes to bigint_t.
+        break;
+    }
+    case entity_t::REAL:
+        return entity_t(parallel_reduce(span, [](entity_t const& first, std::span<entity_t const> rest) {
+            auto result = first.get<real_t>();
+            for (auto const& elem : rest) {
+                result += elem.get<real_t>();
+            }
+            return result;
+        }, std::plus<>()));
+    default:
+        break;
+    }
+    return parallel_reduce(span, [](entity_t const& first, std::span<entity_t const> rest) {
+        auto result = first;
+        for (auto const& elem : rest) {
+            result = result + elem;
+        }
+        return result;
+    }, [](entity_t const& lhs, entity_t const& rhs) {
+        return lhs + rhs;
+    });
+}
+
+/**
+ * @brief The least element, or the greatest one if @param greatest. The first of equal elements wins.
+ */
+static entity_t extremum(entity_t xs, bool greatest, std::string const& signature) {
+    auto const better = [greatest](auto const& lhs, auto const& rhs) {
+        return greatest ? rhs < lhs : lhs < rhs;
+    };
+    try {
+        if (xs.kind() == entity_t::SEQ) {
+            auto result = std::optional<entity_t>();
+            xs.get<seq_t>().for_each([&result, greatest](entity_t const& elem) {
+                if (not result || (greatest ? ordered_before(*result, elem) : ordered_before(elem, *result))) {
+                    result = elem;
+                }
+                return true;
+            });
+            return result ? *result : usage(signature + " of at least one element");
+        }
+        if (xs.kind() != entity_t::LIST) {
+            return usage(signature);
+        }
+        auto const& elems = xs.get<list_t>();
+        if (elems.empty()) {
+            return usage(signature + " of at least one element");
+        }
+        auto const reduce = [&elems](auto before) {
+            auto const pick = [&before](entity_t const* lhs, entity_t const* rhs) {
+                return before(*rhs, *lhs) ? rhs : lhs;
+            };
+            return *parallel_reduce(std::span(elems), [&pick](entity_t const& first, std::span<entity_t const> rest) {
+                auto result = &first;
+                for (auto const& elem : rest) {
+                    result = pick(result, &elem);
+                }
+                return result;
+            }, pick);
+        };
+        if (common_kind(elems) == entity_t::INT) {
+            return reduce([&better](entity_t const& lhs, entity_t const& rhs) {
+                return better(lhs.get<int_t>(), rhs.get<int_t>());
+            });
+        }
+        return reduce([greatest](entity_t const& lhs, entity_t const& rhs) {
+            return greatest ? ordered_before(rhs, lhs) : ordered_before(lhs, rhs);
+        });
+    }
+    catch (std::exception const& e) {
+        return types::standard_error(e.what());
+    }
+}
+
+static entity_t builtin_min(entity_t xs) {
+    return extremum(std::move(xs), false, "min $ (List | Seq)");
+}
+
+static entity_t builtin_max(entity_t xs) {
+    return extremum(std::move(xs), true, "max $ (List | Seq)");
+}
+
+/**
+ * @brief Write a value to a file in the binary format (see serialize.hpp).
+ * @return entity_t The size of the file.
+ */
+static entity_t builtin_save(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    if (not unpacked || (*unpacked)[0].kind() != entity_t::STR) {
+        return usage("save $ (Str, value)");
+    }
+    try {
+        return entity_t(save(std::string((*unpacked)[0].get<str_t>().view()), (*unpacked)[1]));
+    }
+    catch (types::error_t const& e) {
+        return entity_t(e);
+    }
+}
+
+/**
+ * @brief The elements of a List or a Seq of Strs, e.g. paths, or nothing if @param xs isn't one.
+ */
+static std::optional<std::vector<std::string>> strs_of(entity_t const& xs) {
+    if (xs.kind() != entity_t::LIST && xs.kind() != entity_t::SEQ) {
+        return std::nullopt;
+    }
+    auto result = std::vector<std::string>();
+    auto all = true;
+    for_each_elem(xs, [&](entity_t const& elem) {
+        if (elem.kind() != entity_t::STR) {
+            all = false;
+            return;
+        }
+        result.emplace_back(elem.get<str_t>().view());
+    });
+    if (not all) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+/**
+ * @brief Read the files at @param paths whole, as many at once as the I/O ring takes (see io_ring.hpp).
+ * @throws error_t naming the first file that can't be read.
+ */
+static std::vector<std::string> read_files(std::vector<std::string> const& paths) {
+    auto contents = io_ring::local().read(paths);
+    auto result = std::vector<std::string>();
+    for (auto i = 0uz; i < paths.size(); ++i) {
+        if (contents[i].error != 0) {
+            types::throw_standard_error("Cannot read " + paths[i] + ": " + std::strerror(contents[i].error));
+        }
+        result.push_back(std::move(contents[i].data));
+    }
+    return result;
+}
+
+/**
+ * @brief Read a value written by save, or a List of the values in a List or Seq of files, read together.
+ */
+static entity_t builtin_load(entity_t path) {
+    auto paths = strs_of(path);
+    if (path.kind() != entity_t::STR && not paths) {
+        return usage("load $ (Str | List | Seq)");
+    }
+    try {
+        if (not paths) {
+            return load(std::string(path.get<str_t>().view()));
+        }
+        auto result = list_t();
+        for (auto const& data : read_files(*paths)) {
+            result.push_back(decode(data));
+        }
+        return entity_t(std::move(result));
+    }
+    catch (types::error_t const& e) {
+        return entity_t(e);
+    }
+}
+
+/**
+ * @brief The text of a file, or a List of the texts of a List or Seq of files, read together.
+ */
+static entity_t builtin_read(entity_t path) {
+    auto paths = strs_of(path);
+    if (path.kind() != entity_t::STR && not paths) {
+        return usage("read $ (Str | List | Seq)");
+    }
+    try {
+        if (not paths) {
+            return entity_t(str_t(std::move(read_files({ std::string(path.get<str_t>().view()) })[0])));
+        }
+        auto result = list_t();
+        for (auto& data : read_files(*paths)) {
+            result.push_back(entity_t(str_t(std::move(data))));
+        }
+        return entity_t(std::move(result));
+    }
+    catch (types::error_t const& e) {
+        return entity_t(e);
+    }
+}
+
+/**
+ * @brief Write a Str to a file, or each Str of a List to the file at the same index of a List of
+ * files, written together, replacing what they held.
+ * @return entity_t The number of bytes written.
+ */
+static entity_t builtin_write(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    auto paths = unpacked ? strs_of((*unpacked)[0]) : std::nullopt;
+    auto texts = unpacked ? strs_of((*unpacked)[1]) : std::nullopt;
+    if (unpacked && (*unpacked)[0].kind() == entity_t::STR && (*unpacked)[1].kind() == entity_t::STR) {
+        paths = std::vector { std::string((*unpacked)[0].get<str_t>().view()) };
+        texts = std::vector { std::string((*unpacked)[1].get<str_t>().view()) };
+    }
+    if (not paths || not texts || paths->size() != texts->size()) {
+        return usage("write $ (Str, Str) | write $ (List, List)");
+    }
+    auto contents = std::vector<std::string_view>(texts->begin(), texts->end());
+    auto errors = io_ring::local().write(*paths, contents);
+    for (auto i = 0uz; i < paths->size(); ++i) {
+        if (errors[i] != 0) {
+            return types::standard_error("Cannot write " + (*paths)[i] + ": " + std::strerror(errors[i]));
+        }
+    }
+    return entity_t(int_t(std::accumulate(contents.begin(), contents.end(), 0uz, [](std::size_t size, std::string_view text) {
+        return size + text.size();
+    })));
+}
+
+/**
+ * @brief Bind a C function of a shared library (see ffi.hpp), e.g.
+ * @code pow <- ffi $ ("libm.so.6", "pow", "d(dd)") @endcode
+ */
+static entity_t builtin_ffi(entity_t args) {
+    auto unpacked = unpack(args, 3);
+    if (not unpacked || stdr::any_of(*unpacked, [](entity_t const& arg) { return arg.kind() != entity_t::STR; })) {
+        return usage("ffi $ (Str, Str, Str)");
+    }
+    try {
+        auto const& library = (*unpacked)[0].get<str_t>();
+        auto const& symbol = (*unpacked)[1].get<str_t>();
+        return entity_t(bind_foreign(library.str(), symbol.str(), (*unpacked)[2].get<str_t>().str()));
+    }
+    catch (types::error_t const& e) {
+        return entity_t(e);
+    }
+}
+
+/**
+ * @brief Load a plugin, adding its commands to the current interpreter.
+ */
+static entity_t builtin_plugin(entity_t path) {
+    if (path.kind() != entity_t::STR) {
+        return usage("plugin $ Str");
+    }
+    try {
+        return entity_t(int_t(load_plugin(std::string(path.get<str_t>().view()))));
+    }
+    catch (types::error_t const& e) {
+        return entity_t(e);
+    }
+}
+
+/**
+ * @brief The number of elements. A Seq is counted in one pass, without keeping its elements.
+ */
+static entity_t builtin_count(entity_t xs) {
+    auto result = int_t(0);
+    if (not for_each_elem(xs, [&result](entity_t const&) { ++result; })) {
+        return usage("count $ (List | Seq)");
+    }
+    return entity_t(result);
+}
+
+/**
+ * @brief Make a Seq of the elements of a List, so that the stages chained on it are fused into one
+ * loop instead of each building a List, e.g.
+ * @code count $ (filter $ (p, map $ (f, seq $ xs))) @endcode
+ * The Seq of a Chan receives its values until it's closed.
+ */
+static entity_t builtin_seq(entity_t xs) {
+    switch (xs.kind()) {
+    case entity_t::SEQ:
+        return xs;
+    case entity_t::LIST:
+        return entity_t(seq_t::of(std::move(xs.get<list_t>())));
+    case entity_t::CHAN:
+        return entity_t(xs.get<chan_t>().received());
+    default:
+        return usage("seq $ (List | Seq | Chan)");
+    }
+}
+
+/**
+ * @brief Generate the elements of a Seq into a List.
+ */
+static entity_t builtin_list(entity_t arg) {
+    return entity_t(list_t(arg));
+}
+
+/**
+ * @brief Build a Dict from (key, value) pairs, given as 2-tuples or 2-lists. Later pairs win.
+ */
+static entity_t builtin_dict(entity_t pairs) {
+    auto result = dict_t();
+    auto invalid = std::optional<entity_t>();
+    if (pairs.kind() == entity_t::LIST) {
+        result.reserve(pairs.get<list_t>().size());
+    }
+    auto valid = for_each_elem(pairs, [&result, &invalid](entity_t const& pair) {
+        if (invalid) {
+            return;
+        }
+        auto elems = list_t(pair);
+        if ((pair.kind() != entity_t::TUPLE && pair.kind() != entity_t::LIST) || elems.size() != 2) {
+            invalid = usage("dict $ (List | Seq) of (key, value) pairs");
+        }
+        else if (not hashable(elems[0])) {
+            invalid = types::standard_error("Unhashable key: " + entity_t::name(elems[0].kind()));
+        }
+        else {
+            result.insert_or_assign(std::move(elems[0]), std::move(elems[1]));
+        }
+    });
+    if (not valid) {
+        return usage("dict $ (List | Seq) of (key, value) pairs");
+    }
+    return invalid ? *invalid : entity_t(std::move(result));
+}
+
+static entity_t builtin_has(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    if (not unpacked || (*unpacked)[0].kind() != entity_t::DICT) {
+        return usage("has $ (Dict, key)");
+    }
+    return entity_t((*unpacked)[0].get<dict_t>().contains((*unpacked)[1]));
+}
+
+static entity_t builtin_keys(entity_t dict) {
+    if (dict.kind() != entity_t::DICT) {
+        return usage("keys $ Dict");
+    }
+    auto result = list_t();
+    result.reserve(dict.get<dict_t>().size());
+    for (auto const& [key, value] : dict.get<dict_t>()) {
+        result.push_back(key);
+    }
+    return entity_t(std::move(result));
+}
+
+static entity_t builtin_values(entity_t dict) {
+    if (dict.kind() != entity_t::DICT) {
+        return usage("values $ Dict");
+    }
+    auto result = list_t();
+    result.reserve(dict.get<dict_t>().size());
+    for (auto const& [key, value] : dict.get<dict_t>()) {
+        result.push_back(value);
+    }
+    return entity_t(std::move(result));
+}
+
+/**
+ * @brief Group the elements by the key @param func gives them, into a Dict from each key to the List of
+ * its elements, in their original order.
+ */
+static entity_t builtin_group(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    if (not unpacked || (*unpacked)[0].kind() != entity_t::FUNC) {
+        return usage("group $ (Func, List | Seq)");
+    }
+    auto func = func_t((*unpacked)[0]);
+    auto result = dict_t();
+    auto invalid = std::optional<entity_t>();
+    auto valid = for_each_elem((*unpacked)[1], [&](entity_t const& elem) {
+        if (invalid) {
+            return;
+        }
+        auto key = func(elem);
+        if (not hashable(key)) {
+            invalid = key.kind() == entity_t::ERROR ? key : types::standard_error("Unhashable key: " + entity_t::name(key.kind()));
+            return;
+        }
+        auto [group, inserted] = result.try_emplace(std::move(key), entity_t(list_t()));
+        group->get<list_t>().push_back(elem);
+    });
+    if (not valid) {
+        return usage("group $ (Func, List | Seq)");
+    }
+    return invalid ? *invalid : entity_t(std::move(result));
+}
+
+/**
+ * @brief Make a Chan holding up to @param capacity values at once (see chan_t).
+ */
+static entity_t builtin_chan(entity_t capacity) {
+    if (capacity.kind() != entity_t::INT || int_t(capacity) <= 0) {
+        return usage("chan $ Int");
+    }
+    return entity_t(chan_t(std::size_t(int_t(capacity))));
+}
+
+/**
+ * @brief Send a value through a Chan, waiting for room if it's full, and return the value.
+ */
+static entity_t builtin_send(entity_t args) {
+    auto unpacked = unpack(args, 2);
+    if (not unpacked || (*unpacked)[0].kind() != entity_t::CHAN) {
+        return usage("send $ (Chan, value)");
+    }
+    if (not (*unpacked)[0].get<chan_t>().send((*unpacked)[1])) {
+        return types::standard_error("Send on a closed Chan");
+    }
+    return (*unpacked)[1];
+}
+
+/**
+ * @brief Receive the next value from a Chan, waiting for one if it's empty.
+ */
+static entity_t builtin_recv(entity_t chan) {
+    if (chan.kind() != entity_t::CHAN) {
+        return usage("recv $ Chan");
+    }
+    if (auto value = chan.get<chan_t>().receive()) {
+        return std::move(*value);
+    }
+    return types::standard_error("Receive on a closed Chan");
+}
+
+static entity_t builtin_close(entity_t chan) {
+    if (chan.kind() != entity_t::CHAN) {
+        return usage("close $ Chan");
+    }
+    chan.get<chan_t>().close();
+    return chan;
+}
+
+/**
+ * @brief The value of a Future, waiting for it if it isn't done yet.
+ */
+static entity_t builtin_await(entity_t future) {
+    if (future.kind() != entity_t::FUTURE) {
+        return usage("await $ Future");
+    }
+    return future.get<types::future_t>().get();
+}
+
+/**
+ * @brief Wait for a number of seconds on the event loop of the current thread, then return them, or
+ * the values passed with them, so that a stage of a pipeline can hold its values back.
+ */
+static entity_t builtin_sleep(entity_t args) {
+    auto seconds = args;
+    if (auto unpacked = unpack(args, 2)) {
+        seconds = (*unpacked)[0];
+        args = (*unpacked)[1];
+    }
+    auto delay = seconds.kind() == entity_t::INT ? real_t(seconds.get<int_t>())
+               : seconds.kind() == entity_t::REAL ? seconds.get<real_t>() : real_t(-1);
+    if (not (delay >= 0 && delay < 1e9)) {
+        return usage("sleep $ (Int | Real)");
+    }
+    auto& loop = event_loop::local();
+    loop.after(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<real_t>(delay)), [] {});
+    loop.run();
+    return args;
+}
+
+/**
+ * @brief Whether @param func may be called on @param elems from several threads at once, in any order.
+ * Only built-in functions without side effects may: any other Func may send to a Chan, write a file or
+ * call back into the host, and so is called in order, on the calling thread. Not even those may on a
+ * Seq, which may run such Funcs as it's generated, or on a Chan, which they would receive from.
+ */
+static bool parallel_safe(func_t const& func, list_t const& elems) {
+    using builtin_type = entity_t (*)(entity_t);
+    static auto const pure = std::unordered_set<builtin_type> {
+        builtin_count, builtin_dict, builtin_has, builtin_keys, builtin_list, builtin_max, builtin_min,
+        builtin_seq, builtin_sort, builtin_sum, builtin_take, builtin_unique, builtin_values
+    };
+    auto const* builtin = func.target<builtin_type>();
+    return builtin && pure.contains(*builtin) && stdr::none_of(elems, [](entity_t const& elem) {
+        return elem.kind() == entity_t::SEQ || elem.kind() == entity_t::CHAN;
+    });
+}
+
+env_t const& builtins() {
+    static auto const table = env_t {
+        { "await",  { .value = entity_t(func_t(builtin_await)) } },
+        { "chan",   { .value = entity_t(func_t(builtin_chan)) } },
+        { "close",  { .value = entity_t(func_t(builtin_close)) } },
+        { "count",  { .value = entity_t(func_t(builtin_count)) } },
+        { "dict",   { .value = entity_t(func_t(builtin_dict)) } },
+        { "ffi",    { .value = entity_t(func_t(builtin_ffi)) } },
+        { "filter", { .value = entity_t(func_t(builtin_filter)) } },
+        { "group",  { .value = entity_t(func_t(builtin_group)) } },
+        { "has",    { .value = entity_t(func_t(builtin_has)) } },
+        { "keys",   { .value = entity_t(func_t(builtin_keys)) } },
+        { "list",   { .value = entity_t(func_t(builtin_list)) } },
+        { "load",   { .value = entity_t(func_t(builtin_load)) } },
+        { "map",    { .value = entity_t(func_t(builtin_map)) } },
+        { "max",    { .value = entity_t(func_t(builtin_max)) } },
+        { "min",    { .value = entity_t(func_t(builtin_min)) } },
+        { "plugin", { .value = entity_t(func_t(builtin_plugin)) } },
+        { "read",   { .value = entity_t(func_t(builtin_read)) } },
+        { "recv",   { .value = entity_t(func_t(builtin_recv)) } },
+        { "save",   { .value = entity_t(func_t(builtin_save)) } },
+        { "send",   { .value = entity_t(func_t(builtin_send)) } },
+        { "seq",    { .value = entity_t(func_t(builtin_seq)) } },
+        { "sleep",  { .value = entity_t(func_t(builtin_sleep)) } },
+        { "sort",   { .value = entity_t(func_t(builtin_sort)) } },
+        { "sum",    { .value = entity_t(func_t(builtin_sum)) } },
+        { "take",   { .value = entity_t(func_t(builtin_take)) } },
+        { "unique", { .value = entity_t(func_t(builtin_unique)) } },
+        { "values", { .value = entity_t(func_t(builtin_values)) } },
+        { "write",  { .value = entity_t(func_t(builtin_write)) } },
+    };
+    return table;
+}
+
+} // namespace ysh
@@ -0,0 +1,248 @@
+#include "../include/daemon.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Where the full interpreter is installed, unless the build says otherwise.
+#ifndef YSH_INTERPRETER_PATH
+#define YSH_INTERPRETER_PATH "/usr/local/libexec/ysh/ysh"
+#endif
+
+extern char** environ;
+
+namespace ysh {
+
+// Far beyond ARG_MAX, so that a corrupt length is rejected rather than allocated.
+static constexpr std::uint64_t k_max_request = 1 << 26;
+static constexpr std::size_t k_max_fds = 3;
+
+stdf::path default_socket() {
+    if (auto const* path = std::getenv("YSH_SOCKET"); path && *path) {
+        return path;
+    }
+    if (auto const* dir = std::getenv("XDG_RUNTIME_DIR"); dir && *dir) {
+        return stdf::path(dir) / "ysh.sock";
+    }
+    return "/tmp/ysh-" + std::to_string(getuid()) + ".sock";
+}
+
+stdf::path interpreter_path() {
+    if (auto const* path = std::getenv("YSH_INTERPRETER"); path && *path) {
+        return path;
+    }
+    return YSH_INTERPRETER_PATH;
+}
+
+static bool write_all(int fd, std::string_view data) {
+    while (not data.empty()) {
+        auto written = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data.remove_prefix(written);
+    }
+    return true;
+}
+
+static bool read_all(int fd, char* data, std::size_t size) {
+    while (size != 0) {
+        auto received = ::recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+bool send_request(int fd, request_t const& request, std::span<int const> fds) {
+    auto payload = std::string();
+    auto const put_count = [&payload](std::size_t count) {
+        auto value = std::uint32_t(count);
+        payload.append(reinterpret_cast<char const*>(&value), sizeof(value));
+    };
+    put_count(request.arguments.size());
+    put_count(request.environment.size());
+    for (auto const& strings : { &request.arguments, &request.environment }) {
+        for (auto const& str : *strings) {
+            payload.append(str.c_str(), str.size() + 1);
+        }
+    }
+    payload.append(request.directory.c_str(), request.directory.size() + 1);
+
+    // The descriptors ride along with the length, so they arrive before anything else is read.
+    auto length = std::uint64_t(payload.size());
+    auto iov = iovec { .iov_base = &length, .iov_len = sizeof(length) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * k_max_fds)] = {};
+    auto message = msghdr {};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    if (not fds.empty()) {
+        if (fds.size() > k_max_fds) {
+            return false;
+        }
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        auto* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        std::memcpy(CMSG_DATA(header), fds.data(), sizeof(int) * fds.size());
+    }
+    auto sent = ssize_t();
+    do {
+        sent = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent != sizeof(length)) {
+        return false;
+    }
+    return write_all(fd, payload);
+}
+
+std::optional<request_t> receive_request(int fd, std::vector<int>& fds) {
+    auto length = std::uint64_t();
+    auto iov = iovec { .iov_base = &length, .iov_len = sizeof(length) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * k_max_fds)] = {};
+    auto message = msghdr {};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    auto received = ssize_t();
+    do {
+        received = ::recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    for (auto* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            auto count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            auto const* first = reinterpret_cast<int const*>(CMSG_DATA(header));
+            for (auto i = 0uz; i < count; ++i) {
+                auto passed = int();
+                std::memcpy(&passed, first + i, sizeof(int));
+                fds.push_back(passed);
+            }
+        }
+    }
+    if (received <= 0) {
+        return std::nullopt;
+    }
+    if ((received != sizeof(length) && not read_all(fd, reinterpret_cast<char*>(&length) + received, sizeof(length) - received)) ||
+        length < 2 * sizeof(std::uint32_t) || length > k_max_request || (message.msg_flags & MSG_CTRUNC)) {
+        return std::nullopt;
+    }
+    auto payload = std::string(length, '\0');
+    if (not read_all(fd, payload.data(), payload.size())) {
+        return std::nullopt;
+    }
+
+    auto counts = std::array<std::uint32_t, 2>();
+    std::memcpy(counts.data(), payload.data(), sizeof(counts));
+    auto rest = std::string_view(payload).substr(sizeof(counts));
+    auto const next = [&rest]() -> std::optional<std::string> {
+        auto end = rest.find('\0');
+        if (end == rest.npos) {
+            return std::nullopt;
+        }
+        auto result = std::string(rest.substr(0, end));
+        rest.remove_prefix(end + 1);
+        return result;
+    };
+    auto result = request_t();
+    for (auto [strings, count] : { std::pair(&result.arguments, counts[0]), std::pair(&result.environment, counts[1]) }) {
+        // Every string takes at least its NUL, so a count beyond that is corrupt.
+        if (count > rest.size()) {
+            return std::nullopt;
+        }
+        strings->reserve(count);
+        for (auto i = 0u; i < count; ++i) {
+            auto str = next();
+            if (not str) {
+                return std::nullopt;
+            }
+            strings->push_back(*std::move(str));
+        }
+    }
+    auto directory = next();
+    if (not directory || not rest.empty()) {
+        return std::nullopt;
+    }
+    result.directory = *std::move(directory);
+    return result;
+}
+
+bool peer_is_owner(int fd) {
+    auto credentials = ucred {};
+    auto size = socklen_t(sizeof(credentials));
+    return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0 && credentials.uid == ::getuid();
+}
+
+std::optional<int> forward_request(stdf::path const& socket, int argc, char* argv[]) {
+    auto address = sockaddr_un {};
+    address.sun_family = AF_UNIX;
+    if (socket.native().size() >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    std::strcpy(address.sun_path, socket.c_str());
+
+    auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    // The environment and the stdio only go to a server of our own.
+    if (not peer_is_owner(fd)) {
+        std::fprintf(stderr, "ysh: %s belongs to another user, running without the server\n", socket.c_str());
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    auto request = request_t { .arguments = { argv, argv + argc } };
+    for (auto** var = environ; *var; ++var) {
+        request.environment.emplace_back(*var);
+    }
+    auto err = std::error_code();
+    request.directory = stdf::current_path(err).string();
+    auto const stdio = std::array { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    if (not send_request(fd, request, stdio)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    auto code = std::int32_t();
+    auto replied = read_all(fd, reinterpret_cast<char*>(&code), sizeof(code));
+    ::close(fd);
+    if (not replied) {
+        // The request was taken, so running it again here could run it twice.
+        std::fputs("ysh: the server closed the connection\n", stderr);
+        return EXIT_FAILURE;
+    }
+    return code;
+}
+
+int client_main(int argc, char* argv[]) {
+    if (auto code = forward_request(default_socket(), argc, argv)) {
+        return *code;
+    }
+    auto const interpreter = interpreter_path();
+    // Executing the client again would only fall back again, for good.
+    auto err = std::error_code();
+    if (stdf::equivalent(interpreter, "/proc/self/exe", err)) {
+        std::fprintf(stderr, "ysh: %s is the client, not an interpreter\n", interpreter.c_str());
+        return 127;
+    }
+    ::execv(interpreter.c_str(), argv);
+    std::fprintf(stderr, "ysh: %s: %s\n", interpreter.c_str(), std::strerror(errno));
+    return 127;
+}
+
+} // namespace ysh
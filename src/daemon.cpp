@@ -0,0 +1,131 @@
+#include "../include/daemon.hpp"
+#include "../include/ysh.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace ysh {
+
+/**
+ * @brief Serve a single request as a warm interpreter. The process takes the place of the client,
+ * stdio and all, so it's never reused.
+ *
+ * @return int The exit code of the run.
+ */
+static int serve_one(int listener) {
+    auto fd = int();
+    do {
+        fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    ::close(listener);
+    if (fd < 0) {
+        return EXIT_FAILURE;
+    }
+    // The socket only lets the owner in, but a client of another user mustn't run code as this one.
+    if (not peer_is_owner(fd)) {
+        ::close(fd);
+        return EXIT_FAILURE;
+    }
+
+    auto fds = std::vector<int>();
+    auto request = receive_request(fd, fds);
+    if (not request || fds.size() != 3 || request->arguments.empty()) {
+        return EXIT_FAILURE;
+    }
+    for (auto i = 0; i < 3; ++i) {
+        ::dup2(fds[i], i);
+        ::close(fds[i]);
+    }
+    auto err = std::error_code();
+    stdf::current_path(request->directory, err);
+    // putenv keeps the strings themselves, and so does ysh_main with the arguments: both live on until
+    // the process exits.
+    ::clearenv();
+    for (auto& var : request->environment) {
+        ::putenv(var.data());
+    }
+    auto argv = std::vector<char*>();
+    for (auto& arg : request->arguments) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    auto code = std::int32_t(EXIT_FAILURE);
+    try {
+        code = ysh_main(int(argv.size() - 1), argv.data());
+    }
+    catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    ::send(fd, &code, sizeof(code), MSG_NOSIGNAL);
+    return code;
+}
+
+int serve(stdf::path const& socket, std::size_t pool_size) {
+    auto address = sockaddr_un {};
+    address.sun_family = AF_UNIX;
+    if (socket.native().size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path too long: " << socket << "\n";
+        return EXIT_FAILURE;
+    }
+    std::strcpy(address.sun_path, socket.c_str());
+
+    // A socket left behind by a server that's gone would make bind fail.
+    auto err = std::error_code();
+    if (stdf::is_socket(stdf::symlink_status(socket, err))) {
+        stdf::remove(socket, err);
+        if (err) {
+            std::cerr << "Error: failed to remove the stale socket " << socket << ": " << err.message() << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    auto listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    // Only the owner may connect: whoever connects runs code with the server's privileges.
+    auto mask = ::umask(0077);
+    auto bound = listener >= 0 && ::bind(listener, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == 0;
+    ::umask(mask);
+    if (not bound || ::listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Error: failed to listen on " << socket << ": " << std::strerror(errno) << "\n";
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        return EXIT_FAILURE;
+    }
+
+    // Anything buffered would otherwise be written once more by every interpreter.
+    std::cout.flush();
+    std::cerr.flush();
+    auto const spawn = [listener] {
+        auto pid = ::fork();
+        if (pid == 0) {
+            std::_Exit(serve_one(listener));
+        }
+        return pid;
+    };
+    auto pool = std::unordered_set<pid_t>();
+    for (auto i = 0uz; i < std::max(pool_size, 1uz); ++i) {
+        if (auto pid = spawn(); pid > 0) {
+            pool.insert(pid);
+        }
+    }
+    while (not pool.empty()) {
+        auto pid = ::waitpid(-1, nullptr, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pool.erase(pid)) {
+            if (auto fresh = spawn(); fresh > 0) {
+                pool.insert(fresh);
+            }
+        }
+    }
+    ::close(listener);
+    return EXIT_FAILURE;
+}
+
+} // namespace ysh
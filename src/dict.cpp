@@ -0,0 +1,251 @@
+#include "../include/entity.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ysh::types {
+
+static constexpr std::int8_t k_empty = -128;
+static constexpr std::int8_t k_deleted = -2;
+
+/**
+ * @brief Finish a hash so that both the low bits (the control byte) and the high bits (the probe
+ * start) depend on all the input bits. Entity hashes of small Ints are the Ints themselves.
+ */
+static std::size_t mix(std::size_t hash) noexcept {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static std::int8_t control_of(std::size_t hash) noexcept {
+    return std::int8_t(hash & 0x7f);
+}
+
+/**
+ * @brief A bitmask of the control bytes in the group starting at @param control that equal @param byte.
+ */
+static std::uint32_t match(std::int8_t const* control, std::int8_t byte) noexcept {
+#ifdef __SSE2__
+    auto group = _mm_loadu_si128(reinterpret_cast<__m128i const*>(control));
+    return std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte))));
+#else
+    auto result = std::uint32_t();
+    for (auto i = 0uz; i < dict_t::k_group_width; ++i) {
+        result |= std::uint32_t(control[i] == byte) << i;
+    }
+    return result;
+#endif
+}
+
+/**
+ * @brief A bitmask of the empty or deleted control bytes in the group starting at @param control.
+ * Those are exactly the negative ones.
+ */
+static std::uint32_t match_free(std::int8_t const* control) noexcept {
+#ifdef __SSE2__
+    return std::uint32_t(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(control))));
+#else
+    auto result = std::uint32_t();
+    for (auto i = 0uz; i < dict_t::k_group_width; ++i) {
+        result |= std::uint32_t(control[i] < 0) << i;
+    }
+    return result;
+#endif
+}
+
+/**
+ * @brief The maximum number of keys in a table with @param capacity slots, i.e. a load factor of 7/8.
+ */
+static std::size_t max_load(std::size_t capacity) noexcept {
+    return capacity - capacity / 8;
+}
+
+dict_t::iterator::iterator(dict_t const* dict, std::size_t index) noexcept
+    : m_dict(dict), m_index(index) {}
+
+dict_t::value_type const& dict_t::iterator::operator *() const noexcept {
+    return m_dict->m_slots[m_index];
+}
+
+dict_t::value_type const* dict_t::iterator::operator ->() const noexcept {
+    return m_dict->m_slots + m_index;
+}
+
+dict_t::iterator& dict_t::iterator::operator ++() noexcept {
+    while (++m_index < m_dict->m_capacity && m_dict->m_control[m_index] < 0) {}
+    return *this;
+}
+
+dict_t::dict_t(dict_t const& other)
+    : dict_t() {
+    this->reserve(other.size());
+    for (auto const& [key, value] : other) {
+        this->try_emplace(key, value);
+    }
+}
+
+dict_t::dict_t(dict_t&& other) noexcept
+    : m_control(std::move(other.m_control)),
+      m_slots(std::exchange(other.m_slots, nullptr)),
+      m_capacity(std::exchange(other.m_capacity, 0)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_growth_left(std::exchange(other.m_growth_left, 0)) {}
+
+dict_t::~dict_t() {
+    for (auto i = 0uz; i < m_capacity; ++i) {
+        if (m_control[i] >= 0) {
+            std::destroy_at(m_slots + i);
+        }
+    }
+    ::operator delete(m_slots);
+}
+
+dict_t& dict_t::operator =(dict_t other) noexcept {
+    std::swap(m_control, other.m_control);
+    std::swap(m_slots, other.m_slots);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_size, other.m_size);
+    std::swap(m_growth_left, other.m_growth_left);
+    return *this;
+}
+
+std::size_t dict_t::find_slot(entity const& key, std::size_t hash) const {
+    if (m_capacity == 0) {
+        return m_capacity;
+    }
+    auto const groups = m_capacity / k_group_width;
+    auto const control = control_of(hash);
+    // Triangular probing over the groups visits every group once, since their number is a power of two.
+    for (auto group = (hash >> 7) & (groups - 1), step = 0uz; ; group = (group + ++step) & (groups - 1)) {
+        auto const* bytes = m_control.get() + group * k_group_width;
+        for (auto candidates = match(bytes, control); candidates != 0; candidates &= candidates - 1) {
+            auto slot = group * k_group_width + std::countr_zero(candidates);
+            if (m_slots[slot].first.equivalent(key)) {
+                return slot;
+            }
+        }
+        // The key would have been put in this group, had it been inserted.
+        if (match(bytes, k_empty) != 0 || step == groups) {
+            return m_capacity;
+        }
+    }
+}
+
+std::size_t dict_t::claim_slot(std::size_t hash) {
+    if (m_growth_left == 0) {
+        // Rehashing in place is enough if most of the used slots are merely deleted.
+        auto capacity = m_size < max_load(m_capacity) / 2 ? m_capacity : m_capacity * 2;
+        this->rehash(std::max(capacity, k_group_width));
+    }
+    auto const groups = m_capacity / k_group_width;
+    for (auto group = (hash >> 7) & (groups - 1), step = 0uz; ; group = (group + ++step) & (groups - 1)) {
+        auto* bytes = m_control.get() + group * k_group_width;
+        if (auto free = match_free(bytes); free != 0) {
+            auto slot = group * k_group_width + std::countr_zero(free);
+            if (m_control[slot] == k_empty) {
+                --m_growth_left;
+            }
+            m_control[slot] = control_of(hash);
+            ++m_size;
+            return slot;
+        }
+    }
+}
+
+void dict_t::rehash(std::size_t capacity) {
+    auto old_control = std::move(m_control);
+    auto* old_slots = std::exchange(m_slots, nullptr);
+    auto old_capacity = m_capacity;
+
+    m_control = std::make_unique<std::int8_t[]>(capacity);
+    std::fill_n(m_control.get(), capacity, k_empty);
+    m_slots = static_cast<value_type*>(::operator new(capacity * sizeof(value_type)));
+    m_capacity = capacity;
+    m_growth_left = max_load(capacity);
+    m_size = 0;
+
+    for (auto i = 0uz; i < old_capacity; ++i) {
+        if (old_control[i] >= 0) {
+            auto& [key, value] = old_slots[i];
+            auto slot = this->claim_slot(mix(key.hash()));
+            std::construct_at(m_slots + slot, std::move(key), std::move(value));
+            std::destroy_at(old_slots + i);
+        }
+    }
+    ::operator delete(old_slots);
+}
+
+void dict_t::reserve(std::size_t count) {
+    if (count <= m_size + m_growth_left) {
+        return;
+    }
+    auto capacity = std::bit_ceil(std::max(count + count / 7 + 1, k_group_width));
+    this->rehash(capacity);
+}
+
+entity const* dict_t::find(entity const& key) const {
+    auto slot = this->find_slot(key, mix(key.hash()));
+    return slot == m_capacity ? nullptr : &m_slots[slot].second;
+}
+
+std::pair<entity*, bool> dict_t::try_emplace(entity key, entity value) {
+    auto hash = mix(key.hash());
+    if (auto slot = this->find_slot(key, hash); slot != m_capacity) {
+        return { &m_slots[slot].second, false };
+    }
+    auto slot = this->claim_slot(hash);
+    std::construct_at(m_slots + slot, std::move(key), std::move(value));
+    return { &m_slots[slot].second, true };
+}
+
+bool dict_t::insert_or_assign(entity key, entity value) {
+    auto [bound, inserted] = this->try_emplace(std::move(key), value);
+    if (not inserted) {
+        *bound = std::move(value);
+    }
+    return inserted;
+}
+
+bool dict_t::erase(entity const& key) {
+    auto slot = this->find_slot(key, mix(key.hash()));
+    if (slot == m_capacity) {
+        return false;
+    }
+    std::destroy_at(m_slots + slot);
+    --m_size;
+    // If the group still has an empty slot, no probe ever went past it, so the slot can be empty again.
+    auto const* group = m_control.get() + slot / k_group_width * k_group_width;
+    if (match(group, k_empty) != 0) {
+        m_control[slot] = k_empty;
+        ++m_growth_left;
+    }
+    else {
+        m_control[slot] = k_deleted;
+    }
+    return true;
+}
+
+dict_t::iterator dict_t::begin() const noexcept {
+    auto it = iterator(this, 0);
+    if (m_capacity != 0 && m_control[0] < 0) {
+        ++it;
+    }
+    return it;
+}
+
+bool operator ==(dict_t const& lhs, dict_t const& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    return stdr::all_of(lhs, [&rhs](auto const& pair) {
+        auto const* value = rhs.find(pair.first);
+        return value && value->equivalent(pair.second);
+    });
+}
+
+} // namespace ysh::types
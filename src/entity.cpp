@@ -1,4 +1,7 @@
 #include "../include/entity.hpp"
+#include "../include/channel.hpp"
+#include "../include/event_loop.hpp"
+#include "../include/numeric.hpp"
 
 namespace ysh::types {
 
@@ -19,16 +22,21 @@ entity grammar_error(std::string const& err_msg) {
  * @return The error entity.
  */
 entity operation_error(std::string const& type, std::vector<std::string> const& arg_types, std::string const& op, std::string const& err_msg) {
-    auto sstrm = std::ostringstream();
-    sstrm << "Operation Error: " << err_msg
-          << "\n\twith primary object's type: " << type
-          << "\n\tOperator: " << op
-          << (not arg_types.empty() ? "\n\tArguments: " : "");
-    for (auto i = 0uz; i < arg_types.size() - 1; ++i) {
-        sstrm << arg_types[i] << ", ";
+    auto msg = std::string("Operation Error: ");
+    msg += err_msg;
+    msg += "\n\twith primary object's type: ";
+    msg += type;
+    msg += "\n\tOperator: ";
+    msg += op;
+    if (not arg_types.empty()) {
+        msg += "\n\tArguments: ";
+        msg += arg_types.front();
+        for (auto const& arg_type : arg_types | stdv::drop(1)) {
+            msg += ", ";
+            msg += arg_type;
+        }
     }
-    sstrm << arg_types.back();
-    return standard_error(sstrm.str());
+    return standard_error(std::move(msg));
 }
 
 void throw_arithmetic_error(std::string const& err_msg) {
@@ -55,15 +63,6 @@ tuple_t::tuple_t(tuple_t const& other) {
     *this = other;
 }
 
-template<typename InputIt>
-tuple_t::tuple_t(InputIt first, InputIt last) : tuple_t() {
-    auto* tupptr = this;
-    while (first != last) {
-        tupptr->data = data_ptr(new data_type(std::make_pair(*first++, tuple_t())));
-        tupptr = &this->content().second;
-    }
-}
-
 tuple_t tuple_t::concat(tuple_t const& other) const  {
     auto s = std::stack<entity>();
     auto* tupptr = this;
@@ -102,13 +101,15 @@ void tuple_t::for_each(auto&& func) const {
 }
 
 tuple_t& tuple_t::operator =(tuple_t const& other) {
-    auto* tupptr = this;
-    auto* othptr = &other;
-    while (!othptr->empty()) {
-        auto&& [head, tail] = othptr->content();
-        tupptr->push(head);
-        othptr = &tail;
+    if (this == &other) {
+        return *this;
     }
+    data.reset();
+    auto* tupptr = this;
+    other.for_each([&tupptr](entity const& item) {
+        tupptr->data = data_ptr(new data_type(item, tuple_t()));
+        tupptr = &tupptr->content().second;
+    });
     return *this;
 }
 
@@ -139,53 +140,288 @@ entity tuple_t::value() const {
     return this->content().first;
 }
 
-void entity::value_deleter::operator ()(entity::value_type* dat) const {
-    delete dat;
+// The coroutines take their arguments by value, so that they live in the coroutine frames.
+
+static generator<entity> generate_range(int_t first, int_t last) {
+    if (first > last) {
+        co_return;
+    }
+    for (auto i = first; ; ++i) {
+        co_yield entity(i);
+        if (i == last) {
+            break;
+        }
+    }
 }
 
-template<not_of<entity> T>
-entity::entity(T&& value) {
-    using enum type;
-    using type = TYPE(value);
+/**
+ * @brief The elements of @param list, which @param owner keeps alive.
+ */
+static generator<entity> generate_list([[maybe_unused]] std::shared_ptr<void const> owner, list_t const& list) {
+    for (auto const& elem : list) {
+        co_yield elem;
+    }
+}
+
+struct seq_t::recipe {
+    struct stage {
+        enum kind_type { MAP, FILTER, TAKE } kind;
+        func_t func {};
+        std::size_t count = 0;
+    };
+
+    std::variant<source_type, std::pair<int_t, int_t>, list_t> source;
+    std::vector<stage> stages {};
+
+    /**
+     * @brief A copy of the recipe with @param next as its last stage.
+     */
+    [[nodiscard]]
+    seq_t then(stage next) const {
+        auto result = std::make_shared<recipe>(*this);
+        result->stages.push_back(std::move(next));
+        return seq_t(std::move(result));
+    }
 
-    m_value = std::unique_ptr<value_type, value_deleter>();
+    /**
+     * @brief How many elements each take lets through in a pass, or nothing if one lets none, in which
+     * case the pass generates no element at all.
+     */
+    [[nodiscard]]
+    std::optional<std::vector<std::size_t>> start() const {
+        auto left = std::vector<std::size_t>(stages.size());
+        for (auto i = 0uz; i < stages.size(); ++i) {
+            if (stages[i].kind == stage::TAKE && (left[i] = stages[i].count) == 0) {
+                return std::nullopt;
+            }
+        }
+        return left;
+    }
 
-    if constexpr (std::is_integral_v<type>) {
-        *m_value = int_t(value);
-        m_type = INT;
+    /**
+     * @brief Put @param elem through the stages, counting down @param left (see @ref start).
+     * @param last Set if a take let its last element through, after which the pass ends.
+     * @return bool Whether @param elem made it through every stage.
+     */
+    bool advance(entity& elem, std::vector<std::size_t>& left, bool& last) const {
+        for (auto i = 0uz; i < stages.size(); ++i) {
+            switch (stages[i].kind) {
+            case stage::MAP:
+                elem = stages[i].func(std::move(elem));
+                break;
+            case stage::FILTER:
+                if (not bool(stages[i].func(elem))) {
+                    return false;
+                }
+                break;
+            case stage::TAKE:
+                last = last || --left[i] == 0;
+                break;
+            }
+        }
+        return true;
     }
-    else if constexpr (std::is_floating_point_v<type>) {
-        *m_value = real_t(value);
-        m_type = REAL;
+
+    /**
+     * @brief The elements of the source of @param self.
+     */
+    static generator<entity> elements(std::shared_ptr<recipe const> const& self) {
+        return std::visit(overload {
+                [](source_type const& source) {
+                    return source();
+                },
+                [](std::pair<int_t, int_t> const& range) {
+                    return generate_range(range.first, range.second);
+                },
+                [&self](list_t const& list) {
+                    return generate_list(self, list);
+                }
+        }, self->source);
     }
-    else if constexpr (std::convertible_to<type, std::string>) {
-        *m_value = str_t(value);
-        m_type = STR;
+
+    static generator<entity> generate(std::shared_ptr<recipe const> self) {
+        auto left = self->start();
+        if (not left) {
+            co_return;
+        }
+        auto last = false;
+        for (auto const& source_elem : elements(self)) {
+            auto elem = source_elem;
+            if (self->advance(elem, *left, last)) {
+                co_yield elem;
+            }
+            if (last) {
+                break;
+            }
+        }
     }
-    else if constexpr (std::same_as<list_t, type>) {
-        *m_value = list_t(FWD(value));
-        m_type = LIST;
+};
+
+seq_t::seq_t(source_type source)
+    : m_recipe(std::make_shared<recipe const>(recipe { .source = std::move(source) })) {}
+
+seq_t seq_t::range(int_t first, int_t last) {
+    return seq_t(std::make_shared<recipe const>(recipe { .source = std::pair(first, last) }));
+}
+
+seq_t seq_t::of(list_t list) {
+    return seq_t(std::make_shared<recipe const>(recipe { .source = std::move(list) }));
+}
+
+generator<entity> seq_t::iterate() const {
+    if (m_recipe->stages.empty()) {
+        return recipe::elements(m_recipe);
     }
-    else if constexpr (std::same_as<tuple_t, type>) {
-        *m_value = tuple_t(FWD(value));
-        m_type = TUPLE;
+    return recipe::generate(m_recipe);
+}
+
+bool seq_t::for_each(std::function<bool (entity const&)> const& sink) const {
+    auto left = m_recipe->start();
+    if (not left) {
+        return true;
     }
-    else if constexpr (std::same_as<func_t, type>) {
-        *m_value = func_t(FWD(value));
-        m_type = FUNC;
+    auto last = false;
+    auto stopped = false;
+    auto const push = [&](entity elem) {
+        if (m_recipe->advance(elem, *left, last) && not sink(elem)) {
+            stopped = true;
+        }
+        return not stopped && not last;
+    };
+    std::visit(overload {
+            [&push](source_type const& source) {
+                for (auto const& elem : source()) {
+                    if (not push(elem)) {
+                        break;
+                    }
+                }
+            },
+            [&push](std::pair<int_t, int_t> const& range) {
+                if (range.first > range.second) {
+                    return;
+                }
+                for (auto i = range.first; push(entity(i)) && i != range.second; ++i) {}
+            },
+            [&push](list_t const& list) {
+                for (auto const& elem : list) {
+                    if (not push(elem)) {
+                        break;
+                    }
+                }
+            }
+    }, m_recipe->source);
+    return not stopped;
+}
+
+seq_t seq_t::map(func_t func) const {
+    return m_recipe->then({ .kind = recipe::stage::MAP, .func = std::move(func) });
+}
+
+seq_t seq_t::filter(func_t pred) const {
+    return m_recipe->then({ .kind = recipe::stage::FILTER, .func = std::move(pred) });
+}
+
+seq_t seq_t::take(std::size_t count) const {
+    return m_recipe->then({ .kind = recipe::stage::TAKE, .count = count });
+}
+
+list_t seq_t::to_list() const {
+    auto result = list_t();
+    this->for_each([&result](entity const& elem) {
+        result.push_back(elem);
+        return true;
+    });
+    return result;
+}
+
+struct chan_t::state {
+    static constexpr std::uint64_t k_closed = std::uint64_t(1) << 63;
+
+    mpmc_channel<entity> channel;
+    // The number of sends in progress, plus k_closed once the channel is closed. The underlying
+    // channel is closed by whichever of close and the sends in progress is last, so that a value
+    // is never pushed after it.
+    std::atomic<std::uint64_t> senders = 0;
+
+    explicit state(std::size_t capacity)
+        : channel(capacity) {}
+};
+
+chan_t::chan_t(std::size_t capacity)
+    : m_state(std::make_shared<state>(capacity)) {}
+
+bool chan_t::send(entity value) const {
+    if (m_state->senders.fetch_add(1, std::memory_order_acquire) & state::k_closed) {
+        m_state->senders.fetch_sub(1, std::memory_order_release);
+        return false;
     }
-    else if constexpr (std::convertible_to<type, error_t>) {
-        *m_value = error_t(value);
-        m_type = ERROR;
+    m_state->channel.push(std::move(value));
+    if (m_state->senders.fetch_sub(1, std::memory_order_acq_rel) == (state::k_closed | 1)) {
+        m_state->channel.close();
     }
-    else {
-        *m_value = error_t("Unsupported type");
-        m_type = ERROR;
+    return true;
+}
+
+std::optional<entity> chan_t::receive() const {
+    return m_state->channel.pop();
+}
+
+void chan_t::close() const {
+    if (m_state->senders.fetch_or(state::k_closed, std::memory_order_acq_rel) == 0) {
+        m_state->channel.close();
     }
 }
 
+seq_t chan_t::received() const {
+    return seq_t([state = m_state]() -> generator<entity> {
+        while (auto value = state->channel.pop()) {
+            co_yield std::move(*value);
+        }
+    });
+}
+
+struct future_t::state {
+    // What the thread writes to, kept apart so that the thread never holds the last reference to the
+    // state, which joins it.
+    struct result_type {
+        std::atomic<bool> done = false;
+        entity value;
+    };
+
+    std::shared_ptr<result_type> result = std::make_shared<result_type>();
+    std::jthread thread;
+};
+
+future_t::future_t(task_type task)
+    : m_state(std::make_shared<state>()) {
+    m_state->thread = std::jthread([result = m_state->result, task = std::move(task)] {
+        block_loop_signals();
+        try {
+            result->value = task();
+        }
+        catch (std::exception const& e) {
+            result->value = standard_error(e.what());
+        }
+        result->done.store(true, std::memory_order_release);
+        result->done.notify_all();
+    });
+}
+
+bool future_t::ready() const noexcept {
+    return m_state->result->done.load(std::memory_order_acquire);
+}
+
+entity const& future_t::get() const {
+    m_state->result->done.wait(false, std::memory_order_acquire);
+    return m_state->result->value;
+}
+
+void entity::value_deleter::operator ()(entity::payload* dat) const {
+    delete dat;
+}
+
 entity::entity(entity const& other)
-    : m_value(new value_type(*other.m_value)), m_type(other.m_type) {}
+    : m_value(other.m_value ? new payload(*other.m_value) : nullptr), m_type(other.m_type) {}
 
 std::string entity::name(type t) noexcept {
     switch (t) {
@@ -196,6 +432,11 @@ std::string entity::name(type t) noexcept {
         case TUPLE: return "Tuple";
         case FUNC:  return "Func";
         case ERROR: return "Error";
+        case BIGINT: return "Int";
+        case SEQ:   return "Seq";
+        case DICT:  return "Dict";
+        case CHAN:  return "Chan";
+        case FUTURE: return "Future";
         default:    return "Unknown";
     }
 }
@@ -210,6 +451,11 @@ entity::type entity::of(T&&) noexcept {
             { std::type_index(typeid(list_t)), LIST },
             { std::type_index(typeid(func_t)), FUNC },
             { std::type_index(typeid(error_t)), ERROR },
+            { std::type_index(typeid(bigint_t)), BIGINT },
+            { std::type_index(typeid(seq_t)), SEQ },
+            { std::type_index(typeid(dict_t)), DICT },
+            { std::type_index(typeid(chan_t)), CHAN },
+            { std::type_index(typeid(future_t)), FUTURE },
     };
     return type_map.at(std::type_index(typeid(T)));
 }
@@ -219,7 +465,7 @@ entity& entity::operator =(entity const& other) {
         return *this;
     }
     m_type = other.m_type;
-    // m_value = other.m_value;
+    m_value.reset(other.m_value ? new payload(*other.m_value) : nullptr);
     return *this;
 }
 
@@ -261,6 +507,20 @@ std::partial_ordering operator <=>(tuple_t const& lhs, tuple_t const& rhs) noexc
 }
 
 entity operator +(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            if constexpr (std::same_as<int_t, TYPE(arg_1)>) {
+                auto result = int_t();
+                if (__builtin_add_overflow(arg_1, arg_2, &result)) [[unlikely]] {
+                    return entity(bigint_t(arg_1) + bigint_t(arg_2));
+                }
+                return entity(result);
+            }
+            else {
+                return entity(arg_1 + arg_2);
+            }
+        });
+    }
     return std::visit(overload {
             [](list_t const& arg_1, list_t const& arg_2) {
                 if (arg_1.size() != arg_2.size()) {
@@ -284,14 +544,14 @@ entity operator +(entity const& lhs, entity const& rhs) {
                 else if constexpr (std::same_as<str_t, type_1> && std::same_as<str_t, type_2>) {
                     return entity(arg_1 + arg_2);
                 }
-                else if constexpr (arithmetic<type_1> && std::same_as<list_t, type_2>) {
+                else if constexpr (numeric<type_1> && std::same_as<list_t, type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_2) {
                         result.push_back(entity(arg_1) + ent);
                     }
                     return entity(result);
                 }
-                else if constexpr (std::same_as<list_t, type_1> && arithmetic<type_2>) {
+                else if constexpr (std::same_as<list_t, type_1> && numeric<type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_1) {
                         result.push_back(ent + entity(arg_2));
@@ -300,10 +560,24 @@ entity operator +(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(+)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator -(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            if constexpr (std::same_as<int_t, TYPE(arg_1)>) {
+                auto result = int_t();
+                if (__builtin_sub_overflow(arg_1, arg_2, &result)) [[unlikely]] {
+                    return entity(bigint_t(arg_1) - bigint_t(arg_2));
+                }
+                return entity(result);
+            }
+            else {
+                return entity(arg_1 - arg_2);
+            }
+        });
+    }
     return std::visit(overload {
             [](list_t const& arg_1, list_t const& arg_2) {
                 if (arg_1.size() != arg_2.size()) {
@@ -321,14 +595,14 @@ entity operator -(entity const& lhs, entity const& rhs) {
                 if constexpr (arithmetic<type_1> && arithmetic<type_2>) {
                     return entity(arg_1 - arg_2);
                 }
-                else if constexpr (arithmetic<type_1> && std::same_as<type_2, list_t>) {
+                else if constexpr (numeric<type_1> && std::same_as<type_2, list_t>) {
                     auto result = list_t();
                     for (auto&& ent : arg_2) {
                         result.emplace_back(entity(arg_1) - ent);
                     }
                     return entity(result);
                 }
-                else if constexpr (std::same_as<type_1, list_t> && arithmetic<type_2>) {
+                else if constexpr (std::same_as<type_1, list_t> && numeric<type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_1) {
                         result.emplace_back(ent - entity(arg_2));
@@ -337,24 +611,30 @@ entity operator -(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(-)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator *(entity const& lhs, entity const& rhs) {
-    return std::visit(overload {
-            [](int_t arg_1, str_t const& arg_2) -> entity {
-                str_t result;
-                while (arg_1-- > 0) {
-                    result += arg_2;
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            if constexpr (std::same_as<int_t, TYPE(arg_1)>) {
+                auto result = int_t();
+                if (__builtin_mul_overflow(arg_1, arg_2, &result)) [[unlikely]] {
+                    return entity(bigint_t(arg_1) * bigint_t(arg_2));
                 }
                 return entity(result);
+            }
+            else {
+                return entity(arg_1 * arg_2);
+            }
+        });
+    }
+    return std::visit(overload {
+            [](int_t arg_1, str_t const& arg_2) -> entity {
+                return entity(str_t::repeat(arg_2, std::size_t(std::max<int_t>(arg_1, 0))));
             },
             [](str_t const& arg_1, int_t arg_2) -> entity {
-                str_t result;
-                while (arg_2-- > 0) {
-                    result += arg_1;
-                }
-                return entity(result);
+                return entity(str_t::repeat(arg_1, std::size_t(std::max<int_t>(arg_2, 0))));
             },
             [](list_t const& arg_1, list_t const& arg_2) -> entity {
                 if (arg_1.size() != arg_2.size()) {
@@ -372,14 +652,14 @@ entity operator *(entity const& lhs, entity const& rhs) {
                 if constexpr (arithmetic<type_1> && arithmetic<type_2>) {
                     return entity(arg_1 * arg_2);
                 }
-                else if constexpr (arithmetic<type_1> && std::same_as<type_2, list_t>) {
+                else if constexpr (numeric<type_1> && std::same_as<type_2, list_t>) {
                     auto result = list_t();
                     for (auto&& ent : arg_2) {
                         result.emplace_back(entity(arg_1) * ent);
                     }
                     return entity(result);
                 }
-                else if constexpr (std::same_as<type_1, list_t> && arithmetic<type_2>) {
+                else if constexpr (std::same_as<type_1, list_t> && numeric<type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_1) {
                         result.emplace_back(ent * entity(arg_2));
@@ -388,10 +668,32 @@ entity operator *(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(*)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator /(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            if constexpr (std::same_as<bigint_t, TYPE(arg_1)>) {
+                if (arg_2.zero()) {
+                    return entity(error_t("Division by zero."));
+                }
+                return entity(arg_1 / arg_2);
+            }
+            else {
+                if (arg_2 == 0) {
+                    return entity(error_t("Division by zero."));
+                }
+                if constexpr (std::same_as<int_t, TYPE(arg_1)>) {
+                    // The only quotient of two Ints that overflows.
+                    if (arg_1 == std::numeric_limits<int_t>::min() && arg_2 == -1) [[unlikely]] {
+                        return entity(-bigint_t(arg_1));
+                    }
+                }
+                return entity(arg_1 / arg_2);
+            }
+        });
+    }
     return std::visit(overload {
             [](list_t const& arg_1, list_t const& arg_2) -> entity {
                 if (arg_1.size() != arg_2.size()) {
@@ -412,14 +714,14 @@ entity operator /(entity const& lhs, entity const& rhs) {
                     }
                     return entity(arg_1 / arg_2);
                 }
-                else if constexpr (arithmetic<type_1> && std::same_as<type_2, list_t>) {
+                else if constexpr (numeric<type_1> && std::same_as<type_2, list_t>) {
                     auto result = list_t();
                     for (auto&& ent : arg_2) {
                         result.emplace_back(entity(arg_1) / ent);
                     }
                     return entity(result);
                 }
-                else if constexpr (std::same_as<type_1, list_t> && arithmetic<type_2>) {
+                else if constexpr (std::same_as<type_1, list_t> && numeric<type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_1) {
                         result.emplace_back(ent / entity(arg_2));
@@ -428,10 +730,24 @@ entity operator /(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(/)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator %(entity const& lhs, entity const& rhs) {
+    if (lhs.is_integral() && rhs.is_integral()) [[likely]] {
+        return entity::integral(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            if (not arg_2) {
+                return entity(error_t("Division by zero."));
+            }
+            if constexpr (std::same_as<int_t, TYPE(arg_1)>) {
+                // INT_MIN % -1 traps on x86 even though the remainder is 0.
+                if (arg_2 == -1) {
+                    return entity(0);
+                }
+            }
+            return entity(arg_1 % arg_2);
+        });
+    }
     return std::visit(overload {
             [](int_t arg_1, int_t arg_2) -> entity {
                 if (arg_2 == 0) {
@@ -466,11 +782,80 @@ entity operator %(entity const& lhs, entity const& rhs) {
             [](auto&& arg_1, auto&& arg_2) -> entity {
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(%)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
+}
+
+/**
+ * @brief The number of bits above which a power isn't computed: squaring its way there would take
+ * minutes, and its digits would fill a screen a hundred times over.
+ */
+static constexpr std::uint64_t k_max_power_bits = std::uint64_t(1) << 20;
+
+/**
+ * @brief Raise @param base to @param exp on bigint_t, or fail with an overflow if the result would
+ * take more than k_max_power_bits.
+ */
+static entity checked_power(bigint_t const& base, std::uint64_t exp) {
+    // Only 0, 1 and -1 have powers of any size.
+    if (base.zero() || base == bigint_t(1)) {
+        return entity(base);
+    }
+    if (base == bigint_t(-1)) {
+        return entity(exp & 1 ? -1 : 1);
+    }
+    auto const& limbs = base.limbs();
+    auto bits = std::uint64_t(limbs.size()) * 32 - std::uint64_t(std::countl_zero(limbs.back()));
+    if (exp > k_max_power_bits / bits) {
+        return entity(error_t("Integer overflow."));
+    }
+    return entity(bigint_t::pow(base, exp));
+}
+
+static entity int_power(int_t base, int_t exp) {
+    if (exp < 0) {
+        return entity(std::pow(real_t(base), real_t(exp)));
+    }
+    // Exponentiation by squaring keeps integer powers exact; it's redone on bigint_t once it overflows.
+    auto result = int_t(1);
+    for (auto n = exp, square = base; n > 0; ) {
+        if ((n & 1) && __builtin_mul_overflow(result, square, &result)) {
+            return checked_power(bigint_t(base), std::uint64_t(exp));
+        }
+        if ((n >>= 1) > 0 && __builtin_mul_overflow(square, square, &square)) {
+            return checked_power(bigint_t(base), std::uint64_t(exp));
+        }
+    }
+    return entity(result);
+}
+
+static entity big_power(bigint_t const& base, bigint_t const& exp) {
+    if (exp.negative()) {
+        return entity(std::pow(real_t(base), real_t(exp)));
+    }
+    // An exponent that doesn't fit overflows anyway, unless the base is 0, 1 or -1: only its parity
+    // matters then, and it's kept.
+    auto const largest = std::numeric_limits<std::uint64_t>::max() - 1 + (exp.limbs().front() & 1);
+    return checked_power(base, exp.fits() ? std::uint64_t(static_cast<long long>(exp)) : largest);
 }
 
 entity operator ^(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            if constexpr (std::same_as<int_t, TYPE(arg_1)>) {
+                return int_power(arg_1, arg_2);
+            }
+            else if constexpr (std::same_as<bigint_t, TYPE(arg_1)>) {
+                return big_power(arg_1, arg_2);
+            }
+            else {
+                return entity(std::pow(arg_1, arg_2));
+            }
+        });
+    }
     return std::visit(overload {
+            [](int_t arg_1, int_t arg_2) -> entity {
+                return int_power(arg_1, arg_2);
+            },
             [](list_t const& arg_1, list_t const& arg_2) -> entity {
                 if (arg_1.size() != arg_2.size()) {
                     return entity(error_t("List size mismatch."));
@@ -487,14 +872,14 @@ entity operator ^(entity const& lhs, entity const& rhs) {
                 if constexpr (arithmetic<type_1> && arithmetic<type_2>) {
                     return entity(std::pow(arg_1, arg_2));
                 }
-                else if constexpr (arithmetic<type_1> && std::same_as<list_t, type_2>) {
+                else if constexpr (numeric<type_1> && std::same_as<list_t, type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_2) {
                         result.emplace_back(entity(arg_1) ^ ent);
                     }
                     return entity(result);
                 }
-                else if constexpr (std::same_as<type_1, list_t> && arithmetic<type_2>) {
+                else if constexpr (std::same_as<type_1, list_t> && numeric<type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_1) {
                         result.emplace_back(ent ^ entity(arg_2));
@@ -503,10 +888,20 @@ entity operator ^(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(^)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
+}
+
+entity square(entity const& base) {
+    if (base.kind() == entity::INT || base.kind() == entity::REAL) [[likely]] {
+        return base * base;
+    }
+    return base ^ entity(int_t(2));
 }
 
 entity operator &(entity const& lhs, entity const& rhs) {
+    if (lhs.m_type == entity::INT && rhs.m_type == entity::INT) [[likely]] {
+        return entity(lhs.unchecked<int_t>() & rhs.unchecked<int_t>());
+    }
     return std::visit(overload {
             [](int_t arg_1, int_t arg_2) -> entity {
                 return entity(arg_1 & arg_2);
@@ -538,10 +933,13 @@ entity operator &(entity const& lhs, entity const& rhs) {
             [](auto&& arg_1, auto&& arg_2) -> entity {
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(&)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator |(entity const& lhs, entity const& rhs) {
+    if (lhs.m_type == entity::INT && rhs.m_type == entity::INT) [[likely]] {
+        return entity(lhs.unchecked<int_t>() | rhs.unchecked<int_t>());
+    }
     return std::visit(overload {
             [](int_t arg_1, int_t arg_2) {
                 return entity(arg_1 | arg_2);
@@ -573,10 +971,41 @@ entity operator |(entity const& lhs, entity const& rhs) {
             [](auto&& arg_1, auto&& arg_2) {
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(|)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
+}
+
+entity entity::shift(entity const& value, entity const& shift, bool left) {
+    if (shift.m_type == BIGINT) {
+        // No Int survives being shifted this far, one way or the other.
+        if (shift.unchecked<bigint_t>().negative() == left) {
+            return entity(value.as_bigint().negative() ? -1 : 0);
+        }
+        return value.as_bigint().zero() ? entity(0) : entity(error_t("Integer overflow."));
+    }
+    auto count = shift.unchecked<int_t>();
+    if (count < 0) {
+        if (count == std::numeric_limits<int_t>::min()) {
+            return entity::shift(value, entity(-bigint_t(count)), not left);
+        }
+        count = -count;
+        left = not left;
+    }
+    if (value.m_type == INT) {
+        auto arg = value.unchecked<int_t>();
+        if (not left) {
+            return entity(arg >> std::min<int_t>(count, 63));
+        }
+        if (count < 63 && (arg << count) >> count == arg) [[likely]] {
+            return entity(arg << count);
+        }
+    }
+    return left ? entity(value.as_bigint() << std::size_t(count)) : entity(value.as_bigint() >> std::size_t(count));
 }
 
 entity operator <<(entity const& lhs, entity const& rhs) {
+    if (lhs.is_integral() && rhs.is_integral()) [[likely]] {
+        return entity::shift(lhs, rhs, true);
+    }
     return std::visit(overload {
             [](int_t arg_1, int_t arg_2) -> entity {
                 return entity(arg_1 << arg_2);
@@ -608,10 +1037,13 @@ entity operator <<(entity const& lhs, entity const& rhs) {
             [](auto&& arg_1, auto&& arg_2) {
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<<)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator >>(entity const& lhs, entity const& rhs) {
+    if (lhs.is_integral() && rhs.is_integral()) [[likely]] {
+        return entity::shift(lhs, rhs, false);
+    }
     return std::visit(overload {
         [](int_t arg_1, int_t arg_2) {
             return entity(arg_1 >> arg_2);
@@ -643,10 +1075,15 @@ entity operator >>(entity const& lhs, entity const& rhs) {
         [](auto&& arg_1, auto&& arg_2) {
             return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(>>)");
         }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator &&(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            return entity(arg_1 && arg_2);
+        });
+    }
     return std::visit(overload {
             [](list_t const& arg_1, list_t const& arg_2) -> entity {
                 if (arg_1.size() != arg_2.size()) {
@@ -664,14 +1101,14 @@ entity operator &&(entity const& lhs, entity const& rhs) {
                 if constexpr (arithmetic<type_1> && arithmetic<type_2>) {
                     return entity(arg_1 && arg_2);
                 }
-                else if constexpr (arithmetic<type_1> && std::same_as<list_t, type_2>) {
+                else if constexpr (numeric<type_1> && std::same_as<list_t, type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_2) {
                         result.emplace_back(entity(arg_1) && ent);
                     }
                     return entity(result);
                 }
-                else if constexpr (std::same_as<type_1, list_t> && arithmetic<type_2>) {
+                else if constexpr (std::same_as<type_1, list_t> && numeric<type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_1) {
                         result.emplace_back(ent && entity(arg_2));
@@ -680,10 +1117,15 @@ entity operator &&(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(&&)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator ||(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            return entity(arg_1 || arg_2);
+        });
+    }
     return std::visit(overload {
             [](list_t const& arg_1, list_t const& arg_2) -> entity {
                 if (arg_1.size() != arg_2.size()) {
@@ -701,14 +1143,14 @@ entity operator ||(entity const& lhs, entity const& rhs) {
                 if constexpr (arithmetic<type_1> && arithmetic<type_2>) {
                     return entity(arg_1 || arg_2);
                 }
-                else if constexpr (arithmetic<type_1> && std::same_as<list_t, type_2>) {
+                else if constexpr (numeric<type_1> && std::same_as<list_t, type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_2) {
                         result.emplace_back(entity(arg_1) || ent);
                     }
                     return entity(result);
                 }
-                else if constexpr (std::same_as<type_1, list_t> && arithmetic<type_2>) {
+                else if constexpr (std::same_as<type_1, list_t> && numeric<type_2>) {
                     auto result = list_t();
                     for (auto&& ent : arg_1) {
                         result.emplace_back(ent || entity(arg_2));
@@ -717,7 +1159,7 @@ entity operator ||(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(||)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator !(entity const& arg) {
@@ -735,10 +1177,28 @@ entity operator !(entity const& arg) {
             [](auto&& arg_1) -> entity {
                 return operation_error(entity::name_of(arg_1), { std::string("empty") }, "(!)");
             }
-    }, *arg.m_value);
+    }, arg.value());
 }
 
 bool operator ==(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) {
+            return arg_1 == arg_2;
+        });
+    }
+    if (lhs.m_type == rhs.m_type) {
+        // Values whose hashes are both known and differ can't be equal, however large they are.
+        auto lhs_hash = lhs.cached_hash();
+        auto rhs_hash = rhs.cached_hash();
+        if (lhs_hash != 0 && rhs_hash != 0 && lhs_hash != rhs_hash) {
+            return false;
+        }
+        switch (lhs.m_type) {
+            case entity::STR:  return lhs.unchecked<str_t>() == rhs.unchecked<str_t>();
+            case entity::LIST: return lhs.unchecked<list_t>() == rhs.unchecked<list_t>();
+            default:           break;
+        }
+    }
     return std::visit(overload {
             [](auto&& arg_1, auto&& arg_2) -> bool {
                 using type_1 = TYPE(arg_1);
@@ -757,17 +1217,94 @@ bool operator ==(entity const& lhs, entity const& rhs) {
                 }
                 throw std::runtime_error("Type mismatch.");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
+}
+
+static std::size_t hash_combine(std::size_t seed, std::size_t hash) noexcept {
+    return seed ^ (hash + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+std::size_t entity::hash() const {
+    if (m_type != STR && m_type != LIST && m_type != TUPLE && m_type != DICT) {
+        return this->compute_hash();
+    }
+    auto result = this->cached_hash();
+    if (result == 0) {
+        // 0 means the hash is unknown, so a hash of 0 is stored as 1 instead.
+        result = std::max(this->compute_hash(), std::size_t(1));
+        m_value->hash.store(result, std::memory_order_relaxed);
+    }
+    return result;
+}
+
+bool entity::equivalent(entity const& other) const {
+    if (m_type != other.m_type && not (this->is_number() && other.is_number())) {
+        return false;
+    }
+    return *this == other;
+}
+
+std::size_t entity::compute_hash() const {
+    switch (m_type) {
+        case INT:
+            return std::hash<int_t>()(this->unchecked<int_t>());
+        case REAL:
+        case BIGINT: {
+            // Numbers of different types are compared as Reals, so integral values hash as the Int they
+            // equal, and the others as Reals.
+            auto value = this->as_real();
+            if (value == std::trunc(value) && value >= -0x1p63L && value < 0x1p63L) {
+                return std::hash<int_t>()(int_t(value));
+            }
+            return std::hash<real_t>()(value);
+        }
+        case STR:
+            return std::hash<std::string_view>()(this->unchecked<str_t>().view());
+        case LIST: {
+            auto result = std::size_t(LIST);
+            for (auto const& item : this->unchecked<list_t>()) {
+                result = hash_combine(result, item.hash());
+            }
+            return result;
+        }
+        case TUPLE: {
+            auto result = std::size_t(TUPLE);
+            this->unchecked<tuple_t>().for_each([&result](entity const& item) {
+                result = hash_combine(result, item.hash());
+            });
+            return result;
+        }
+        case DICT: {
+            // Equal dictionaries may hold their bindings in any order, so the bindings are summed up.
+            auto result = std::size_t(DICT);
+            for (auto const& [key, value] : this->unchecked<dict_t>()) {
+                result += hash_combine(key.hash(), value.hash());
+            }
+            return result;
+        }
+        default:
+            return std::size_t(m_type);
+    }
 }
 
 std::partial_ordering operator <=>(entity const& lhs, entity const& rhs) {
+    if (lhs.is_number() && rhs.is_number()) [[likely]] {
+        return entity::arithmetic(lhs, rhs, [](auto const& arg_1, auto const& arg_2) -> std::partial_ordering {
+            return arg_1 <=> arg_2;
+        });
+    }
+    if (lhs.m_type == entity::STR && rhs.m_type == entity::STR) {
+        return lhs.unchecked<str_t>() <=> rhs.unchecked<str_t>();
+    }
     return std::visit(overload {
         [](list_t const& arg_1, list_t const& arg_2) {
-            auto result = list_t();
-            for (auto i = 0uz; i < arg_1.size(); ++i) {
-                result.emplace_back(arg_1[i] <=> arg_2[i]);
+            for (auto i = 0uz; i < arg_1.size() && i < arg_2.size(); ++i) {
+                auto cmp = arg_1[i] <=> arg_2[i];
+                if (cmp != std::partial_ordering::equivalent) {
+                    return cmp;
+                }
             }
-            return result;
+            return std::partial_ordering(arg_1.size() <=> arg_2.size());
         },
         [](func_t const& arg_1, func_t const& arg_2) {
             if (&arg_1 == &arg_2) {
@@ -789,18 +1326,16 @@ std::partial_ordering operator <=>(entity const& lhs, entity const& rhs) {
             }
             throw std::runtime_error("Type mismatch.");
         }
-    }, *lhs.m_value, *rhs.m_value);
-}
-
-entity operator_abstract(entity const& lhs, entity const& rhs) {
-    auto& arg_name = std::get<str_t>(*lhs.m_value);
-    auto& body = std::get<str_t>(*rhs.m_value);
-    return entity(func_t([key = std::move(arg_name), value = std::move(body)](entity arg) {
-        return entity(0);
-    }));
+    }, lhs.value(), rhs.value());
 }
 
 entity operator_apply(entity const& lhs, entity const& rhs) {
+    if (lhs.m_type == entity::DICT) {
+        if (auto const* value = lhs.unchecked<dict_t>().find(rhs)) {
+            return *value;
+        }
+        return standard_error("Key not found: " + entity::name(rhs.m_type));
+    }
     return std::visit(overload {
             [](auto&& arg_1, auto&& arg_2) {
                 using type_1 = TYPE(arg_1);
@@ -809,7 +1344,7 @@ entity operator_apply(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "($)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator_concat(entity const& lhs, entity const& rhs) {
@@ -825,10 +1360,19 @@ entity operator_concat(entity const& lhs, entity const& rhs) {
             [](tuple_t const& arg_1, tuple_t const& arg_2) -> entity {
                 return entity(arg_1.concat(arg_2));
             },
+            [](dict_t const& arg_1, dict_t const& arg_2) -> entity {
+                // The bindings on the right win.
+                auto result = dict_t(arg_1);
+                result.reserve(arg_1.size() + arg_2.size());
+                for (auto const& [key, value] : arg_2) {
+                    result.insert_or_assign(key, value);
+                }
+                return entity(std::move(result));
+            },
             [](auto&& arg_1, auto&& arg_2) -> entity {
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(++)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator_compare(entity const& lhs, entity const& rhs) {
@@ -839,6 +1383,18 @@ entity operator_compare(entity const& lhs, entity const& rhs) {
                 if constexpr (std::same_as<func_t, type_1> || std::same_as<func_t, type_2>) {
                     return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<=>)");
                 }
+                else if constexpr (std::same_as<seq_t, type_1> || std::same_as<seq_t, type_2>) {
+                    return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<=>)");
+                }
+                else if constexpr (std::same_as<dict_t, type_1> || std::same_as<dict_t, type_2>) {
+                    return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<=>)");
+                }
+                else if constexpr (std::same_as<chan_t, type_1> || std::same_as<chan_t, type_2>) {
+                    return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<=>)");
+                }
+                else if constexpr (std::same_as<future_t, type_1> || std::same_as<future_t, type_2>) {
+                    return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<=>)");
+                }
                 else if constexpr (std::same_as<error_t, type_1> || std::same_as<error_t, type_2>) {
                     return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<=>)");
                 }
@@ -856,7 +1412,7 @@ entity operator_compare(entity const& lhs, entity const& rhs) {
                 }
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(<=>)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity operator_cons(entity const& lhs, entity const& rhs) {
@@ -869,7 +1425,14 @@ entity operator_cons(entity const& lhs, entity const& rhs) {
             [](auto&& arg_1, auto&& arg_2) -> entity {
                 return operation_error(entity::name_of(arg_1), { entity::name_of(arg_2) }, "(:)");
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
+}
+
+entity operator_range(entity const& lhs, entity const& rhs) {
+    if (lhs.m_type == entity::INT && rhs.m_type == entity::INT) {
+        return entity(seq_t::range(lhs.unchecked<int_t>(), rhs.unchecked<int_t>()));
+    }
+    return operation_error(entity::name(lhs.m_type), { entity::name(rhs.m_type) }, "(..)");
 }
 
 entity operator_zip(entity const& lhs, entity const& rhs) {
@@ -886,7 +1449,7 @@ entity operator_zip(entity const& lhs, entity const& rhs) {
                 result.emplace(arg_1);
                 return entity(result);
             }
-    }, *lhs.m_value, *rhs.m_value);
+    }, lhs.value(), rhs.value());
 }
 
 entity::operator bool() const {
@@ -906,13 +1469,16 @@ entity::operator bool() const {
             [](tuple_t const& arg) -> bool {
                 return !arg.empty();
             },
+            [](dict_t const& arg) -> bool {
+                return !arg.empty();
+            },
             [](func_t const& arg) -> bool {
                 return bool(arg);
             },
-            [](auto&& arg) -> bool {
+            [](auto&&) -> bool {
                 return true;
             }
-    }, *m_value);
+    }, this->value());
 }
 
 entity::operator int_t() const {
@@ -923,15 +1489,16 @@ entity::operator int_t() const {
             [](real_t arg) -> int_t {
                 return int_t(arg);
             },
+            [](bigint_t const& arg) -> int_t {
+                throw_arithmetic_error("Int out of range: " + arg.to_string());
+            },
             [](str_t const& arg) -> int_t {
-                int_t result;
-                std::from_chars(arg.data(), arg.data() + arg.size(), result);
-                return result;
+                return int_t(parse_number(arg.view()));
             },
-            [](auto&& arg) -> int_t {
+            [](auto&&) -> int_t {
                 throw std::runtime_error("Invalid operation.");
             }
-    }, *m_value);
+    }, this->value());
 }
 
 entity::operator real_t() const {
@@ -942,32 +1509,36 @@ entity::operator real_t() const {
             [](real_t arg) -> real_t {
                 return arg;
             },
+            [](bigint_t const& arg) -> real_t {
+                return real_t(arg);
+            },
             [](str_t const& arg) -> real_t {
-                real_t result;
-                std::from_chars(arg.data(), arg.data() + arg.size(), result);
-                return result;
+                return real_t(parse_number(arg.view()));
             },
-            [](auto&& arg) -> real_t {
+            [](auto&&) -> real_t {
                 throw std::runtime_error("Invalid operation.");
             }
-    }, *m_value);
+    }, this->value());
 }
 
 entity::operator str_t() const {
     return std::visit(overload {
             [](int_t arg) -> str_t {
-                return std::to_string(arg);
+                return format_int(arg);
             },
             [](real_t arg) -> str_t {
-                return std::to_string(arg);
+                return format_real(arg);
+            },
+            [](bigint_t const& arg) -> str_t {
+                return arg.to_string();
             },
             [](str_t const& arg) -> str_t {
                 return arg;
             },
-            [](auto&& arg) -> str_t {
+            [](auto&&) -> str_t {
                 throw std::runtime_error("Invalid operation.");
             }
-    }, *m_value);
+    }, this->value());
 }
 
 entity::operator list_t() const {
@@ -978,12 +1549,29 @@ entity::operator list_t() const {
             [](tuple_t const& arg) -> list_t {
                 return arg.to_list();
             },
+            [](seq_t const& arg) -> list_t {
+                return arg.to_list();
+            },
+            [](chan_t const& arg) -> list_t {
+                return arg.received().to_list();
+            },
+            [](dict_t const& arg) -> list_t {
+                auto result = list_t();
+                result.reserve(arg.size());
+                for (auto const& [key, value] : arg) {
+                    auto pair = tuple_t();
+                    pair.push(value);
+                    pair.push(key);
+                    result.emplace_back(std::move(pair));
+                }
+                return result;
+            },
             [](auto&& arg) -> list_t {
                 list_t result;
                 result.emplace_back(arg);
                 return result;
             }
-    }, *m_value);
+    }, this->value());
 }
 
 entity::operator tuple_t() const {
@@ -1003,7 +1591,7 @@ entity::operator tuple_t() const {
                 result.emplace(arg);
                 return result;
             }
-    }, *m_value);
+    }, this->value());
 }
 
 entity::operator func_t() const {
@@ -1016,7 +1604,35 @@ entity::operator func_t() const {
                     return entity(arg);
                 });
             }
-    }, *m_value);
+    }, this->value());
+}
+
+entity::operator seq_t() const {
+    return std::visit(overload {
+            [](seq_t const& arg) -> seq_t {
+                return arg;
+            },
+            [](list_t const& arg) -> seq_t {
+                return seq_t::of(arg);
+            },
+            [](chan_t const& arg) -> seq_t {
+                return arg.received();
+            },
+            [](auto&& arg) -> seq_t {
+                throw_operation_error(entity::name_of(arg), {}, "(Seq)");
+            }
+    }, this->value());
+}
+
+entity::operator dict_t() const {
+    return std::visit(overload {
+            [](dict_t const& arg) -> dict_t {
+                return arg;
+            },
+            [](auto&& arg) -> dict_t {
+                throw_operation_error(entity::name_of(arg), {}, "(Dict)");
+            }
+    }, this->value());
 }
 
 entity::operator error_t() const {
@@ -1024,10 +1640,10 @@ entity::operator error_t() const {
             [](error_t const& arg) {
                 return arg;
             },
-            [](auto&& arg) {
+            [](auto&&) {
                 return error_t("Invalid operation.");
             }
-    }, *m_value);
+    }, this->value());
 }
 
 entity::operator std::partial_ordering() const {
@@ -1035,10 +1651,10 @@ entity::operator std::partial_ordering() const {
             [](int_t arg) {
                 return arg > 0 ? std::partial_ordering::greater : arg < 0 ? std::partial_ordering::less : std::partial_ordering::equivalent;
             },
-            [this](auto&& arg) -> std::partial_ordering {
+            [this](auto&&) -> std::partial_ordering {
                 throw_operation_error(entity::name_of(*this), {}, "(std::strong_ordering)");
             }
-    }, *m_value);
+    }, this->value());
 }
 
 template<not_of<entity> T>
@@ -1050,15 +1666,7 @@ entity::operator T() const {
             [](auto&& arg) -> T {
                 throw_operation_error(entity::name_of(arg), {}, "(T)");
             }
-    }, *m_value);
-}
-
-template<contained_by<typename entity::value_type> T>
-T& entity::get() {
-    if (not std::holds_alternative<T>(m_value)) {
-        throw std::runtime_error("Wrong type!");
-    }
-    return std::get<T>(m_value);
+    }, this->value());
 }
 
 template<typename T>
@@ -1071,6 +1679,11 @@ bool entity::is() const noexcept {
         case TUPLE: return std::same_as<T, tuple_t>;
         case FUNC:  return std::same_as<T, func_t>;
         case ERROR: return std::same_as<T, error_t>;
+        case BIGINT: return std::same_as<T, bigint_t>;
+        case SEQ:   return std::same_as<T, seq_t>;
+        case DICT:  return std::same_as<T, dict_t>;
+        case CHAN:  return std::same_as<T, chan_t>;
+        case FUTURE: return std::same_as<T, future_t>;
         default:    return false;
     }
 }
@@ -0,0 +1,233 @@
+#include "../include/event_loop.hpp"
+#include "../include/entity.hpp"
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+
+namespace ysh {
+
+using types::throw_standard_error;
+
+/**
+ * @brief The id of the signalfd in the epoll: the watches are numbered from 1.
+ */
+static constexpr std::uint64_t k_signals_id = 0;
+
+event_loop& event_loop::local() {
+    static thread_local auto loop = event_loop();
+    return loop;
+}
+
+event_loop::event_loop() {
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll < 0) {
+        throw_standard_error(std::string("Cannot create an epoll: ") + std::strerror(errno));
+    }
+    // It reads nothing until run() says which signals.
+    auto none = sigset_t();
+    ::sigemptyset(&none);
+    m_signals = ::signalfd(-1, &none, SFD_NONBLOCK | SFD_CLOEXEC);
+    auto event = epoll_event { .events = EPOLLIN, .data = { .u64 = k_signals_id } };
+    if (m_signals < 0 || ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_signals, &event) != 0) {
+        auto err = errno;
+        ::close(m_epoll);
+        if (m_signals >= 0) {
+            ::close(m_signals);
+        }
+        throw_standard_error(std::string("Cannot create a signalfd: ") + std::strerror(err));
+    }
+}
+
+event_loop::~event_loop() {
+    for (auto const& [id, watch] : m_watches) {
+        ::close(watch.fd);
+    }
+    ::close(m_signals);
+    ::close(m_epoll);
+}
+
+void event_loop::add(std::uint32_t events, watch_t watch) {
+    auto id = ++m_next_id;
+    auto event = epoll_event { .events = events, .data = { .u64 = id } };
+    if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, watch.fd, &event) != 0) {
+        auto err = errno;
+        ::close(watch.fd);
+        throw_standard_error(std::string("Cannot watch a descriptor: ") + std::strerror(err));
+    }
+    m_watches.emplace(id, std::move(watch));
+}
+
+void event_loop::watch_child(pid_t pid, child_handler on_exit) {
+    // A pidfd becomes readable once the child exits, and is close-on-exec from the start.
+    auto pidfd = int(::syscall(SYS_pidfd_open, pid, 0));
+    if (pidfd < 0) {
+        m_unwatched.emplace_back(pid, std::move(on_exit));
+        return;
+    }
+    this->add(EPOLLIN, watch_t { .fd = pidfd, .pid = pid, .on_exit = std::move(on_exit) });
+    ++m_children;
+}
+
+void event_loop::watch(int fd, std::uint32_t events, fd_handler on_ready) {
+    this->add(events, watch_t { .fd = fd, .on_ready = std::move(on_ready) });
+}
+
+void event_loop::after(std::chrono::nanoseconds delay, timer_handler on_expiry) {
+    auto fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        throw_standard_error(std::string("Cannot create a timer: ") + std::strerror(errno));
+    }
+    // A zero expiry disarms a timer rather than firing it right away.
+    auto count = std::max(delay.count(), std::chrono::nanoseconds::rep(1));
+    auto spec = itimerspec {};
+    spec.it_value.tv_sec = time_t(count / 1'000'000'000);
+    spec.it_value.tv_nsec = long(count % 1'000'000'000);
+    ::timerfd_settime(fd, 0, &spec, nullptr);
+    this->add(EPOLLIN, watch_t { .fd = fd, .is_timer = true, .on_expiry = std::move(on_expiry) });
+}
+
+void event_loop::dispatch(std::uint64_t id, std::uint32_t events) {
+    auto it = m_watches.find(id);
+    // Done with earlier in the same batch.
+    if (it == m_watches.end()) {
+        return;
+    }
+    auto& watch = it->second;
+    if (not watch.pid && not watch.is_timer && watch.on_ready(events)) {
+        return;
+    }
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, watch.fd, nullptr);
+    ::close(watch.fd);
+    // The handlers run once the watch is gone, so that they may add others.
+    auto done = std::move(watch);
+    m_watches.erase(it);
+    if (done.pid) {
+        --m_children;
+        auto status = 0;
+        while (::waitpid(done.pid, &status, 0) == -1 && errno == EINTR) {}
+        done.on_exit(status);
+    }
+    else if (done.is_timer) {
+        done.on_expiry();
+    }
+}
+
+void event_loop::drain_signals() noexcept {
+    auto info = signalfd_siginfo();
+    while (::read(m_signals, &info, sizeof(info)) == ssize_t(sizeof(info))) {}
+}
+
+void event_loop::run() {
+    // Interrupts are the children's business while there are some; a write to one that exited only fails.
+    auto read_signals = sigset_t();
+    ::sigemptyset(&read_signals);
+    ::sigaddset(&read_signals, SIGPIPE);
+    if (m_children != 0) {
+        ::sigaddset(&read_signals, SIGINT);
+    }
+    auto saved = sigset_t();
+    ::pthread_sigmask(SIG_BLOCK, &read_signals, &saved);
+    ::signalfd(m_signals, &read_signals, 0);
+    auto const restore = [&] {
+        // Whatever came in after the last wait is dropped too, rather than delivered once unblocked.
+        this->drain_signals();
+        ::pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+    };
+
+    try {
+        auto events = std::array<epoll_event, 64>();
+        while (not m_watches.empty()) {
+            auto count = ::epoll_wait(m_epoll, events.data(), int(events.size()), -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_standard_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            }
+            for (auto const& event : std::span(events).first(std::size_t(count))) {
+                if (event.data.u64 == k_signals_id) {
+                    this->drain_signals();
+                }
+                else {
+                    this->dispatch(event.data.u64, event.events);
+                }
+            }
+        }
+    }
+    catch (...) {
+        restore();
+        throw;
+    }
+    restore();
+
+    // Without pidfds, children are only waited for once nothing else can be.
+    for (auto& [pid, on_exit] : std::exchange(m_unwatched, {})) {
+        auto status = 0;
+        while (::waitpid(pid, &status, 0) == -1 && errno == EINTR) {}
+        on_exit(status);
+    }
+}
+
+interrupt_guard::interrupt_guard() noexcept {
+    auto interrupt = sigset_t();
+    ::sigemptyset(&interrupt);
+    ::sigaddset(&interrupt, SIGINT);
+    ::pthread_sigmask(SIG_BLOCK, &interrupt, &m_saved);
+}
+
+interrupt_guard::~interrupt_guard() {
+    auto interrupt = sigset_t();
+    ::sigemptyset(&interrupt);
+    ::sigaddset(&interrupt, SIGINT);
+    auto const now = timespec {};
+    while (::sigtimedwait(&interrupt, nullptr, &now) > 0) {}
+    ::pthread_sigmask(SIG_SETMASK, &m_saved, nullptr);
+}
+
+void block_loop_signals() noexcept {
+    auto signals = sigset_t();
+    ::sigemptyset(&signals);
+    ::sigaddset(&signals, SIGINT);
+    ::sigaddset(&signals, SIGPIPE);
+    ::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+void exec_child(char* const argv[], std::string_view failed) noexcept {
+    ::signal(SIGINT, SIG_DFL);
+    ::signal(SIGPIPE, SIG_DFL);
+    auto unblocked = sigset_t();
+    ::sigemptyset(&unblocked);
+    ::pthread_sigmask(SIG_SETMASK, &unblocked, nullptr);
+    ::execvp(argv[0], argv);
+    // Neither std::cerr nor strerror nor anything else that may take a lock or allocate: another thread
+    // could have held it when the process forked. So the reason is a fixed message, or the errno.
+    auto const error = errno;
+    auto const reason = error == ENOENT ? std::string_view("No such file or directory") :
+                        error == EACCES ? std::string_view("Permission denied") :
+                        std::string_view("exec failed with errno ");
+    ::write(STDERR_FILENO, failed.data(), failed.size());
+    ::write(STDERR_FILENO, reason.data(), reason.size());
+    if (error != ENOENT && error != EACCES) {
+        auto digits = std::array<char, 16>();
+        auto last = digits.end();
+        for (auto n = unsigned(error); last == digits.end() || n != 0; n /= 10) {
+            *--last = char('0' + n % 10);
+        }
+        ::write(STDERR_FILENO, last, std::size_t(digits.end() - last));
+    }
+    ::write(STDERR_FILENO, "\n", 1);
+    ::_exit(127);
+}
+
+int wait_child(pid_t pid) {
+    auto& loop = event_loop::local();
+    auto status = 0;
+    loop.watch_child(pid, [&status](int exited) { status = exited; });
+    loop.run();
+    return exit_code(status);
+}
+
+} // namespace ysh
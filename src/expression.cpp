@@ -0,0 +1,497 @@
+#include "../include/expression.hpp"
+#include "../include/numeric.hpp"
+
+namespace ysh {
+
+entity_t apply(builtin_operator_t op, entity_t const& lhs, entity_t const& rhs) {
+    switch (op) {
+        case YSH_ABSTR:  return operator_abstract(lhs, rhs);
+        case YSH_ADD:    return lhs + rhs;
+        case YSH_AND:    return lhs & rhs;
+        case YSH_APP:    return operator_apply(lhs, rhs);
+        case YSH_CONCAT: return operator_concat(lhs, rhs);
+        case YSH_CONS:   return operator_cons(lhs, rhs);
+        case YSH_DIV:    return lhs / rhs;
+        case YSH_EQ:     return entity_t(lhs == rhs);
+        case YSH_GE:     return entity_t(lhs >= rhs);
+        case YSH_GT:     return entity_t(lhs > rhs);
+        case YSH_LE:     return entity_t(lhs <= rhs);
+        case YSH_LT:     return entity_t(lhs < rhs);
+        case YSH_MOD:    return lhs % rhs;
+        case YSH_MUL:    return lhs * rhs;
+        case YSH_NE:     return entity_t(lhs != rhs);
+        case YSH_OR:     return lhs | rhs;
+        case YSH_POW:    return lhs ^ rhs;
+        case YSH_RANGE:  return operator_range(lhs, rhs);
+        case YSH_SEQ:    return rhs;
+        case YSH_SHL:    return lhs << rhs;
+        case YSH_SHR:    return lhs >> rhs;
+        case YSH_SUB:    return lhs - rhs;
+        case YSH_ZIP:    return operator_zip(lhs, rhs);
+        default:         types::throw_grammar_error("not a binary operator");
+    }
+}
+
+/**
+ * @brief Split an expression into tokens: parentheses, names, numbers, strings and operators.
+ * Operators are matched greedily against the known ones, so "a<-b++c" yields "a", "<-", "b", "++", "c".
+ *
+ * @param expr
+ * @return std::vector<input_t> Views into @param expr.
+ */
+static std::vector<input_t> lex(input_t expr) {
+    auto result = std::vector<input_t>();
+    auto it = expr.begin();
+    auto const end = expr.end();
+
+    while (it != end) {
+        auto first = it;
+        auto ch = *it;
+        if (isspace(ch)) {
+            ++it;
+            continue;
+        }
+        if (ch == '(' || ch == ')') {
+            ++it;
+        }
+        else if (isdigit(ch)) {
+            it += number_length(std::string_view(it, end));
+        }
+        else if (isalpha(ch) || ch == '_') {
+            while (it != end && (isalnum(*it) || *it == '_')) {
+                ++it;
+            }
+        }
+        else if (ch == '"') {
+            ++it;
+            while (it != end && *it != '"') {
+                it += *it == '\\' && it + 1 != end ? 2 : 1;
+            }
+            if (it == end) {
+                types::throw_grammar_error("unterminated string in expression");
+            }
+            ++it;
+        }
+        else if (k_operators.contains(ch)) {
+            auto last = it;
+            while (last != end && k_operators.contains(*last)) {
+                ++last;
+            }
+            // Longest match first.
+            while (last != it && not g_precedence.contains(input_t(it, last))) {
+                --last;
+            }
+            if (last == it) {
+                types::throw_grammar_error("unknown operator in expression");
+            }
+            it = last;
+        }
+        else {
+            types::throw_grammar_error(std::string("unexpected character in expression: ") + ch);
+        }
+        result.emplace_back(first, it);
+    }
+    return result;
+}
+
+static types::str_t unquote(input_t token) {
+    auto result = std::string();
+    result.reserve(token.size());
+    for (auto it = token.begin() + 1; it != token.end() - 1; ++it) {
+        if (*it == '\\') {
+            ++it;
+        }
+        result += *it;
+    }
+    return result;
+}
+
+/**
+ * @brief Whether running the instructions has any effect besides pushing a value.
+ */
+static bool has_side_effects(std::span<instruction_t const> code) {
+    return stdr::any_of(code, [](auto const& inst) {
+        return inst.opcode == YSH_STORE || (inst.opcode == YSH_APPLY && inst.op == YSH_APP);
+    });
+}
+
+/**
+ * @brief What's known of the value computed by some instructions, should they compute one at all.
+ */
+enum class known_t {
+    ANYTHING,
+    NUMBER,     // an Int (possibly a bigint) or a Real
+    INTEGRAL    // an Int
+};
+
+/**
+ * @brief What's known of the value the instructions @param code compute. Nothing is known of the value
+ * of a variable, but a comparison always yields an Int (when it doesn't throw), and +, - and * of
+ * numbers always yield a number.
+ */
+static known_t infer(std::span<instruction_t const> code) {
+    auto known = std::vector<known_t>();
+    for (auto const& inst : code) {
+        switch (inst.opcode) {
+        case YSH_PUSH:
+            switch (inst.value.kind()) {
+            case entity_t::INT:
+            case entity_t::BIGINT:
+                known.push_back(known_t::INTEGRAL);
+                break;
+            case entity_t::REAL:
+                known.push_back(known_t::NUMBER);
+                break;
+            default:
+                known.push_back(known_t::ANYTHING);
+                break;
+            }
+            break;
+        case YSH_LOAD:
+            known.push_back(known_t::ANYTHING);
+            break;
+        case YSH_STORE:
+            break;
+        case YSH_SQUARE:
+            // The square of a number is a number of the same kind.
+            if (known.empty()) {
+                return known_t::ANYTHING;
+            }
+            break;
+        case YSH_APPLY: {
+            if (known.size() < 2) {
+                return known_t::ANYTHING;
+            }
+            auto rhs = known.back();
+            known.pop_back();
+            auto& lhs = known.back();
+            switch (inst.op) {
+            case YSH_EQ:
+            case YSH_NE:
+            case YSH_LT:
+            case YSH_LE:
+            case YSH_GT:
+            case YSH_GE:
+                lhs = known_t::INTEGRAL;
+                break;
+            case YSH_ADD:
+            case YSH_SUB:
+            case YSH_MUL:
+                lhs = lhs == known_t::ANYTHING || rhs == known_t::ANYTHING ? known_t::ANYTHING : std::min(lhs, rhs);
+                break;
+            default:
+                lhs = known_t::ANYTHING;
+                break;
+            }
+            break;
+        }
+        }
+    }
+    return known.size() == 1 ? known.back() : known_t::ANYTHING;
+}
+
+static bool is_int(instruction_t const* inst, types::int_t value) {
+    return inst && inst->value.kind() == entity_t::INT && types::int_t(inst->value) == value;
+}
+
+/**
+ * @brief Append the instructions applying @param op to the two operands computed by the
+ * instructions in [lhs, rhs) and [rhs, code.end()), simplifying them if possible. The identities of
+ * arithmetic are only applied to operands known to be numbers: x + 0 is an error rather than x if x
+ * is a Str, say. And x + 0 is only x for an Int, since -0.0 + 0 is 0.0.
+ */
+static void simplify(std::vector<instruction_t>& code, std::size_t lhs, std::size_t rhs, builtin_operator_t op) {
+    auto const constant = [&code](std::size_t first, std::size_t last) -> instruction_t const* {
+        return last - first == 1 && code[first].opcode == YSH_PUSH ? &code[first] : nullptr;
+    };
+    auto const* lconst = constant(lhs, rhs);
+    auto const* rconst = constant(rhs, code.size());
+
+    if (lconst && rconst && op != YSH_APP && op != YSH_ABSTR) {
+        try {
+            auto value = apply(op, lconst->value, rconst->value);
+            code.resize(lhs);
+            code.push_back({ .opcode = YSH_PUSH, .value = std::move(value) });
+            return;
+        }
+        catch (std::exception const&) {
+            // Leave it to the runtime to fail the same way.
+        }
+    }
+
+    // The value of the left-hand side of ; is discarded anyway, as long as computing it can't throw:
+    // what's left of it once folded applies no operator.
+    if (op == YSH_SEQ && not has_side_effects(std::span(code).subspan(lhs, rhs - lhs)) &&
+        stdr::none_of(code.begin() + lhs, code.begin() + rhs, [](auto const& inst) { return inst.opcode == YSH_APPLY || inst.opcode == YSH_SQUARE; })) {
+        code.erase(code.begin() + lhs, code.begin() + rhs);
+        return;
+    }
+
+    // x ^ 2 -> x * x, whatever x holds: squaring falls back to ^ for anything but an Int or a Real.
+    if (op == YSH_POW && is_int(rconst, 2)) {
+        code.resize(rhs);
+        code.push_back({ .opcode = YSH_SQUARE });
+        return;
+    }
+
+    auto const lknown = infer(std::span(code).subspan(lhs, rhs - lhs));
+    auto const rknown = infer(std::span(code).subspan(rhs));
+    // x op c -> x, and c op x -> x.
+    auto const keep_lhs = [&code, rhs] {
+        code.resize(rhs);
+    };
+    auto const keep_rhs = [&code, lhs, rhs] {
+        code.erase(code.begin() + lhs, code.begin() + rhs);
+    };
+    switch (op) {
+    case YSH_ADD:
+        if (is_int(rconst, 0) && lknown == known_t::INTEGRAL) {
+            return keep_lhs();
+        }
+        if (is_int(lconst, 0) && rknown == known_t::INTEGRAL) {
+            return keep_rhs();
+        }
+        break;
+    case YSH_SUB:
+        if (is_int(rconst, 0) && lknown != known_t::ANYTHING) {
+            return keep_lhs();
+        }
+        break;
+    case YSH_MUL:
+        if (is_int(rconst, 1) && lknown != known_t::ANYTHING) {
+            return keep_lhs();
+        }
+        if (is_int(lconst, 1) && rknown != known_t::ANYTHING) {
+            return keep_rhs();
+        }
+        break;
+    case YSH_DIV:
+    case YSH_POW:
+        if (is_int(rconst, 1) && lknown != known_t::ANYTHING) {
+            return keep_lhs();
+        }
+        break;
+    default:
+        break;
+    }
+    code.push_back({ .opcode = YSH_APPLY, .op = op });
+}
+
+void optimize(expression_t& expr) {
+    auto result = std::vector<instruction_t>();
+    result.reserve(expr.code.size());
+    auto starts = std::vector<std::size_t>();
+
+    for (auto& inst : expr.code) {
+        switch (inst.opcode) {
+        case YSH_PUSH:
+        case YSH_LOAD:
+            starts.push_back(result.size());
+            result.push_back(std::move(inst));
+            break;
+        case YSH_STORE:
+        case YSH_SQUARE:
+            result.push_back(std::move(inst));
+            break;
+        case YSH_APPLY: {
+            auto rhs = starts.back();
+            starts.pop_back();
+            simplify(result, starts.back(), rhs, inst.op);
+            break;
+        }
+        }
+    }
+    expr.code = std::move(result);
+    analyze(expr);
+}
+
+void analyze(expression_t& expr) {
+    expr.reads.clear();
+    for (auto const& inst : expr.code) {
+        if (inst.opcode == YSH_LOAD && stdr::find(expr.reads, inst.name) == expr.reads.end()) {
+            expr.reads.push_back(inst.name);
+        }
+    }
+    expr.pure = not has_side_effects(expr.code);
+}
+
+expression_t compile(input_t expr) {
+    auto result = expression_t();
+    result.source = std::make_unique<std::string const>(expr.begin(), expr.end());
+    auto& code = result.code;
+
+    // The start index (into code) of the instructions computing each operand on the stack.
+    auto starts = std::vector<std::size_t>();
+
+    for (auto token : shunting_yard(lex(std::string_view(*result.source)))) {
+        if (token.starts_with('"')) {
+            starts.push_back(code.size());
+            code.push_back({ .opcode = YSH_PUSH, .value = entity_t(unquote(token)) });
+        }
+        else if (isdigit(token[0])) {
+            starts.push_back(code.size());
+            code.push_back({ .opcode = YSH_PUSH, .value = parse_number(token) });
+        }
+        else if (is_identifier(token)) {
+            starts.push_back(code.size());
+            code.push_back({ .opcode = YSH_LOAD, .name = token });
+        }
+        else if (is_operator(token)) {
+            if (starts.size() < 2) {
+                types::throw_grammar_error("missing operand for " + token);
+            }
+            auto rhs_start = starts.back();
+            starts.pop_back();
+            auto lhs_start = starts.back();
+            auto op = function(token);
+
+            if (op == YSH_ASSIGN) {
+                if (rhs_start - lhs_start != 1 || code[lhs_start].opcode != YSH_LOAD) {
+                    types::throw_grammar_error("the left-hand side of <- must be a name");
+                }
+                auto name = code[lhs_start].name;
+                code.erase(code.begin() + lhs_start);
+                code.push_back({ .opcode = YSH_STORE, .name = name });
+            }
+            else {
+                code.push_back({ .opcode = YSH_APPLY, .op = op });
+            }
+        }
+        else {
+            types::throw_grammar_error("unexpected token " + token);
+        }
+    }
+    if (starts.size() != 1) {
+        types::throw_grammar_error("malformed expression");
+    }
+
+    optimize(result);
+    return result;
+}
+
+entity_t run(expression_t const& expr, env_t& env) {
+    auto operands = std::vector<entity_t>();
+    operands.reserve(expr.code.size());
+
+    for (auto const& inst : expr.code) {
+        switch (inst.opcode) {
+        case YSH_PUSH:
+            operands.push_back(inst.value);
+            break;
+        case YSH_LOAD:
+            if (auto const* var = lookup(env, inst.name)) {
+                operands.push_back(var->value);
+            }
+            else {
+                operands.push_back(types::standard_error("Unbound variable: " + inst.name));
+            }
+            break;
+        case YSH_STORE:
+            assign(env, inst.name, operands.back());
+            break;
+        case YSH_SQUARE:
+            operands.back() = types::square(operands.back());
+            break;
+        case YSH_APPLY: {
+            auto rhs = std::move(operands.back());
+            operands.pop_back();
+            operands.back() = apply(inst.op, operands.back(), rhs);
+            break;
+        }
+        }
+    }
+    return std::move(operands.back());
+}
+
+entity_t abstraction_t::operator ()(entity_t arg) const {
+    auto locals = env_t();
+    assign(locals, input_t(std::string_view(param)), std::move(arg));
+    return run(*body, locals);
+}
+
+entity_t abstraction(std::string param, std::string_view body) {
+    if (not is_identifier(input_t(std::string_view(param)))) {
+        return types::standard_error("The parameter of a Func must be a name, not \"" + param + "\"");
+    }
+    try {
+        auto compiled = std::make_shared<expression_t const>(compile(input_t(body)));
+        return entity_t(types::func_t(abstraction_t { .param = std::move(param), .body = std::move(compiled) }));
+    }
+    catch (std::exception const& e) {
+        return types::standard_error(e.what());
+    }
+}
+
+namespace types {
+
+// Defined here rather than with the other operators, since it compiles expressions.
+entity operator_abstract(entity const& lhs, entity const& rhs) {
+    if (lhs.kind() != entity::STR || rhs.kind() != entity::STR) {
+        return operation_error(entity::name(lhs.kind()), { entity::name(rhs.kind()) }, "(->)");
+    }
+    return abstraction(lhs.get<str_t>().str(), rhs.get<str_t>().view());
+}
+
+} // namespace types
+
+expression_t const& expression_cache::compile(input_t expr) {
+    if (auto it = m_compiled.find(expr); it != m_compiled.end()) {
+        return it->second;
+    }
+    this->make_room();
+    auto compiled = ysh::compile(expr);
+    auto key = input_t(std::string_view(*compiled.source));
+    return m_compiled.emplace(key, std::move(compiled)).first->second;
+}
+
+void expression_cache::insert(expression_t compiled) {
+    this->make_room();
+    auto key = input_t(std::string_view(*compiled.source));
+    m_compiled.try_emplace(key, std::move(compiled));
+}
+
+std::optional<entity_t> expression_cache::recall(expression_t const& expr, env_t const& env) const {
+    auto it = m_memos.find(&expr);
+    if (it == m_memos.end()) {
+        return std::nullopt;
+    }
+    auto const& [generations, result] = it->second;
+    for (auto i = 0uz; i < expr.reads.size(); ++i) {
+        auto const* var = lookup(env, expr.reads[i]);
+        if ((var ? var->generation : generation_t()) != generations[i]) {
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+void expression_cache::remember(expression_t const& expr, env_t const& env, entity_t const& result) {
+    if (not expr.pure) {
+        return;
+    }
+    auto memo = memo_t { .result = result };
+    memo.generations.reserve(expr.reads.size());
+    for (auto name : expr.reads) {
+        auto const* var = lookup(env, name);
+        memo.generations.push_back(var ? var->generation : generation_t());
+    }
+    m_memos.insert_or_assign(&expr, std::move(memo));
+}
+
+void expression_cache::make_room() noexcept {
+    if (m_compiled.size() >= k_max_entries && m_pins == 0) {
+        this->clear();
+    }
+}
+
+void expression_cache::clear() noexcept {
+    m_memos.clear();
+    m_compiled.clear();
+}
+
+expression_cache& expression_cache::local() {
+    static thread_local expression_cache cache;
+    return cache;
+}
+
+} // namespace ysh
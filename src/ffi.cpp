@@ -0,0 +1,142 @@
+#include "../include/ffi.hpp"
+
+#include <dlfcn.h>
+
+namespace ysh {
+
+using types::int_t;
+using types::list_t;
+using types::real_t;
+using types::str_t;
+using types::throw_standard_error;
+
+static constexpr std::size_t k_max_ints = 6;
+static constexpr std::size_t k_max_doubles = 8;
+
+foreign_signature foreign_signature::parse(std::string_view signature) {
+    auto const valid = [](char type) {
+        return type == 'i' || type == 'l' || type == 'd' || type == 's';
+    };
+    if (signature.size() < 3 || (not valid(signature[0]) && signature[0] != 'v') || signature[1] != '(' || signature.back() != ')') {
+        throw_standard_error("Malformed signature: " + std::string(signature));
+    }
+    auto result = foreign_signature { .result = signature[0] };
+    for (auto type : signature.substr(2, signature.size() - 3)) {
+        if (not valid(type)) {
+            throw_standard_error("Unknown parameter type in " + std::string(signature) + ": " + type);
+        }
+        result.params.push_back(type);
+    }
+    auto doubles = std::size_t(stdr::count(result.params, 'd'));
+    if (doubles > k_max_doubles || result.params.size() - doubles > k_max_ints) {
+        throw_standard_error("Too many parameters: " + std::string(signature));
+    }
+    return result;
+}
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+/**
+ * @brief Both ABIs pass the first integer (and pointer) arguments and the first double arguments in two
+ * separate sets of registers, each in order. So a function taking at most 6 of the former and 8 of the
+ * latter reads exactly the registers a call through these types fills, whatever the order of its
+ * parameters, and ignores the rest.
+ */
+using int_call_t = std::int64_t (*)(std::int64_t, std::int64_t, std::int64_t, std::int64_t, std::int64_t, std::int64_t,
+                                    double, double, double, double, double, double, double, double);
+using double_call_t = double (*)(std::int64_t, std::int64_t, std::int64_t, std::int64_t, std::int64_t, std::int64_t,
+                                 double, double, double, double, double, double, double, double);
+
+/**
+ * @brief Call a bound function with the arguments @param args (as passed to the Func).
+ */
+static entity_t call_foreign(void* func, foreign_signature const& signature, entity_t const& args) {
+    auto ints = std::array<std::int64_t, k_max_ints>();
+    auto doubles = std::array<double, k_max_doubles>();
+    // The strings passed must live until the call returns.
+    auto strings = std::array<std::string, k_max_ints>();
+
+    auto elems = list_t();
+    if (signature.params.size() == 1) {
+        elems.push_back(args);
+    }
+    else if (signature.params.size() > 1 && (args.kind() != entity_t::TUPLE || (elems = list_t(args)).size() != signature.params.size())) {
+        return types::standard_error("Expected a tuple of " + std::to_string(signature.params.size()) + " arguments");
+    }
+    auto next_int = 0uz;
+    auto next_double = 0uz;
+    for (auto i = 0uz; i < elems.size(); ++i) {
+        auto const& arg = elems[i];
+        switch (signature.params[i]) {
+        case 'i':
+        case 'l':
+            if (arg.kind() != entity_t::INT || (signature.params[i] == 'i' && not std::in_range<int>(arg.get<int_t>()))) {
+                return types::standard_error("Expected an Int for parameter " + std::to_string(i + 1));
+            }
+            ints[next_int++] = arg.get<int_t>();
+            break;
+        case 'd':
+            if (arg.kind() != entity_t::INT && arg.kind() != entity_t::REAL && arg.kind() != entity_t::BIGINT) {
+                return types::standard_error("Expected a number for parameter " + std::to_string(i + 1));
+            }
+            doubles[next_double++] = double(real_t(arg));
+            break;
+        case 's':
+            if (arg.kind() != entity_t::STR) {
+                return types::standard_error("Expected a Str for parameter " + std::to_string(i + 1));
+            }
+            strings[next_int] = arg.get<str_t>().str();
+            ints[next_int] = std::bit_cast<std::int64_t>(strings[next_int].c_str());
+            ++next_int;
+            break;
+        }
+    }
+
+    auto const call = [&](auto target) {
+        return target(ints[0], ints[1], ints[2], ints[3], ints[4], ints[5],
+                      doubles[0], doubles[1], doubles[2], doubles[3], doubles[4], doubles[5], doubles[6], doubles[7]);
+    };
+    if (signature.result == 'd') {
+        return entity_t(real_t(call(reinterpret_cast<double_call_t>(func))));
+    }
+    auto result = call(reinterpret_cast<int_call_t>(func));
+    switch (signature.result) {
+    case 'i':
+        // Only the low half of the register is defined.
+        return entity_t(int_t(static_cast<int>(result)));
+    case 'l':
+        return entity_t(int_t(result));
+    case 's': {
+        auto const* str = std::bit_cast<char const*>(result);
+        return str ? entity_t(str_t(std::string(str))) : types::standard_error("Null string");
+    }
+    default:
+        return entity_t(types::tuple_t());
+    }
+}
+
+types::func_t bind_foreign(std::string const& library, std::string const& symbol, std::string_view signature) {
+    auto parsed = foreign_signature::parse(signature);
+    // Never closed: the Func may outlive any scope that could close it.
+    auto* handle = ::dlopen(library.empty() ? nullptr : library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (not handle) {
+        throw_standard_error("Failed to load library: " + std::string(::dlerror()));
+    }
+    auto* func = ::dlsym(handle, symbol.c_str());
+    if (not func) {
+        throw_standard_error("Symbol not found: " + symbol);
+    }
+    return [func, parsed = std::move(parsed)](entity_t args) {
+        return call_foreign(func, parsed, args);
+    };
+}
+
+#else
+
+types::func_t bind_foreign(std::string const&, std::string const&, std::string_view) {
+    throw_standard_error("Foreign functions aren't supported on this platform");
+}
+
+#endif
+
+} // namespace ysh
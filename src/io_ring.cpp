@@ -0,0 +1,373 @@
+#include "../include/io_ring.hpp"
+#include "../include/entity.hpp"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+namespace ysh {
+
+using types::throw_standard_error;
+
+/**
+ * @brief The most a single read or write is asked to move: the length of a request is 32 bits.
+ */
+static constexpr std::size_t k_max_transfer = 1 << 30;
+
+/**
+ * @brief The offset of a read or a write at the current position of the file, which it moves along,
+ * as with read(2) and write(2) (IORING_FEAT_RW_CUR_POS).
+ */
+static constexpr std::uint64_t k_current_position = std::uint64_t(-1);
+
+/**
+ * @brief An io_uring: the rings it shares with the kernel, i.e. the submission queue (the entries, and
+ * the ring of their indices) and the completion queue, and the buffers the files are read into.
+ */
+struct io_ring::ring {
+    int fd = -1;
+    void* rings = MAP_FAILED;
+    std::size_t rings_size = 0;
+    void* entries = MAP_FAILED;
+    std::size_t entries_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    // The entries filled since the last submission.
+    unsigned queued = 0;
+
+    std::unique_ptr<char[]> buffers;
+    // Whether the buffers are registered, so that the kernel doesn't map them on every read.
+    bool registered = false;
+
+    ring() = default;
+
+    ring(ring const&) = delete;
+
+    ring& operator =(ring const&) = delete;
+
+    ~ring() {
+        if (entries != MAP_FAILED) {
+            ::munmap(entries, entries_size);
+        }
+        if (rings != MAP_FAILED) {
+            ::munmap(rings, rings_size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    /**
+     * @brief Set the ring up. @return bool Whether the kernel has everything needed.
+     */
+    bool setup() {
+        auto params = io_uring_params {};
+        fd = int(::syscall(__NR_io_uring_setup, unsigned(k_ring_files), &params));
+        if (fd < 0) {
+            return false;
+        }
+        // Opening and closing files through the ring came with Linux 5.6, as did IORING_FEAT_RW_CUR_POS.
+        if (not (params.features & IORING_FEAT_SINGLE_MMAP) || not (params.features & IORING_FEAT_RW_CUR_POS)) {
+            return false;
+        }
+        rings_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                              params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        rings = ::mmap(nullptr, rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        entries_size = params.sq_entries * sizeof(io_uring_sqe);
+        entries = ::mmap(nullptr, entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (rings == MAP_FAILED || entries == MAP_FAILED) {
+            return false;
+        }
+        auto* base = static_cast<char*>(rings);
+        sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        sqes = static_cast<io_uring_sqe*>(entries);
+        cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+        buffers = std::make_unique_for_overwrite<char[]>(k_ring_files * k_ring_buffer_size);
+        auto iovecs = std::array<iovec, k_ring_files>();
+        for (auto i = 0uz; i < k_ring_files; ++i) {
+            iovecs[i] = iovec { .iov_base = this->buffer(i), .iov_len = k_ring_buffer_size };
+        }
+        // Registering pins the buffers, which older kernels count against RLIMIT_MEMLOCK: if it fails,
+        // the kernel maps them on each read instead.
+        registered = ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(), unsigned(k_ring_files)) == 0;
+        return true;
+    }
+
+    char* buffer(std::size_t slot) const noexcept {
+        return buffers.get() + slot * k_ring_buffer_size;
+    }
+
+    /**
+     * @brief The next entry of the submission queue, cleared, with @param opcode, on @param file and
+     * tagged @param slot. It's only submitted by @ref complete.
+     */
+    io_uring_sqe& next(std::uint8_t opcode, int file, std::size_t slot) noexcept {
+        auto index = (*sq_tail + queued++) & sq_mask;
+        sq_array[index] = index;
+        auto& sqe = sqes[index];
+        sqe = io_uring_sqe {};
+        sqe.opcode = opcode;
+        sqe.fd = file;
+        sqe.user_data = slot;
+        return sqe;
+    }
+
+    /**
+     * @brief Submit the entries queued, and call @param on_complete with the slot and the result of
+     * each of them as they complete, until @param count have.
+     */
+    void complete(std::size_t count, std::invocable<std::size_t, int> auto&& on_complete) {
+        std::atomic_ref(*sq_tail).store(*sq_tail + queued, std::memory_order_release);
+        auto to_submit = std::exchange(queued, 0);
+        while (count > 0) {
+            auto entered = ::syscall(__NR_io_uring_enter, fd, to_submit, unsigned(count), IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (entered < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw_standard_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+            }
+            to_submit -= unsigned(std::max(entered, 0l));
+            auto head = *cq_head;
+            auto tail = std::atomic_ref(*cq_tail).load(std::memory_order_acquire);
+            for (; head != tail && count > 0; ++head, --count) {
+                auto const& cqe = cqes[head & cq_mask];
+                on_complete(std::size_t(cqe.user_data), cqe.res);
+            }
+            std::atomic_ref(*cq_head).store(head, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief Close the descriptors of @param files that are open, and forget them.
+     * @return The errors of the closes, indexed like @param files.
+     */
+    std::array<int, k_ring_files> close(std::span<int> files) {
+        auto errors = std::array<int, k_ring_files>();
+        auto count = 0uz;
+        for (auto slot = 0uz; slot < files.size(); ++slot) {
+            if (files[slot] >= 0) {
+                this->next(IORING_OP_CLOSE, std::exchange(files[slot], -1), slot);
+                ++count;
+            }
+        }
+        this->complete(count, [&errors](std::size_t slot, int result) {
+            errors[slot] = result < 0 ? -result : 0;
+        });
+        return errors;
+    }
+
+    /**
+     * @brief Open @param paths, a batch of at most k_ring_files, with @param flags, and @param mode if
+     * they're created.
+     * @return The descriptors, or -1 for the files that failed to open, whose errors go into @param errors.
+     */
+    std::array<int, k_ring_files> open(std::span<std::string const> paths, int flags, unsigned mode, std::span<int> errors) {
+        auto files = std::array<int, k_ring_files>();
+        files.fill(-1);
+        for (auto slot = 0uz; slot < paths.size(); ++slot) {
+            auto& sqe = this->next(IORING_OP_OPENAT, AT_FDCWD, slot);
+            sqe.addr = reinterpret_cast<std::uintptr_t>(paths[slot].c_str());
+            sqe.open_flags = std::uint32_t(flags);
+            sqe.len = mode;
+        }
+        this->complete(paths.size(), [&](std::size_t slot, int result) {
+            if (result < 0) {
+                errors[slot] = -result;
+            }
+            else {
+                files[slot] = result;
+            }
+        });
+        return files;
+    }
+};
+
+/**
+ * @brief Read the file at @param path whole with plain system calls.
+ */
+static file_contents_t read_plain(std::string const& path) {
+    auto result = file_contents_t();
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        result.error = errno;
+        return result;
+    }
+    auto buffer = std::array<char, k_ring_buffer_size>();
+    while (true) {
+        auto count = ::read(fd, buffer.data(), buffer.size());
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            result.error = count < 0 ? errno : 0;
+            break;
+        }
+        result.data.append(buffer.data(), std::size_t(count));
+    }
+    ::close(fd);
+    return result;
+}
+
+/**
+ * @brief Write @param contents to the file at @param path with plain system calls.
+ * @return int 0 or the errno that stopped it.
+ */
+static int write_plain(std::string const& path, std::string_view contents) {
+    auto fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return errno;
+    }
+    auto error = 0;
+    while (not contents.empty()) {
+        auto written = ::write(fd, contents.data(), std::min(contents.size(), k_max_transfer));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            error = written < 0 ? errno : EIO;
+            break;
+        }
+        contents.remove_prefix(std::size_t(written));
+    }
+    if (::close(fd) != 0 && error == 0) {
+        error = errno;
+    }
+    return error;
+}
+
+io_ring& io_ring::local() {
+    static thread_local auto ring = io_ring();
+    return ring;
+}
+
+io_ring::io_ring() {
+    auto uring = std::make_unique<ring>();
+    if (uring->setup()) {
+        m_ring = std::move(uring);
+    }
+}
+
+io_ring::~io_ring() = default;
+
+std::vector<file_contents_t> io_ring::read(std::span<std::string const> paths) {
+    auto results = std::vector<file_contents_t>(paths.size());
+    if (not m_ring) {
+        stdr::transform(paths, results.begin(), read_plain);
+        return results;
+    }
+    auto& uring = *m_ring;
+    for (auto start = 0uz; start < paths.size(); start += k_ring_files) {
+        auto batch = paths.subspan(start, std::min(k_ring_files, paths.size() - start));
+        auto errors = std::array<int, k_ring_files>();
+        auto files = uring.open(batch, O_RDONLY | O_CLOEXEC, 0, errors);
+        // Each file is read into a buffer of its own until a read returns nothing: a read may come
+        // back short well before the end, e.g. of a file of /proc, a FIFO or a file on NFS.
+        auto reading = std::vector<std::size_t>();
+        for (auto slot = 0uz; slot < batch.size(); ++slot) {
+            if (files[slot] >= 0) {
+                reading.push_back(slot);
+            }
+        }
+        while (not reading.empty()) {
+            for (auto slot : reading) {
+                auto& sqe = uring.next(uring.registered ? IORING_OP_READ_FIXED : IORING_OP_READ, files[slot], slot);
+                sqe.addr = reinterpret_cast<std::uintptr_t>(uring.buffer(slot));
+                sqe.len = std::uint32_t(k_ring_buffer_size);
+                // From the current position, as read(2) would, so that files that can't seek read too.
+                sqe.off = k_current_position;
+                sqe.buf_index = std::uint16_t(slot);
+            }
+            auto more = std::vector<std::size_t>();
+            uring.complete(reading.size(), [&](std::size_t slot, int result) {
+                if (result == -EINTR) {
+                    more.push_back(slot);
+                    return;
+                }
+                if (result < 0) {
+                    errors[slot] = -result;
+                    return;
+                }
+                results[start + slot].data.append(uring.buffer(slot), std::size_t(result));
+                if (result != 0) {
+                    more.push_back(slot);
+                }
+            });
+            reading = std::move(more);
+        }
+        uring.close(std::span(files).first(batch.size()));
+        for (auto slot = 0uz; slot < batch.size(); ++slot) {
+            if (errors[slot] != 0) {
+                results[start + slot].data.clear();
+                results[start + slot].error = errors[slot];
+            }
+        }
+    }
+    return results;
+}
+
+std::vector<int> io_ring::write(std::span<std::string const> paths, std::span<std::string_view const> contents) {
+    auto results = std::vector<int>(paths.size());
+    if (not m_ring) {
+        for (auto i = 0uz; i < paths.size(); ++i) {
+            results[i] = write_plain(paths[i], contents[i]);
+        }
+        return results;
+    }
+    auto& uring = *m_ring;
+    for (auto start = 0uz; start < paths.size(); start += k_ring_files) {
+        auto batch = paths.subspan(start, std::min(k_ring_files, paths.size() - start));
+        auto errors = std::span(results).subspan(start, batch.size());
+        auto files = uring.open(batch, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666, errors);
+        // The contents are written in order, again for what a short write left.
+        auto written = std::array<std::size_t, k_ring_files>();
+        auto const unfinished = [&](std::size_t slot) {
+            return files[slot] >= 0 && errors[slot] == 0 && written[slot] < contents[start + slot].size();
+        };
+        auto writing = std::vector<std::size_t>();
+        for (auto slot = 0uz; slot < batch.size(); ++slot) {
+            if (unfinished(slot)) {
+                writing.push_back(slot);
+            }
+        }
+        while (not writing.empty()) {
+            for (auto slot : writing) {
+                auto rest = contents[start + slot].substr(written[slot]);
+                auto& sqe = uring.next(IORING_OP_WRITE, files[slot], slot);
+                sqe.addr = reinterpret_cast<std::uintptr_t>(rest.data());
+                sqe.len = std::uint32_t(std::min(rest.size(), k_max_transfer));
+                sqe.off = k_current_position;
+            }
+            uring.complete(writing.size(), [&](std::size_t slot, int result) {
+                if (result <= 0) {
+                    errors[slot] = result < 0 ? -result : EIO;
+                    return;
+                }
+                written[slot] += std::size_t(result);
+            });
+            std::erase_if(writing, [&](std::size_t slot) { return not unfinished(slot); });
+        }
+        // A close may be where a write turns out to have failed, e.g. on a network file system.
+        auto closed = uring.close(std::span(files).first(batch.size()));
+        for (auto slot = 0uz; slot < batch.size(); ++slot) {
+            if (errors[slot] == 0) {
+                errors[slot] = closed[slot];
+            }
+        }
+    }
+    return results;
+}
+
+} // namespace ysh
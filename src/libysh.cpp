@@ -0,0 +1,47 @@
+#include "../include/libysh.hpp"
+#include "../include/script_cache.hpp"
+
+namespace ysh {
+
+entity_t embedded_interpreter::evaluate(std::string_view expr) {
+    auto bound = interpreter::scope(m_session);
+    // Names assigned by the expression are views into its compiled form, which the cache may drop, so
+    // they're bound in a scratch environment first and moved over under names of our own.
+    auto scratch = env_t();
+    auto result = ysh::evaluate(input_t(expr), scratch);
+    for (auto& [name, variable] : scratch) {
+        m_session.variables.insert_or_assign(this->intern(name), std::move(variable));
+    }
+    return result;
+}
+
+std::vector<std::pair<token_t, input_t>> embedded_interpreter::tokenize(std::string_view line) const {
+    return ysh::tokenize(input_t(line));
+}
+
+int embedded_interpreter::run(std::istream& is, std::ostream& os) {
+    auto bound = interpreter::scope(m_session);
+    return shell(is, os);
+}
+
+int embedded_interpreter::run(stdf::path const& path, std::ostream& os) {
+    auto bound = interpreter::scope(m_session);
+    return shell(*load_script(path), os);
+}
+
+void embedded_interpreter::set(std::string_view name, entity_t value) {
+    assign(m_session.variables, this->intern(name), std::move(value));
+}
+
+std::optional<entity_t> embedded_interpreter::get(std::string_view name) const {
+    if (auto it = m_session.variables.find(input_t(name)); it != m_session.variables.end()) {
+        return it->second.value;
+    }
+    return std::nullopt;
+}
+
+input_t embedded_interpreter::intern(std::string_view name) {
+    return input_t(std::string_view(*m_names.emplace(name).first));
+}
+
+} // namespace ysh
@@ -0,0 +1,157 @@
+#include "../include/numeric.hpp"
+
+namespace ysh {
+
+[[noreturn]]
+static void malformed(std::string_view text) {
+    types::throw_grammar_error("malformed number: " + std::string(text));
+}
+
+static bool is_digit_of(char ch, int base) noexcept {
+    switch (base) {
+    case 2:  return ch == '0' || ch == '1';
+    case 8:  return ch >= '0' && ch <= '7';
+    case 16: return std::isxdigit(static_cast<unsigned char>(ch));
+    default: return std::isdigit(static_cast<unsigned char>(ch));
+    }
+}
+
+static int digit_value(char ch) noexcept {
+    return ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10;
+}
+
+/**
+ * @brief The base announced by the prefix of @param text (0x, 0b or 0o), or 10 if there is none.
+ */
+static int radix_of(std::string_view text) noexcept {
+    if (text.size() < 2 || text[0] != '0') {
+        return 10;
+    }
+    switch (text[1] | 0x20) {
+    case 'x': return 16;
+    case 'b': return 2;
+    case 'o': return 8;
+    default:  return 10;
+    }
+}
+
+std::size_t number_length(std::string_view text) {
+    auto const decimal = radix_of(text) == 10;
+    auto i = 0uz;
+    while (i < text.size()) {
+        auto ch = text[i];
+        if (std::isalnum(static_cast<unsigned char>(ch)) || ch == '_') {
+            ++i;
+        }
+        // A dot is only part of the literal when a digit follows, so "1..5" is a range.
+        else if (ch == '.' && decimal && i + 1 < text.size() && std::isdigit(static_cast<unsigned char>(text[i + 1]))) {
+            ++i;
+        }
+        else if ((ch == '+' || ch == '-') && decimal && (text[i - 1] | 0x20) == 'e') {
+            ++i;
+        }
+        else {
+            break;
+        }
+    }
+    return i;
+}
+
+entity_t parse_number(std::string_view text) {
+    auto it = text.begin();
+    auto const end = text.end();
+
+    auto negative = false;
+    if (it != end && (*it == '+' || *it == '-')) {
+        negative = *it++ == '-';
+    }
+    auto const base = radix_of(std::string_view(it, end));
+    if (base != 10) {
+        it += 2;
+    }
+
+    // The digits without the separators, in case the value has to be handed over to another parser.
+    auto digits = std::string(negative ? "-" : "");
+    auto magnitude = std::uint64_t();
+    auto overflow = false;
+    auto is_real = false;
+
+    // Scan a run of digits separated by single underscores, accumulating the integer value.
+    auto const scan_digits = [&](bool accumulate) {
+        if (it == end || not is_digit_of(*it, base)) {
+            malformed(text);
+        }
+        while (it != end) {
+            if (*it == '_') {
+                if (++it == end || not is_digit_of(*it, base)) {
+                    malformed(text);
+                }
+            }
+            if (not is_digit_of(*it, base)) {
+                break;
+            }
+            if (accumulate && not overflow) {
+                overflow = __builtin_mul_overflow(magnitude, std::uint64_t(base), &magnitude)
+                    || __builtin_add_overflow(magnitude, std::uint64_t(digit_value(*it)), &magnitude);
+            }
+            digits += *it++;
+        }
+    };
+
+    scan_digits(true);
+    if (base == 10 && it != end && *it == '.') {
+        is_real = true;
+        digits += *it++;
+        scan_digits(false);
+    }
+    if (base == 10 && it != end && (*it | 0x20) == 'e') {
+        is_real = true;
+        digits += *it++;
+        if (it != end && (*it == '+' || *it == '-')) {
+            digits += *it++;
+        }
+        scan_digits(false);
+    }
+    if (it != end) {
+        malformed(text);
+    }
+
+    if (is_real) {
+        auto result = types::real_t();
+        auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), result);
+        if (ec == std::errc::result_out_of_range) {
+            // Too large overflows to infinity. Too small is reported for subnormals too, which strtold
+            // (whose decimal point is that of the "C" locale ysh runs in) still rounds correctly, to
+            // zero if need be.
+            auto exp = digits.find_first_of("eE");
+            auto huge = exp != std::string::npos && digits[exp + 1] != '-';
+            result = huge ? std::numeric_limits<types::real_t>::infinity() : std::strtold(digits.c_str(), nullptr);
+            return entity_t(negative ? -result : result);
+        }
+        return entity_t(result);
+    }
+    auto const limit = std::uint64_t(std::numeric_limits<types::int_t>::max()) + (negative ? 1 : 0);
+    if (overflow || magnitude > limit) {
+        return entity_t(types::bigint_t::parse(digits, base));
+    }
+    // Negating in unsigned arithmetic handles the most negative value.
+    return entity_t(types::int_t(negative ? 0 - magnitude : magnitude));
+}
+
+std::string format_real(types::real_t value) {
+    auto buffer = std::array<char, 64>();
+    auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    auto result = std::string(buffer.data(), ptr);
+    if (std::isfinite(value) && result.find_first_of(".e") == std::string::npos) {
+        result += ".0";
+    }
+    return result;
+}
+
+std::string format_int(types::int_t value) {
+    auto buffer = std::array<char, 24>();
+    auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    return std::string(buffer.data(), ptr);
+}
+
+} // namespace ysh
@@ -0,0 +1,112 @@
+#include "../include/parallel.hpp"
+#include "../include/event_loop.hpp"
+
+namespace ysh {
+
+thread_pool& thread_pool::instance() {
+    static auto pool = thread_pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+thread_pool::thread_pool(std::size_t size) {
+    m_workers.reserve(size);
+    for (auto i = 0uz; i < size; ++i) {
+        m_workers.emplace_back([this](std::stop_token token) {
+            block_loop_signals();
+            this->work(std::move(token));
+        });
+    }
+}
+
+thread_pool::~thread_pool() {
+    for (auto& worker : m_workers) {
+        worker.request_stop();
+    }
+    m_ready.notify_all();
+    m_workers.clear();
+}
+
+void thread_pool::submit(task_type task) {
+    {
+        auto lock = std::lock_guard(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_ready.notify_one();
+}
+
+void thread_pool::work(std::stop_token token) {
+    while (true) {
+        auto task = task_type();
+        {
+            auto lock = std::unique_lock(m_mutex);
+            if (not m_ready.wait(lock, token, [this] { return not m_tasks.empty(); })) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+/**
+ * @brief The progress of a parallel_for. Workers that start after all the indices are taken leave
+ * without touching func, which may be gone by then.
+ */
+struct parallel_state {
+    std::function<void (std::size_t)> const* func;
+    std::size_t count;
+    std::atomic<std::size_t> next = 0;
+    std::atomic<std::size_t> done = 0;
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    void run() {
+        for (auto index = next++; index < count; index = next++) {
+            try {
+                (*func)(index);
+            }
+            catch (...) {
+                auto lock = std::lock_guard(mutex);
+                if (not error) {
+                    error = std::current_exception();
+                }
+            }
+            if (++done == count) {
+                done.notify_all();
+            }
+        }
+    }
+};
+
+void parallel_for(std::size_t count, std::function<void (std::size_t)> const& func) {
+    if (count <= 1) {
+        if (count == 1) {
+            func(0);
+        }
+        return;
+    }
+    auto& pool = thread_pool::instance();
+    auto state = std::make_shared<parallel_state>(&func, count);
+    for (auto i = 0uz; i < std::min(pool.size(), count - 1); ++i) {
+        pool.submit([state] {
+            state->run();
+        });
+    }
+    state->run();
+    for (auto done = state->done.load(); done != count; done = state->done.load()) {
+        state->done.wait(done);
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+std::size_t parallel_chunks(std::size_t size) noexcept {
+    if (size < k_parallel_threshold) {
+        return 1;
+    }
+    return thread_pool::instance().size() + 1;
+}
+
+} // namespace ysh
@@ -0,0 +1,823 @@
+#include "../include/pipeline.hpp"
+#include "../include/event_loop.hpp"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+
+namespace ysh {
+
+using types::dict_t;
+using types::func_t;
+using types::list_t;
+using types::seq_t;
+using types::str_t;
+using types::tuple_t;
+
+object_pipe::~object_pipe() {
+    if (auto* end = std::get_if<channel_end_t>(&m_state); end && end->channel) {
+        if (end->end == READ_END) {
+            end->channel->hang_up();
+        }
+        else {
+            end->channel->close();
+        }
+    }
+}
+
+bool object_pipe::write(entity_t value) {
+    return std::visit(overload {
+            [&value](buffer_t& buffer) {
+                buffer.values.push_back(std::move(value));
+                return true;
+            },
+            [&value](channel_end_t& end) {
+                return end.channel->push(std::move(value));
+            },
+            [](generated_t&) -> bool {
+                types::throw_standard_error("Writing to the values of a generator");
+            },
+            [&value](sink_type& sink) {
+                return sink(std::move(value));
+            }
+    }, m_state);
+}
+
+bool object_pipe::reading() const noexcept {
+    auto const* end = std::get_if<channel_end_t>(&m_state);
+    return not end || not end->channel->hung_up();
+}
+
+std::optional<entity_t> object_pipe::read() {
+    return std::visit(overload {
+            [](buffer_t& buffer) -> std::optional<entity_t> {
+                if (buffer.next == buffer.values.size()) {
+                    return std::nullopt;
+                }
+                return std::move(buffer.values[buffer.next++]);
+            },
+            [](channel_end_t& end) {
+                return end.channel->pop();
+            },
+            [](generated_t& generated) -> std::optional<entity_t> {
+                // Past the end, the coroutine can't be resumed.
+                if (generated.started && generated.next == std::default_sentinel) {
+                    return std::nullopt;
+                }
+                if (std::exchange(generated.started, true)) {
+                    ++generated.next;
+                }
+                else {
+                    generated.next = generated.values.begin();
+                }
+                if (generated.next == std::default_sentinel) {
+                    return std::nullopt;
+                }
+                return *generated.next;
+            },
+            [](sink_type&) -> std::optional<entity_t> {
+                types::throw_standard_error("Reading from a sink");
+            }
+    }, m_state);
+}
+
+bool object_pipe::ready() const noexcept {
+    auto const* buffer = std::get_if<buffer_t>(&m_state);
+    return buffer && buffer->next != buffer->values.size();
+}
+
+list_t object_pipe::drain() {
+    auto result = list_t();
+    if (auto* buffer = std::get_if<buffer_t>(&m_state)) {
+        result.swap(buffer->values);
+        result.erase(result.begin(), result.begin() + std::ptrdiff_t(std::exchange(buffer->next, 0)));
+        return result;
+    }
+    while (auto value = this->read()) {
+        result.push_back(std::move(*value));
+    }
+    return result;
+}
+
+void object_pipe::hang_up() noexcept {
+    if (auto* end = std::get_if<channel_end_t>(&m_state)) {
+        if (end->end == READ_END && end->channel) {
+            end->channel->hang_up();
+            m_state = buffer_t();
+        }
+    }
+    else if (not std::holds_alternative<sink_type>(m_state)) {
+        // A generator stops where it is, and lets go of the pipes it reads from in turn.
+        m_state = buffer_t();
+    }
+}
+
+object_pipe& local_input() {
+    static thread_local auto pipe = object_pipe();
+    return pipe;
+}
+
+object_pipe& local_output() {
+    static thread_local auto pipe = object_pipe();
+    return pipe;
+}
+
+std::ostream& local_stdout() {
+    static thread_local auto stream = std::ostream(std::cout.rdbuf());
+    return stream;
+}
+
+void render(entity_t const& value, std::ostream& os) {
+    auto const join = [&os](list_t const& elems, char separator) {
+        for (auto i = 0uz; i < elems.size(); ++i) {
+            if (i != 0) {
+                os << separator;
+            }
+            render(elems[i], os);
+        }
+    };
+    switch (value.kind()) {
+    case entity_t::STR:
+        os << value.get<str_t>().view();
+        break;
+    case entity_t::INT:
+    case entity_t::REAL:
+    case entity_t::BIGINT:
+        os << str_t(value).view();
+        break;
+    case entity_t::LIST:
+        join(value.get<list_t>(), '\t');
+        break;
+    case entity_t::TUPLE:
+        join(list_t(value), '\t');
+        break;
+    case entity_t::SEQ: {
+        auto first = true;
+        value.get<seq_t>().for_each([&](entity_t const& elem) {
+            if (not std::exchange(first, false)) {
+                os << '\n';
+            }
+            render(elem, os);
+            return true;
+        });
+        break;
+    }
+    case entity_t::DICT: {
+        auto first = true;
+        for (auto const& [key, elem] : value.get<dict_t>()) {
+            if (not std::exchange(first, false)) {
+                os << '\n';
+            }
+            render(key, os);
+            os << '\t';
+            render(elem, os);
+        }
+        break;
+    }
+    case entity_t::ERROR:
+        os << types::error_t(value).what();
+        break;
+    default:
+        os << '<' << entity_t::name(value.kind()) << '>';
+        break;
+    }
+}
+
+static list_t split_lines(std::string_view text) {
+    auto result = list_t();
+    while (not text.empty()) {
+        auto end = text.find('\n');
+        result.emplace_back(str_t(std::string(text.substr(0, end))));
+        text.remove_prefix(end == text.npos ? text.size() : end + 1);
+    }
+    return result;
+}
+
+/**
+ * @brief The value of an argument of a Func stage. A string is a Str, and anything else, e.g. (1 + 2),
+ * a number or a name, is evaluated as an expression.
+ */
+static entity_t argument_value(input_t arg) {
+    auto view = std::string_view(arg);
+    if (view.size() >= 2 && view.front() == '"' && view.back() == '"') {
+        return entity_t(str_t(std::string(view.substr(1, view.size() - 2))));
+    }
+    if (view.size() >= 2 && view.front() == '(' && view.back() == ')') {
+        view = view.substr(1, view.size() - 2);
+    }
+    // Whatever the expression assigns is thrown away with the pipeline.
+    auto scratch = env_t();
+    return evaluate(input_t(view), scratch);
+}
+
+/**
+ * @brief The arguments of a command as it sees them, i.e. without the quotes of its strings, and with
+ * the rendered values of its parenthesized expressions, e.g. 7 for (1 + 2 * 3).
+ *
+ * @throws error_t if an expression evaluates to an Error.
+ */
+static std::vector<std::string> command_args(pipeline_stage_t const& stage) {
+    auto result = std::vector<std::string>();
+    result.reserve(stage.args.size());
+    for (auto arg : stage.args) {
+        auto view = std::string_view(arg);
+        if (view.size() >= 2 && (view.front() == '"' || view.front() == '\'') && view.back() == view.front()) {
+            view = view.substr(1, view.size() - 2);
+        }
+        else if (view.size() >= 2 && view.front() == '(' && view.back() == ')') {
+            auto value = argument_value(arg);
+            if (value.kind() == entity_t::ERROR) {
+                types::throw_standard_error(types::error_t(value).what());
+            }
+            auto os = std::ostringstream();
+            render(value, os);
+            result.push_back(std::move(os).str());
+            continue;
+        }
+        result.emplace_back(view);
+    }
+    return result;
+}
+
+/**
+ * @brief Run an in-process command with @param input and @param output as its @ref local_input and
+ * @ref local_output. What it prints to @ref local_stdout is written to @param output after its values,
+ * one Str per line, wherever the stage runs.
+ */
+static int run_command(pipeline_stage_t const& stage, object_pipe& input, object_pipe& output) {
+    auto owned = command_args(stage);
+    auto args = std::vector<input_t>();
+    for (auto const& arg : owned) {
+        args.push_back(input_t(std::string_view(arg)));
+    }
+    // A command may run a pipeline of its own, so the pipes and stream of the caller are put back
+    // afterwards. Only the stream of the current thread is redirected: other stages may be printing too.
+    auto printed = std::ostringstream();
+    std::swap(local_input(), input);
+    std::swap(local_output(), output);
+    auto* saved_buffer = local_stdout().rdbuf(printed.rdbuf());
+    auto const restore = [&] {
+        std::swap(local_input(), input);
+        std::swap(local_output(), output);
+        local_stdout().rdbuf(saved_buffer);
+    };
+    auto code = int();
+    try {
+        code = execute(stage.command, args);
+    }
+    catch (...) {
+        restore();
+        throw;
+    }
+    restore();
+    for (auto& line : split_lines(std::move(printed).str())) {
+        if (not output.write(std::move(line))) {
+            break;
+        }
+    }
+    return code;
+}
+
+/**
+ * @brief The values coming into a Func stage through @param input, as a Seq that reads them as the Func
+ * passes over it. They're only read once: as with the Seq of a Chan, a second pass picks up where the
+ * first one stopped.
+ */
+static seq_t input_seq(std::shared_ptr<object_pipe> input) {
+    return seq_t([input]() -> generator<entity_t> {
+        while (auto value = input->read()) {
+            co_yield *value;
+        }
+    });
+}
+
+/**
+ * @brief Apply the Funcs @param funcs of adjacent Func @param stages one after the other, each to the
+ * values of its arguments and to what the one before returned, and the first one to @param input
+ * unless it starts the pipeline (see @ref execute). A Seq gains a stage from each of map, filter and
+ * take instead of being generated in between, so a run of them is a single loop over the input.
+ *
+ * @param code Set to the exit code of the last stage.
+ * @return entity_t The values the last stage passes on, as a List or a Seq.
+ */
+static entity_t apply_funcs(std::span<pipeline_stage_t const> stages, std::span<variable_t const* const> funcs,
+                            std::optional<entity_t> input, int& code) {
+    for (auto i = 0uz; i < stages.size(); ++i) {
+        auto args = list_t();
+        for (auto arg : stages[i].args) {
+            args.push_back(argument_value(arg));
+        }
+        if (input) {
+            args.push_back(std::move(*input));
+        }
+        auto func = func_t(funcs[i]->value);
+        auto result = args.size() == 1 ? func(std::move(args.front())) : func(entity_t(tuple_t(args.begin(), args.end())));
+        code = EXIT_SUCCESS;
+        switch (result.kind()) {
+        case entity_t::ERROR:
+            // Written at once, so that it isn't interleaved with what stages running side by side write.
+            std::cerr << "Error: " + std::string(stages[i].command) + ": " + types::error_t(result).what() + "\n";
+            code = EXIT_FAILURE;
+            input = entity_t(list_t());
+            break;
+        case entity_t::LIST:
+        case entity_t::SEQ:
+            input = std::move(result);
+            break;
+        default:
+            input = entity_t(list_t { std::move(result) });
+            break;
+        }
+    }
+    return std::move(*input);
+}
+
+/**
+ * @brief Write @param values, a List or a Seq, to @param output, no further than the next stage reads.
+ * A Seq is generated as it's written, in one loop.
+ */
+static void pass_on(entity_t values, object_pipe& output) {
+    if (values.kind() == entity_t::SEQ) {
+        values.get<seq_t>().for_each([&output](entity_t const& value) { return output.write(value); });
+        return;
+    }
+    for (auto& value : values.get<list_t>()) {
+        if (not output.write(std::move(value))) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Run adjacent Func @param stages as one (see @ref apply_funcs), reading @param input unless they
+ * start the pipeline, and write the values out of the last one to @param output.
+ *
+ * @return int The exit code of the last stage.
+ */
+static int run_funcs(std::span<pipeline_stage_t const> stages, std::span<variable_t const* const> funcs,
+                     std::optional<object_pipe> input, object_pipe& output) {
+    auto pipe = input ? std::make_shared<object_pipe>(std::move(*input)) : nullptr;
+    auto code = EXIT_SUCCESS;
+    pass_on(apply_funcs(stages, funcs, pipe ? std::optional(entity_t(input_seq(pipe))) : std::nullopt, code), output);
+    // The stage before sees its writes fail, even if a Func held on to the Seq of its values.
+    if (pipe) {
+        pipe->hang_up();
+    }
+    return code;
+}
+
+/**
+ * @brief The values out of adjacent Func @param stages, as @ref run_funcs writes them, but generated as
+ * the next stage reads them, on its thread: the Funcs are applied when it reads the first one.
+ */
+static generator<entity_t> generate_funcs(std::span<pipeline_stage_t const> stages, std::span<variable_t const* const> funcs,
+                                          std::shared_ptr<object_pipe> input) {
+    auto code = EXIT_SUCCESS;
+    auto values = apply_funcs(stages, funcs, input ? std::optional(entity_t(input_seq(input))) : std::nullopt, code);
+    if (values.kind() == entity_t::SEQ) {
+        for (auto const& value : values.get<seq_t>().iterate()) {
+            co_yield value;
+        }
+    }
+    else {
+        for (auto const& value : values.get<list_t>()) {
+            co_yield value;
+        }
+    }
+    if (input) {
+        input->hang_up();
+    }
+}
+
+/**
+ * @brief Start @param stage on a new process, reading from @param input and writing to @param output
+ * unless they're -1, in which case they're inherited.
+ *
+ * @return pid_t The child, or -1 if it couldn't be started.
+ */
+static pid_t spawn(pipeline_stage_t const& stage, int input, int output) {
+    auto owned = command_args(stage);
+    owned.insert(owned.begin(), std::string(stage.command));
+    auto argv = std::vector<char*>();
+    for (auto& arg : owned) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    auto const failed = "Error: " + std::string(stage.command) + ": ";
+    auto pid = ::fork();
+    if (pid == 0) {
+        // dup2 clears close-on-exec on the copies, and only on them.
+        if (input >= 0) {
+            ::dup2(input, STDIN_FILENO);
+        }
+        if (output >= 0) {
+            ::dup2(output, STDOUT_FILENO);
+        }
+        exec_child(argv.data(), failed);
+    }
+    return pid;
+}
+
+/**
+ * @brief The most text passed to or from external commands at once.
+ */
+static constexpr std::size_t k_pipe_chunk = 65536;
+
+/**
+ * @brief Run adjacent external commands on new processes, side by side, the standard output of each
+ * piped into the standard input of the next. The values of @param input are rendered into the standard
+ * input of the first, and each line of the standard output of the last is written to @param output as a
+ * Str, unless they're null, in which case they're inherited. The current thread supervises them all on
+ * its event loop: their exits, and the ends of the pipes it holds, whichever is ready first. Values are
+ * read as the first command takes them, and lines written as the last one prints them. Once @param output
+ * isn't read anymore, its pipe is closed, so that the last command gets SIGPIPE, as it would from a
+ * command after it that exited.
+ *
+ * @return int The exit code of the last command.
+ */
+static int run_external(std::span<pipeline_stage_t const> stages, object_pipe* input, object_pipe* output) {
+    // The standard input and output of each command, -1 for inherited ones, and the shell's ends.
+    auto reads = std::vector<int>(stages.size(), -1);
+    auto writes = std::vector<int>(stages.size(), -1);
+    auto feed = -1;
+    auto drain = -1;
+    auto const close_all = [&] {
+        for (auto* fds : { &reads, &writes }) {
+            for (auto& fd : *fds) {
+                if (fd >= 0) {
+                    ::close(std::exchange(fd, -1));
+                }
+            }
+        }
+        for (auto* fd : { &feed, &drain }) {
+            if (*fd >= 0) {
+                ::close(std::exchange(*fd, -1));
+            }
+        }
+    };
+    auto const make_pipe = [](int& read_end, int& write_end) {
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC) != 0) {
+            return false;
+        }
+        read_end = fds[0];
+        write_end = fds[1];
+        return true;
+    };
+    auto piped = (not input || make_pipe(reads.front(), feed)) && (not output || make_pipe(drain, writes.back()));
+    for (auto i = 1uz; piped && i < stages.size(); ++i) {
+        piped = make_pipe(reads[i], writes[i - 1]);
+    }
+    if (not piped) {
+        std::cerr << "Error: " << stages.front().command << ": " << std::strerror(errno) << "\n";
+        close_all();
+        return EXIT_FAILURE;
+    }
+
+    auto& loop = event_loop::local();
+    auto codes = std::vector<int>(stages.size(), EXIT_FAILURE);
+    for (auto i = 0uz; i < stages.size(); ++i) {
+        auto pid = spawn(stages[i], reads[i], writes[i]);
+        // The child has its copies; a command that couldn't start leaves its neighbours an end of input
+        // or a broken pipe.
+        for (auto* fd : { &reads[i], &writes[i] }) {
+            if (*fd >= 0) {
+                ::close(std::exchange(*fd, -1));
+            }
+        }
+        if (pid < 0) {
+            std::cerr << "Error: failed to run " << stages[i].command << "\n";
+            continue;
+        }
+        loop.watch_child(pid, [&codes, i](int status) {
+            codes[i] = exit_code(status);
+        });
+    }
+    if (feed >= 0) {
+        auto fd = std::exchange(feed, -1);
+        ::fcntl(fd, F_SETFL, O_NONBLOCK);
+        // Closing the pipe once every value is written is the end of the command's input. A command that
+        // exits before reading them all only fails the write, as the loop reads SIGPIPE, and the stage
+        // before sees its own writes fail in turn.
+        loop.watch(fd, EPOLLOUT, [input, fd, text = std::string(), written = 0uz](std::uint32_t) mutable {
+            while (true) {
+                if (written == text.size()) {
+                    // The values at hand are written together, but none is waited for with text to write.
+                    auto os = std::ostringstream();
+                    for (auto wait = true; wait || (input->ready() && os.tellp() < std::streamoff(k_pipe_chunk)); wait = false) {
+                        auto value = input->read();
+                        if (not value) {
+                            break;
+                        }
+                        render(*value, os);
+                        os << '\n';
+                    }
+                    text = std::move(os).str();
+                    written = 0;
+                    if (text.empty()) {
+                        return false;
+                    }
+                }
+                auto count = ::write(fd, text.data() + written, text.size() - written);
+                if (count < 0) {
+                    if (errno == EAGAIN || errno == EINTR) {
+                        return true;
+                    }
+                    input->hang_up();
+                    return false;
+                }
+                written += std::size_t(count);
+            }
+        });
+    }
+    if (drain >= 0) {
+        auto fd = std::exchange(drain, -1);
+        ::fcntl(fd, F_SETFL, O_NONBLOCK);
+        loop.watch(fd, EPOLLIN, [output, fd, line = std::string()](std::uint32_t) mutable {
+            auto buffer = std::array<char, k_pipe_chunk>();
+            // Checked before reading too, so that a command that prints now and then is stopped at its
+            // next line rather than once the values it wrote meanwhile fill the channel.
+            while (output->reading()) {
+                auto count = ::read(fd, buffer.data(), buffer.size());
+                if (count < 0) {
+                    return errno == EAGAIN || errno == EINTR;
+                }
+                if (count == 0) {
+                    if (not line.empty()) {
+                        output->write(entity_t(str_t(std::move(line))));
+                    }
+                    return false;
+                }
+                auto text = std::string_view(buffer.data(), std::size_t(count));
+                for (auto end = text.find('\n'); end != text.npos; end = text.find('\n')) {
+                    line.append(text.substr(0, end));
+                    if (not output->write(entity_t(str_t(std::exchange(line, std::string()))))) {
+                        return false;
+                    }
+                    text.remove_prefix(end + 1);
+                }
+                line.append(text);
+            }
+            return false;
+        });
+    }
+    loop.run();
+    return codes.back();
+}
+
+/**
+ * @brief What runs a stage of a pipeline (see @ref execute).
+ */
+enum class stage_kind {
+    EXTERNAL, COMMAND, FUNC
+};
+
+/**
+ * @brief Run adjacent @param stages of the same @param kind together on the current thread: external
+ * commands side by side, Func stages as one, or a single in-process command. They read @param input,
+ * unless they start the pipeline, and write their values to @param output, which an external last
+ * stage leaves null to write to the standard output itself.
+ *
+ * @return int The exit code of the last stage.
+ */
+static int run_stages(std::span<pipeline_stage_t const> stages, stage_kind kind, std::span<variable_t const* const> funcs,
+                      std::optional<object_pipe> input, object_pipe* output) {
+    switch (kind) {
+    case stage_kind::FUNC:
+        return run_funcs(stages, funcs, std::move(input), *output);
+    case stage_kind::COMMAND: {
+        auto in = input ? std::move(*input) : object_pipe();
+        return run_command(stages.front(), in, *output);
+    }
+    default:
+        return run_external(stages, input ? &*input : nullptr, output);
+    }
+}
+
+/**
+ * @brief Run a pipeline as @ref execute does, except that the values out of its last stage go into
+ * @param values rather than being rendered, if it isn't null.
+ */
+static int run_pipeline(std::vector<pipeline_stage_t> const& stages, std::ostream& os, list_t* values) {
+    auto& session = interpreter::current();
+    static auto const no_locals = env_t();
+    // The Func of each Func stage, and what runs each stage.
+    auto funcs = std::vector<variable_t const*>(stages.size());
+    auto kinds = std::vector<stage_kind>(stages.size());
+    for (auto i = 0uz; i < stages.size(); ++i) {
+        auto const& stage = stages[i];
+        auto is_command = session.command_map.contains(stage.command);
+        // Funcs take values, not options, so a name is only a Func past the first stage and without options.
+        // await names no command, so it's a Func wherever it is.
+        if ((i != 0 || stage.command == "await") && not is_command &&
+            stdr::none_of(stage.args, [](input_t arg) { return arg.starts_with('-'); })) {
+            auto const* variable = lookup(no_locals, stage.command);
+            funcs[i] = variable && variable->value.kind() == entity_t::FUNC ? variable : nullptr;
+        }
+        kinds[i] = funcs[i] ? stage_kind::FUNC : is_command ? stage_kind::COMMAND : stage_kind::EXTERNAL;
+    }
+
+    // The values out of the last stage are rendered as they come, or collected.
+    auto sink = values ? object_pipe(object_pipe::sink_type([values](entity_t value) {
+                             values->push_back(std::move(value));
+                             return true;
+                         }))
+                       : object_pipe(object_pipe::sink_type([&os](entity_t value) {
+                             render(value, os);
+                             os << '\n';
+                             return true;
+                         }));
+    auto const side_by_side = g_side_by_side.load(std::memory_order_relaxed);
+    auto interrupts = std::optional<interrupt_guard>();
+    auto threads = std::vector<std::thread>();
+    auto code = EXIT_SUCCESS;
+    // What the next stages read, unless they start the pipeline.
+    auto input = std::optional<object_pipe>();
+    for (auto i = 0uz; i < stages.size(); ) {
+        auto const kind = kinds[i];
+        auto end = i + 1;
+        while (end < stages.size() && kind != stage_kind::COMMAND && kinds[end] == kind) {
+            ++end;
+        }
+        auto const group = std::span(stages).subspan(i, end - i);
+        auto const group_funcs = std::span<variable_t const* const>(funcs).subspan(i, end - i);
+        try {
+            if (end == stages.size()) {
+                if (kind == stage_kind::EXTERNAL) {
+                    // Whatever was printed so far comes before what the commands print.
+                    os.flush();
+                    std::cout.flush();
+                }
+                code = run_stages(group, kind, group_funcs, std::move(input), kind == stage_kind::EXTERNAL && not values ? nullptr : &sink);
+            }
+            else if (kind == stage_kind::FUNC) {
+                // Applied by whatever reads them, on its thread.
+                auto pipe = input ? std::make_shared<object_pipe>(std::move(*input)) : nullptr;
+                input = object_pipe(generate_funcs(group, group_funcs, std::move(pipe)));
+            }
+            else if (kind == stage_kind::COMMAND && not side_by_side) {
+                auto output = object_pipe();
+                run_stages(group, kind, group_funcs, std::move(input), &output);
+                input = object_pipe(output.drain());
+            }
+            else {
+                if (kind == stage_kind::EXTERNAL && not interrupts) {
+                    interrupts.emplace();
+                }
+                auto channel = std::make_shared<object_pipe::channel_type>();
+                threads.emplace_back([&session, group, kind, group_funcs, channel, in = std::move(input)]() mutable {
+                    block_loop_signals();
+                    auto bound = interpreter::scope(session);
+                    auto out = object_pipe(channel, object_pipe::WRITE_END);
+                    try {
+                        run_stages(group, kind, group_funcs, std::move(in), &out);
+                    }
+                    catch (std::exception const& e) {
+                        std::cerr << "Error: " + std::string(group.front().command) + ": " + e.what() + "\n";
+                    }
+                });
+                input = object_pipe(channel, object_pipe::READ_END);
+            }
+        }
+        catch (std::exception const& e) {
+            std::cerr << "Error: " << group.front().command << ": " << e.what() << "\n";
+            code = EXIT_FAILURE;
+            input = object_pipe();
+        }
+        i = end;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return code;
+}
+
+int execute(std::vector<pipeline_stage_t> const& stages, std::ostream& os) {
+    return run_pipeline(stages, os, nullptr);
+}
+
+using token_span = std::span<std::pair<token_t, input_t> const>;
+
+static int run_line(token_span tokens, std::ostream& os, list_t* values);
+
+/**
+ * @brief A view of @param name that outlives the line it's on, since the variables are keyed by views.
+ * Blocks run on threads of their own, and bind names too.
+ */
+static input_t intern(input_t name) {
+    static auto names = std::unordered_set<std::string>();
+    static auto mutex = std::mutex();
+    auto lock = std::lock_guard(mutex);
+    return input_t(std::string_view(*names.emplace(std::string_view(name)).first));
+}
+
+/**
+ * @brief Run @code async name { commands } @endcode i.e. start running the commands on a thread of
+ * their own, and bind name to the Future of their values right away (see @ref execute).
+ */
+static int run_async(token_span tokens) {
+    if (tokens.size() != 3 || tokens[1].first != YSH_NAME || tokens[2].first != YSH_SCRIPT) {
+        std::cerr << "Error: Usage: async name { commands }\n";
+        return EXIT_FAILURE;
+    }
+    auto& session = interpreter::current();
+    // The block runs in a copy of the session, so that neither sees the other's variables change.
+    auto copy = std::make_shared<interpreter>();
+    copy->current_path = session.current_path;
+    copy->command_map = session.command_map;
+    copy->option_maps = session.option_maps;
+    copy->variables = session.variables;
+    // The line the block is on is gone by the time it runs.
+    auto block = std::string_view(tokens[2].second);
+    auto body = std::string(block.substr(1, block.size() - 2));
+    assign(session.variables, intern(tokens[1].second), entity_t(types::future_t([copy, body = std::move(body)] {
+        auto bound = interpreter::scope(*copy);
+        auto values = list_t();
+        run_line(tokenize(input_t(body)), std::cout, &values);
+        return entity_t(std::move(values));
+    })));
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run @code let name value @endcode i.e. bind name in the variables of the session to the value
+ * of value, evaluated as the argument of a Func stage is (see @ref argument_value), e.g.
+ * @code let twice ("x" -> "x + x") @endcode
+ */
+static int run_let(token_span tokens) {
+    if (tokens.size() != 3 || tokens[1].first != YSH_NAME) {
+        std::cerr << "Error: Usage: let name value\n";
+        return EXIT_FAILURE;
+    }
+    auto value = argument_value(tokens[2].second);
+    if (value.kind() == entity_t::ERROR) {
+        std::cerr << "Error: let: " << types::error_t(value).what() << "\n";
+        return EXIT_FAILURE;
+    }
+    assign(interpreter::current().variables, intern(tokens[1].second), std::move(value));
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run one pipeline of a command line (see @ref run_pipeline). Like lines, pipelines that don't
+ * start with a name are left alone.
+ */
+static int run_commands(token_span tokens, std::ostream& os, list_t* values) {
+    if (tokens.front().first != YSH_NAME) {
+        return EXIT_SUCCESS;
+    }
+    if (tokens.front().second == "async") {
+        return run_async(tokens);
+    }
+    if (tokens.front().second == "let") {
+        return run_let(tokens);
+    }
+    auto stages = std::vector<pipeline_stage_t>(1);
+    for (auto const& [kind, token] : tokens) {
+        if (kind == YSH_OPERATOR && token == "|") {
+            stages.emplace_back();
+        }
+        else if (stages.back().command.empty()) {
+            stages.back().command = token;
+        }
+        else {
+            stages.back().args.push_back(token);
+        }
+    }
+    if (stdr::any_of(stages, [](pipeline_stage_t const& stage) { return stage.command.empty(); })) {
+        std::cerr << "Error: empty command in a pipeline\n";
+        return EXIT_FAILURE;
+    }
+    return run_pipeline(stages, os, values);
+}
+
+/**
+ * @brief Run the pipelines of a command line one after the other. The values out of the last one go
+ * into @param values if it isn't null.
+ *
+ * @return int The exit code of the last pipeline.
+ */
+static int run_line(token_span tokens, std::ostream& os, list_t* values) {
+    auto const is_end = [](std::pair<token_t, input_t> const& token) {
+        return token.first == YSH_COMMENT || (token.first == YSH_OPERATOR && token.second == ";");
+    };
+    auto code = EXIT_SUCCESS;
+    while (not tokens.empty() && tokens.front().first != YSH_COMMENT) {
+        auto length = std::size_t(stdr::find_if(tokens, is_end) - tokens.begin());
+        auto last = length == tokens.size() || tokens[length].first == YSH_COMMENT;
+        // An empty pipeline, as in a line ending with ;, does nothing.
+        if (length != 0) {
+            code = run_commands(tokens.first(length), os, last ? values : nullptr);
+        }
+        tokens = tokens.subspan(std::min(length + 1, tokens.size()));
+    }
+    return code;
+}
+
+std::optional<int> execute(std::vector<std::pair<token_t, input_t>> const& tokens, std::ostream& os) {
+    if (tokens.empty() || tokens.front().first != YSH_NAME) {
+        return std::nullopt;
+    }
+    return run_line(tokens, os, nullptr);
+}
+
+} // namespace ysh
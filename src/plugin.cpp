@@ -0,0 +1,33 @@
+#include "../include/plugin.hpp"
+
+#include <dlfcn.h>
+
+namespace ysh {
+
+void plugin_registry::add(input_t name, command_t command, optmap_t options) {
+    m_session.command_map.insert_or_assign(name, command);
+    m_session.option_maps.insert_or_assign(name, std::move(options));
+    m_session.plugin_commands.insert(name);
+    ++m_added;
+}
+
+std::size_t load_plugin(stdf::path const& path) {
+    // Never closed: the commands registered point into the plugin.
+    auto* handle = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (not handle) {
+        types::throw_standard_error("Failed to load plugin: " + std::string(::dlerror()));
+    }
+    auto entry = reinterpret_cast<plugin_entry_t>(::dlsym(handle, k_plugin_entry));
+    if (not entry) {
+        types::throw_standard_error("Not a plugin: " + path.string());
+    }
+    auto& session = interpreter::current();
+    auto registry = plugin_registry(session);
+    entry(registry);
+    if (auto absolute = stdf::absolute(path); stdr::find(session.plugins, absolute) == session.plugins.end()) {
+        session.plugins.push_back(std::move(absolute));
+    }
+    return registry.size();
+}
+
+} // namespace ysh
@@ -0,0 +1,167 @@
+#include "../include/rope.hpp"
+
+namespace ysh::types {
+
+/**
+ * @brief A rope node: either a leaf holding its characters, or the concatenation of two non-empty
+ * ropes, which caches its flattened characters once they are asked for.
+ */
+struct str_t::node {
+    std::size_t size;
+    std::string leaf;
+    node_ptr left;
+    node_ptr right;
+    mutable std::atomic<std::shared_ptr<std::string const>> flat;
+
+    explicit node(std::string text)
+        : size(text.size()), leaf(std::move(text)) {}
+
+    node(node_ptr lhs, node_ptr rhs)
+        : size(lhs->size + rhs->size), left(std::move(lhs)), right(std::move(rhs)) {}
+
+    ~node();
+
+    [[nodiscard]]
+    bool is_leaf() const noexcept {
+        return not left;
+    }
+};
+
+str_t::node::~node() {
+    // A rope built by appending is a long left spine. Destroying it recursively could overflow the
+    // stack, so the nodes this one owns exclusively are torn down iteratively.
+    auto pending = std::vector<node_ptr>();
+    auto const release = [&pending](node_ptr& child) {
+        if (child && child.use_count() == 1) {
+            pending.push_back(std::move(child));
+        }
+    };
+    release(left);
+    release(right);
+    while (not pending.empty()) {
+        auto owned = std::move(pending.back());
+        pending.pop_back();
+        // Sole ownership means no one else can observe the node, and it wasn't created const.
+        auto& mutable_node = const_cast<node&>(*owned);
+        release(mutable_node.left);
+        release(mutable_node.right);
+    }
+}
+
+str_t::str_t(std::string value)
+    : m_node(value.empty() ? nullptr : std::make_shared<node const>(std::move(value))) {}
+
+str_t::str_t(std::string_view value)
+    : str_t(std::string(value)) {}
+
+str_t::str_t(char const* value)
+    : str_t(std::string(value)) {}
+
+str_t str_t::repeat(str_t const& unit, std::size_t count) {
+    if (count == 0 || unit.empty()) {
+        return str_t();
+    }
+    auto piece = unit.view();
+    if (piece.size() > std::string().max_size() / count) {
+        throw std::length_error("String too long.");
+    }
+    auto result = std::string();
+    result.reserve(piece.size() * count);
+    while (count-- > 0) {
+        result += piece;
+    }
+    return str_t(std::move(result));
+}
+
+std::size_t str_t::size() const noexcept {
+    return m_node ? m_node->size : 0;
+}
+
+void str_t::for_each_piece(std::invocable<std::string_view> auto&& func) const {
+    auto pending = std::vector<node const*>();
+    if (m_node) {
+        pending.push_back(m_node.get());
+    }
+    while (not pending.empty()) {
+        auto const* current = pending.back();
+        pending.pop_back();
+        if (current->is_leaf()) {
+            func(std::string_view(current->leaf));
+        }
+        else if (auto flat = current->flat.load(std::memory_order_acquire)) {
+            func(std::string_view(*flat));
+        }
+        else {
+            pending.push_back(current->right.get());
+            pending.push_back(current->left.get());
+        }
+    }
+}
+
+std::string_view str_t::view() const {
+    if (not m_node) {
+        return {};
+    }
+    if (m_node->is_leaf()) {
+        return m_node->leaf;
+    }
+    auto flat = m_node->flat.load(std::memory_order_acquire);
+    if (not flat) {
+        auto text = std::string();
+        text.reserve(m_node->size);
+        this->for_each_piece([&text](std::string_view piece) {
+            text += piece;
+        });
+        auto desired = std::shared_ptr<std::string const>(std::make_shared<std::string const>(std::move(text)));
+        // If another thread got there first, flat now holds its copy and ours is dropped.
+        if (m_node->flat.compare_exchange_strong(flat, desired, std::memory_order_acq_rel)) {
+            flat = std::move(desired);
+        }
+    }
+    return *flat;
+}
+
+str_t operator +(str_t const& lhs, str_t const& rhs) {
+    using node = str_t::node;
+    if (lhs.empty()) {
+        return rhs;
+    }
+    if (rhs.empty()) {
+        return lhs;
+    }
+    auto size = lhs.size() + rhs.size();
+    if (size <= str_t::k_chunk_size) {
+        auto text = std::string();
+        text.reserve(size);
+        text += lhs.view();
+        text += rhs.view();
+        return str_t(std::move(text));
+    }
+    // Appending a short piece: merge it into the last chunk rather than growing the rope by a node.
+    auto const& last = lhs.m_node->right;
+    if (last && last->is_leaf() && last->size + rhs.size() <= str_t::k_chunk_size) {
+        auto text = std::string();
+        text.reserve(last->size + rhs.size());
+        text += last->leaf;
+        text += rhs.view();
+        return str_t(std::make_shared<node const>(lhs.m_node->left, std::make_shared<node const>(std::move(text))));
+    }
+    return str_t(std::make_shared<node const>(lhs.m_node, rhs.m_node));
+}
+
+bool operator ==(str_t const& lhs, str_t const& rhs) {
+    return lhs.size() == rhs.size() && (lhs.m_node == rhs.m_node || lhs.view() == rhs.view());
+}
+
+std::strong_ordering operator <=>(str_t const& lhs, str_t const& rhs) {
+    return lhs.view() <=> rhs.view();
+}
+
+std::ostream& operator <<(std::ostream& os, str_t const& str) {
+    str.for_each_piece([&os](std::string_view piece) {
+        os << piece;
+    });
+    return os;
+}
+
+} // namespace ysh::types
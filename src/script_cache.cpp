@@ -0,0 +1,444 @@
+#include "../include/script_cache.hpp"
+#include "../include/pipeline.hpp"
+
+namespace ysh {
+
+using types::int_t;
+using types::list_t;
+using types::str_t;
+using types::throw_standard_error;
+
+static constexpr auto k_script_version = 3;
+
+/**
+ * @brief The kind of the single token standing for a line that couldn't be tokenized: it spans the
+ * line, which is tokenized again when it's run, to fail then.
+ */
+static constexpr int_t k_untokenized = -1;
+
+static void throw_corrupt() {
+    throw_standard_error("Corrupt compiled script");
+}
+
+/**
+ * @brief FNV-1a, which unlike std::hash is the same for every build reading the cache.
+ */
+static int_t content_hash(std::string_view text) noexcept {
+    auto result = std::uint64_t(0xcbf29ce484222325);
+    for (auto ch : text) {
+        result = (result ^ static_cast<unsigned char>(ch)) * 0x100000001b3;
+    }
+    return std::bit_cast<int_t>(result);
+}
+
+static std::string read_file(stdf::path const& path) {
+    auto file = std::ifstream(path, std::ios::binary);
+    if (not file.is_open()) {
+        throw_standard_error("Failed to open " + path.string());
+    }
+    return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+/**
+ * @brief Join the lines of @param text that are continued by an odd number of trailing backslashes,
+ * the same way the shell does.
+ *
+ * @return std::string The joined lines, each ended by a newline.
+ */
+static std::string join_lines(std::string_view text) {
+    auto result = std::string();
+    auto line = std::string();
+    while (not text.empty()) {
+        auto end = std::min(text.find('\n'), text.size());
+        line += text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        if ((line.size() - line.find_last_not_of('\\')) % 2 == 0) {
+            line.pop_back();
+            continue;
+        }
+        result += line;
+        result += '\n';
+        line.clear();
+    }
+    if (not line.empty()) {
+        result += line;
+        result += '\n';
+    }
+    return result;
+}
+
+/**
+ * @brief Compile an expression token of @param text into its cached form: its extent, then the code as
+ * (opcode, operator, name offset, name length) quadruples, then the constants pushed, in order. The
+ * offsets are relative to the text, so the names can be views into it once loaded.
+ */
+static std::optional<entity_t> compile_expression(std::string_view text, std::size_t offset, std::size_t length) {
+    auto compiled = expression_t();
+    try {
+        compiled = compile(input_t(text.substr(offset, length)));
+    }
+    catch (std::exception const&) {
+        // Leave it to the runtime to fail the same way.
+        return std::nullopt;
+    }
+    auto code = list_t();
+    auto constants = list_t();
+    for (auto const& inst : compiled.code) {
+        auto name_offset = inst.name.empty() ? 0 : offset + (inst.name.data() - compiled.source->data());
+        code.emplace_back(int_t(inst.opcode));
+        code.emplace_back(int_t(inst.op));
+        code.emplace_back(int_t(name_offset));
+        code.emplace_back(int_t(inst.name.size()));
+        if (inst.opcode == YSH_PUSH) {
+            // Folded constants may be Seqs, which can't be stored.
+            if (not serializable(inst.value)) {
+                return std::nullopt;
+            }
+            constants.push_back(inst.value);
+        }
+    }
+    return entity_t(list_t {
+        entity_t(int_t(offset)), entity_t(int_t(length)), entity_t(std::move(code)), entity_t(std::move(constants))
+    });
+}
+
+/**
+ * @brief The cached form of a script: a Tuple of the stamp, the joined lines, the index of the first
+ * token of each line (plus the total), the tokens as (kind, offset, length) triples and the compiled
+ * expressions. Each line is tokenized on its own, so one that fails doesn't keep the others from
+ * running: it's stored whole, as a token of kind k_untokenized.
+ */
+static entity_t compile_script(std::string_view source, entity_t stamp) {
+    auto text = join_lines(source);
+    auto lines = list_t { entity_t(int_t(0)) };
+    auto tokens = list_t();
+    auto expressions = list_t();
+    for (auto begin = 0uz; begin < text.size(); ) {
+        auto end = text.find('\n', begin);
+        auto line = std::string_view(text).substr(begin, end - begin);
+        auto line_tokens = std::vector<std::pair<token_t, input_t>>();
+        try {
+            line_tokens = tokenize(input_t(line));
+        }
+        catch (std::exception const&) {
+            tokens.emplace_back(k_untokenized);
+            tokens.emplace_back(int_t(begin));
+            tokens.emplace_back(int_t(line.size()));
+            lines.emplace_back(int_t(tokens.size() / 3));
+            begin = end + 1;
+            continue;
+        }
+        for (auto [kind, token] : line_tokens) {
+            auto offset = std::size_t(token.data() - text.data());
+            tokens.emplace_back(int_t(kind));
+            tokens.emplace_back(int_t(offset));
+            tokens.emplace_back(int_t(token.size()));
+            if (kind == YSH_EXPRESSION && token.size() >= 2) {
+                if (auto expression = compile_expression(text, offset + 1, token.size() - 2)) {
+                    expressions.push_back(*std::move(expression));
+                }
+            }
+        }
+        lines.emplace_back(int_t(tokens.size() / 3));
+        begin = end + 1;
+    }
+    auto result = types::tuple_t();
+    result.push(entity_t(std::move(expressions)));
+    result.push(entity_t(std::move(tokens)));
+    result.push(entity_t(std::move(lines)));
+    result.push(entity_t(str_t(std::move(text))));
+    result.push(std::move(stamp));
+    return entity_t(std::move(result));
+}
+
+/**
+ * @brief Check that the code of a cached expression is well-formed, as running it trusts that it is.
+ */
+static void check_code(std::vector<instruction_t> const& code) {
+    auto depth = 0uz;
+    for (auto const& inst : code) {
+        switch (inst.opcode) {
+        case YSH_PUSH:
+        case YSH_LOAD:
+            ++depth;
+            break;
+        case YSH_STORE:
+        case YSH_SQUARE:
+            break;
+        case YSH_APPLY:
+            depth = depth < 2 ? 0 : depth - 1;
+            break;
+        default:
+            throw_corrupt();
+        }
+        if (depth == 0) {
+            throw_corrupt();
+        }
+    }
+    if (depth != 1) {
+        throw_corrupt();
+    }
+}
+
+compiled_script::compiled_script(stdf::path const& path) {
+    auto const source = stdf::absolute(path);
+    auto err = std::error_code();
+    auto size = stdf::file_size(source, err);
+    auto mtime = stdf::last_write_time(source, err);
+    if (err) {
+        throw_standard_error("Failed to open " + source.string());
+    }
+    auto const mtime_ns = int_t(std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count());
+    auto const cache = cache_path(source);
+
+    auto text = std::optional<std::string>();
+    try {
+        auto file = mapped_file(cache);
+        auto root = record_view::root(file.bytes());
+        if (root.tag() != record_view::TUPLE || root.size() != 5) {
+            throw_corrupt();
+        }
+        auto stamp = root.child(0);
+        if (stamp.size() != 5 || stamp.child(0).as_int() != k_script_version ||
+            stamp.child(1).as_str() != source.native() || stamp.child(2).as_int() != int_t(size)) {
+            throw_corrupt();
+        }
+        // A script that was touched but not changed (say, checked out again) is still up to date.
+        if (stamp.child(3).as_int() != mtime_ns && stamp.child(4).as_int() != content_hash(text.emplace(read_file(source)))) {
+            throw_corrupt();
+        }
+        this->attach(file.bytes());
+        m_file.emplace(std::move(file));
+        m_cached = true;
+        return;
+    }
+    catch (types::error_t const&) {
+        // Missing, stale or corrupt: compile the script again.
+        m_expressions.clear();
+    }
+
+    if (not text) {
+        text.emplace(read_file(source));
+    }
+    auto stamp = list_t {
+        entity_t(int_t(k_script_version)), entity_t(str_t(source.string())), entity_t(int_t(size)),
+        entity_t(mtime_ns), entity_t(content_hash(*text))
+    };
+    auto compiled = compile_script(*text, entity_t(std::move(stamp)));
+    try {
+        stdf::create_directories(cache.parent_path());
+        save(cache, compiled);
+        m_file.emplace(cache);
+        this->attach(m_file->bytes());
+        return;
+    }
+    catch (std::exception const&) {
+        // Unwritable: keep the compiled form in memory only.
+        m_file.reset();
+        m_expressions.clear();
+    }
+    m_buffer = encode(compiled);
+    this->attach(m_buffer);
+}
+
+void compiled_script::attach(std::string_view data) {
+    auto root = record_view::root(data);
+    m_text = root.child(1).as_str();
+    auto lines = root.child(2);
+    auto tokens = root.child(3);
+    m_lines = lines.ints();
+    m_tokens = tokens.size() == 0 ? std::span<int_t const>() : tokens.ints();
+
+    if (m_lines.front() != 0 || m_tokens.size() % 3 != 0 || m_lines.back() != int_t(m_tokens.size() / 3) ||
+        not stdr::is_sorted(m_lines)) {
+        throw_corrupt();
+    }
+    auto const in_text = [this](int_t offset, int_t length) {
+        return offset >= 0 && length >= 0 && std::size_t(offset) <= m_text.size() &&
+            std::size_t(length) <= m_text.size() - std::size_t(offset);
+    };
+    for (auto i = 0uz; i < m_tokens.size(); i += 3) {
+        auto kind = m_tokens[i];
+        if ((kind < YSH_COMMENT || kind > YSH_STRING) && kind != k_untokenized) {
+            throw_corrupt();
+        }
+        if (not in_text(m_tokens[i + 1], m_tokens[i + 2])) {
+            throw_corrupt();
+        }
+    }
+
+    auto expressions = root.child(4);
+    m_expressions.reserve(expressions.size());
+    for (auto i = 0uz; i < expressions.size(); ++i) {
+        auto record = expressions.child(i);
+        if (record.size() != 4) {
+            throw_corrupt();
+        }
+        auto offset = record.child(0).as_int();
+        auto length = record.child(1).as_int();
+        auto code = record.child(2).ints();
+        auto constants = record.child(3);
+        if (not in_text(offset, length) || code.size() % 4 != 0) {
+            throw_corrupt();
+        }
+        // A name is a view into the expression it's in, and nothing else.
+        auto const in_expression = [offset, length](int_t name_offset, int_t name_length) {
+            return name_length == 0 ||
+                (name_offset >= offset && name_length <= length && name_offset - offset <= length - name_length);
+        };
+        auto compiled = expression_t();
+        auto pushed = 0uz;
+        for (auto j = 0uz; j < code.size(); j += 4) {
+            if (code[j] < YSH_PUSH || code[j] > YSH_SQUARE ||
+                code[j + 1] < YSH_NON_BUILTIN || code[j + 1] > YSH_ZIP || not in_expression(code[j + 2], code[j + 3])) {
+                throw_corrupt();
+            }
+            auto inst = instruction_t { .opcode = opcode_t(code[j]), .op = builtin_operator_t(code[j + 1]) };
+            if (code[j + 3] != 0) {
+                inst.name = input_t(m_text.substr(code[j + 2], code[j + 3]));
+            }
+            if (inst.opcode == YSH_PUSH) {
+                if (pushed == constants.size()) {
+                    throw_corrupt();
+                }
+                inst.value = constants.at(pushed++);
+            }
+            compiled.code.push_back(std::move(inst));
+        }
+        if (pushed != constants.size()) {
+            throw_corrupt();
+        }
+        check_code(compiled.code);
+        analyze(compiled);
+        m_expressions.emplace_back(input_t(m_text.substr(offset, length)), std::move(compiled));
+    }
+}
+
+std::vector<std::pair<token_t, input_t>> compiled_script::tokens(std::size_t line) const {
+    if (m_lines[line + 1] - m_lines[line] == 1 && m_tokens[3 * m_lines[line]] == k_untokenized) {
+        auto first = 3 * m_lines[line];
+        return tokenize(input_t(m_text.substr(m_tokens[first + 1], m_tokens[first + 2])));
+    }
+    auto result = std::vector<std::pair<token_t, input_t>>();
+    result.reserve(m_lines[line + 1] - m_lines[line]);
+    for (auto i = m_lines[line]; i < m_lines[line + 1]; ++i) {
+        result.emplace_back(token_t(m_tokens[3 * i]), input_t(m_text.substr(m_tokens[3 * i + 1], m_tokens[3 * i + 2])));
+    }
+    return result;
+}
+
+/**
+ * @brief Whether evaluating @param expr does nothing but compute its value, or load plugins: it
+ * applies no Func other than the one named plugin. What it assigns is thrown away with it.
+ */
+static bool only_computes(expression_t const& expr) {
+    // Whether each operand on the stack is the value of the name plugin.
+    auto plugins = std::vector<bool>();
+    for (auto const& inst : expr.code) {
+        switch (inst.opcode) {
+        case YSH_PUSH:
+            plugins.push_back(false);
+            break;
+        case YSH_LOAD:
+            plugins.push_back(inst.name == "plugin");
+            break;
+        case YSH_STORE:
+            break;
+        case YSH_SQUARE:
+            plugins.back() = false;
+            break;
+        case YSH_APPLY:
+            plugins.pop_back();
+            if (inst.op == YSH_APP && not plugins.back()) {
+                return false;
+            }
+            plugins.back() = false;
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Whether the line @param line is @code let name value @endcode with a value whose evaluation
+ * has no effects.
+ */
+static bool only_binds(std::span<std::pair<token_t, input_t> const> line) {
+    if (not line.empty() && line.back().first == YSH_COMMENT) {
+        line = line.first(line.size() - 1);
+    }
+    if (line.size() != 3 || line[0].second != "let" || line[1].first != YSH_NAME) {
+        return false;
+    }
+    auto value = std::string_view(line[2].second);
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        return true;
+    }
+    if (value.size() >= 2 && value.front() == '(' && value.back() == ')') {
+        value = value.substr(1, value.size() - 2);
+    }
+    return only_computes(compile(input_t(value)));
+}
+
+bool compiled_script::has_effects() const {
+    for (auto i = 0uz; i < size(); ++i) {
+        try {
+            auto line = tokens(i);
+            if (not line.empty() && line.front().first == YSH_NAME && not only_binds(line)) {
+                return true;
+            }
+        }
+        catch (std::exception const&) {
+            // Running it reports the error.
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief A copy of @param compiled, compiled from @param source, with a source of its own: its names
+ * are views into the copy rather than into the script.
+ */
+static expression_t detach(input_t source, expression_t const& compiled) {
+    auto result = expression_t { .source = std::make_unique<std::string const>(source), .code = compiled.code };
+    auto const rebase = [&](input_t name) {
+        return name.empty() ? input_t() : input_t(std::string_view(*result.source).substr(name.data() - source.data(), name.size()));
+    };
+    for (auto& inst : result.code) {
+        inst.name = rebase(inst.name);
+    }
+    stdr::transform(compiled.reads, std::back_inserter(result.reads), rebase);
+    result.pure = compiled.pure;
+    return result;
+}
+
+void compiled_script::prime(expression_cache& cache) const {
+    for (auto const& [source, compiled] : m_expressions) {
+        cache.insert(detach(source, compiled));
+    }
+}
+
+stdf::path compiled_script::cache_path(stdf::path const& path) {
+    return path.parent_path() / k_cache_dir / (path.filename() += ".yshc");
+}
+
+std::shared_ptr<compiled_script const> load_script(stdf::path const& path) {
+    return std::make_shared<compiled_script const>(path);
+}
+
+int shell(compiled_script const& script, std::ostream& os) {
+    script.prime(expression_cache::local());
+    for (auto i = 0uz; i < script.size(); ++i) {
+        // A line that fails is reported, and the script goes on, as it does when read from stdin.
+        try {
+            execute(script.tokens(i), os);
+        }
+        catch (std::exception const& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace ysh
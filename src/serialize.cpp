@@ -0,0 +1,501 @@
+#include "../include/serialize.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+namespace ysh {
+
+using types::bigint_t;
+using types::dict_t;
+using types::int_t;
+using types::list_t;
+using types::real_t;
+using types::str_t;
+using types::throw_standard_error;
+using types::tuple_t;
+
+static constexpr char k_magic[8] = { 'Y', 'S', 'H', 'B', 'I', 'N', '\0', '\0' };
+static constexpr std::uint32_t k_version = 1;
+static constexpr std::size_t k_header_size = 16;
+
+/**
+ * @brief The bytes of a Real holding its value. On x86 a long double only uses 10 of its 16 bytes, and
+ * the rest are left zero so that encoding is deterministic.
+ */
+static constexpr std::size_t k_real_bytes = std::numeric_limits<real_t>::digits == 64 ? 10 : sizeof(real_t);
+
+mapped_file::mapped_file(stdf::path const& path) {
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw_standard_error("Cannot open " + path.string() + ": " + std::strerror(errno));
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) < 0) {
+        auto err = errno;
+        ::close(fd);
+        throw_standard_error("Cannot stat " + path.string() + ": " + std::strerror(err));
+    }
+    m_size = std::size_t(info.st_size);
+    if (m_size != 0) {
+        m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    auto err = errno;
+    ::close(fd);
+    if (m_data == MAP_FAILED) {
+        m_data = nullptr;
+        throw_standard_error("Cannot map " + path.string() + ": " + std::strerror(err));
+    }
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+mapped_file& mapped_file::operator =(mapped_file&& other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    return *this;
+}
+
+mapped_file::~mapped_file() {
+    if (m_data) {
+        ::munmap(m_data, m_size);
+    }
+}
+
+/**
+ * @brief The encoder appends records to a buffer, writing the offsets of the children of a record into
+ * its table once they are known.
+ */
+class encoder {
+public:
+    encoder() {
+        m_out.append(k_magic, sizeof(k_magic));
+        this->put(k_version);
+        this->put(std::uint16_t(std::numeric_limits<real_t>::digits));
+        this->put(std::uint16_t(k_real_bytes));
+    }
+
+    std::string finish() && {
+        return std::move(m_out);
+    }
+
+    std::size_t write(entity_t const& value) {
+        using enum record_view::tag_type;
+        switch (value.kind()) {
+            case entity_t::INT:
+                return this->write_int(value.get<int_t>());
+            case entity_t::REAL: {
+                auto offset = this->begin(REAL);
+                this->put_real(value.get<real_t>());
+                return offset;
+            }
+            case entity_t::BIGINT:
+                return this->write_bigint(value.get<bigint_t>());
+            case entity_t::STR:
+                return this->write_str(STR, value.get<str_t>().view());
+            case entity_t::ERROR:
+                return this->write_str(ERROR, value.get<types::error_t>().msg);
+            case entity_t::LIST:
+                return this->write_list(value.get<list_t>());
+            case entity_t::TUPLE:
+                return this->write_elems(TUPLE, value.get<tuple_t>().to_list());
+            case entity_t::DICT:
+                return this->write_dict(value.get<dict_t>());
+            default:
+                throw_standard_error("Cannot serialize a " + entity_t::name(value.kind()));
+        }
+    }
+
+private:
+    void align(std::size_t alignment) {
+        m_out.resize((m_out.size() + alignment - 1) / alignment * alignment, '\0');
+    }
+
+    template<typename T>
+    void put(T const& value) {
+        m_out.append(reinterpret_cast<char const*>(&value), sizeof(T));
+    }
+
+    void put_real(real_t value) {
+        auto raw = std::array<char, sizeof(real_t)>();
+        std::memcpy(raw.data(), &value, k_real_bytes);
+        m_out.append(raw.data(), raw.size());
+    }
+
+    template<typename T>
+    void patch(std::size_t offset, T const& value) {
+        std::memcpy(m_out.data() + offset, &value, sizeof(T));
+    }
+
+    /**
+     * @brief Start a record with @param tag and @param flags.
+     * @return std::size_t The offset of the record.
+     */
+    std::size_t begin(record_view::tag_type tag, std::uint32_t flags = 0, std::size_t alignment = 8) {
+        this->align(alignment);
+        auto offset = m_out.size();
+        this->put(std::uint32_t(tag));
+        this->put(flags);
+        return offset;
+    }
+
+    std::size_t write_int(int_t value) {
+        auto offset = this->begin(record_view::INT);
+        this->put(value);
+        return offset;
+    }
+
+    std::size_t write_bigint(bigint_t const& value) {
+        auto offset = this->begin(record_view::BIGINT, value.negative());
+        this->put(std::uint64_t(value.limbs().size()));
+        m_out.append(reinterpret_cast<char const*>(value.limbs().data()), value.limbs().size() * sizeof(bigint_t::limb_type));
+        return offset;
+    }
+
+    std::size_t write_str(record_view::tag_type tag, std::string_view text) {
+        auto offset = this->begin(tag);
+        this->put(std::uint64_t(text.size()));
+        m_out.append(text);
+        return offset;
+    }
+
+    std::size_t write_list(list_t const& elems) {
+        auto const all = [&elems](entity_t::type kind) {
+            return not elems.empty() && stdr::all_of(elems, [kind](entity_t const& elem) { return elem.kind() == kind; });
+        };
+        if (all(entity_t::INT)) {
+            auto offset = this->begin(record_view::INT_ARRAY);
+            this->put(std::uint64_t(elems.size()));
+            for (auto const& elem : elems) {
+                this->put(elem.get<int_t>());
+            }
+            return offset;
+        }
+        if (all(entity_t::REAL)) {
+            // Aligned so that the array is aligned as real_t in a mapped file.
+            auto offset = this->begin(record_view::REAL_ARRAY, 0, alignof(real_t));
+            this->put(std::uint64_t(elems.size()));
+            this->align(alignof(real_t));
+            for (auto const& elem : elems) {
+                this->put_real(elem.get<real_t>());
+            }
+            return offset;
+        }
+        return this->write_elems(record_view::LIST, elems);
+    }
+
+    std::size_t write_elems(record_view::tag_type tag, list_t const& elems) {
+        auto offset = this->begin(tag);
+        this->put(std::uint64_t(elems.size()));
+        auto table = m_out.size();
+        m_out.resize(table + elems.size() * sizeof(std::uint64_t));
+        for (auto i = 0uz; i < elems.size(); ++i) {
+            this->patch(table + i * sizeof(std::uint64_t), std::uint64_t(this->write(elems[i])));
+        }
+        return offset;
+    }
+
+    std::size_t write_dict(dict_t const& dict) {
+        auto offset = this->begin(record_view::DICT);
+        this->put(std::uint64_t(dict.size()));
+        auto table = m_out.size();
+        m_out.resize(table + 2 * dict.size() * sizeof(std::uint64_t));
+        for (auto const& [key, value] : dict) {
+            this->patch(table, std::uint64_t(this->write(key)));
+            this->patch(table + sizeof(std::uint64_t), std::uint64_t(this->write(value)));
+            table += 2 * sizeof(std::uint64_t);
+        }
+        return offset;
+    }
+
+    std::string m_out;
+};
+
+[[noreturn]]
+static void throw_corrupt(std::string const& what) {
+    throw_standard_error("Corrupt binary data: " + what);
+}
+
+/**
+ * @brief Read a T at @param offset of @param data, checking the bounds.
+ */
+template<typename T>
+static T read(std::string_view data, std::size_t offset) {
+    if (offset > data.size() || data.size() - offset < sizeof(T)) {
+        throw_corrupt("truncated");
+    }
+    auto result = T();
+    std::memcpy(&result, data.data() + offset, sizeof(T));
+    return result;
+}
+
+/**
+ * @brief Check that @param count items of @param size bytes fit at @param offset of @param data.
+ */
+static void check_extent(std::string_view data, std::size_t offset, std::uint64_t count, std::size_t size) {
+    if (offset > data.size() || count > (data.size() - offset) / size) {
+        throw_corrupt("truncated");
+    }
+}
+
+static real_t read_real(std::string_view data, std::size_t offset) {
+    check_extent(data, offset, 1, sizeof(real_t));
+    auto result = real_t();
+    std::memcpy(&result, data.data() + offset, k_real_bytes);
+    return result;
+}
+
+record_view::record_view(std::string_view data, std::size_t offset)
+    : m_data(data), m_offset(offset), m_tag(tag_type(read<std::uint32_t>(data, offset))) {
+    if (offset % 8 != 0 || m_tag < INT || m_tag > REAL_ARRAY) {
+        throw_corrupt("invalid record");
+    }
+}
+
+record_view record_view::root(std::string_view data) {
+    if (data.size() < k_header_size || not data.starts_with(std::string_view(k_magic, sizeof(k_magic)))) {
+        throw_corrupt("not a ysh binary");
+    }
+    if (read<std::uint32_t>(data, 8) != k_version) {
+        throw_corrupt("unsupported version");
+    }
+    if (read<std::uint16_t>(data, 12) != std::numeric_limits<real_t>::digits || read<std::uint16_t>(data, 14) != k_real_bytes) {
+        throw_corrupt("Reals of another platform");
+    }
+    return record_view(data, k_header_size);
+}
+
+entity_t::type record_view::kind() const noexcept {
+    switch (m_tag) {
+        case INT:    return entity_t::INT;
+        case REAL:   return entity_t::REAL;
+        case BIGINT: return entity_t::BIGINT;
+        case STR:    return entity_t::STR;
+        case ERROR:  return entity_t::ERROR;
+        case TUPLE:  return entity_t::TUPLE;
+        case DICT:   return entity_t::DICT;
+        default:     return entity_t::LIST;
+    }
+}
+
+std::size_t record_view::size() const {
+    auto count = read<std::uint64_t>(m_data, m_offset + 8);
+    // Check the count against the bytes it implies, so that a corrupt count is caught before anything
+    // is allocated for it.
+    switch (m_tag) {
+        case INT:
+        case REAL:
+        case BIGINT:
+            throw_standard_error("A " + entity_t::name(this->kind()) + " has no size");
+        case STR:
+        case ERROR:
+            check_extent(m_data, m_offset + 16, count, 1);
+            break;
+        case LIST:
+        case TUPLE:
+        case INT_ARRAY:
+            check_extent(m_data, m_offset + 16, count, sizeof(std::uint64_t));
+            break;
+        case DICT:
+            check_extent(m_data, m_offset + 16, count, 2 * sizeof(std::uint64_t));
+            break;
+        case REAL_ARRAY:
+            check_extent(m_data, m_offset + 16, count, sizeof(real_t));
+            break;
+    }
+    return std::size_t(count);
+}
+
+record_view record_view::child(std::size_t index) const {
+    auto const count = m_tag == DICT ? 2 * this->size() : this->size();
+    if ((m_tag != LIST && m_tag != TUPLE && m_tag != DICT) || index >= count) {
+        throw_standard_error("No child " + std::to_string(index) + " in a " + entity_t::name(this->kind()));
+    }
+    auto offset = read<std::uint64_t>(m_data, m_offset + 16 + index * sizeof(std::uint64_t));
+    // Children always come after their parent, so a corrupt table can't make a cycle.
+    if (offset <= m_offset) {
+        throw_corrupt("invalid offset");
+    }
+    return record_view(m_data, std::size_t(offset));
+}
+
+entity_t record_view::at(std::size_t index) const {
+    switch (m_tag) {
+        case INT_ARRAY:
+            if (index < this->size()) {
+                return entity_t(this->ints()[index]);
+            }
+            break;
+        case REAL_ARRAY:
+            if (index < this->size()) {
+                return entity_t(read_real(m_data, (m_offset + 16 + alignof(real_t) - 1) / alignof(real_t) * alignof(real_t) + index * sizeof(real_t)));
+            }
+            break;
+        case LIST:
+        case TUPLE:
+            return this->child(index).to_entity();
+        default:
+            break;
+    }
+    throw_standard_error("No element " + std::to_string(index) + " in a " + entity_t::name(this->kind()));
+}
+
+int_t record_view::as_int() const {
+    if (m_tag != INT) {
+        throw_standard_error("Not an Int: " + entity_t::name(this->kind()));
+    }
+    return read<int_t>(m_data, m_offset + 8);
+}
+
+real_t record_view::as_real() const {
+    if (m_tag != REAL) {
+        throw_standard_error("Not a Real: " + entity_t::name(this->kind()));
+    }
+    return read_real(m_data, m_offset + 8);
+}
+
+std::string_view record_view::as_str() const {
+    if (m_tag != STR && m_tag != ERROR) {
+        throw_standard_error("Not a Str: " + entity_t::name(this->kind()));
+    }
+    return m_data.substr(m_offset + 16, this->size());
+}
+
+std::span<int_t const> record_view::ints() const {
+    if (m_tag != INT_ARRAY) {
+        throw_standard_error("Not an array of Ints");
+    }
+    auto size = this->size();
+    auto start = m_offset + 16;
+    check_extent(m_data, start, size, sizeof(int_t));
+    if (reinterpret_cast<std::uintptr_t>(m_data.data() + start) % alignof(int_t) != 0) {
+        throw_standard_error("Misaligned array of Ints");
+    }
+    return { reinterpret_cast<int_t const*>(m_data.data() + start), size };
+}
+
+std::span<real_t const> record_view::reals() const {
+    if (m_tag != REAL_ARRAY) {
+        throw_standard_error("Not an array of Reals");
+    }
+    auto size = this->size();
+    auto start = (m_offset + 16 + alignof(real_t) - 1) / alignof(real_t) * alignof(real_t);
+    check_extent(m_data, start, size, sizeof(real_t));
+    if (reinterpret_cast<std::uintptr_t>(m_data.data() + start) % alignof(real_t) != 0) {
+        throw_standard_error("Misaligned array of Reals");
+    }
+    return { reinterpret_cast<real_t const*>(m_data.data() + start), size };
+}
+
+entity_t record_view::to_entity() const {
+    switch (m_tag) {
+        case INT:
+            return entity_t(this->as_int());
+        case REAL:
+            return entity_t(this->as_real());
+        case BIGINT: {
+            auto count = read<std::uint64_t>(m_data, m_offset + 8);
+            check_extent(m_data, m_offset + 16, count, sizeof(bigint_t::limb_type));
+            auto limbs = bigint_t::magnitude_type(count);
+            if (count != 0) {
+                std::memcpy(limbs.data(), m_data.data() + m_offset + 16, count * sizeof(bigint_t::limb_type));
+            }
+            auto negative = read<std::uint32_t>(m_data, m_offset + 4) != 0;
+            return entity_t(bigint_t::from_limbs(std::move(limbs), negative));
+        }
+        case STR:
+            return entity_t(str_t(this->as_str()));
+        case ERROR:
+            return entity_t(types::error_t(std::string(this->as_str())));
+        case INT_ARRAY: {
+            auto result = list_t();
+            result.reserve(this->size());
+            for (auto value : this->ints()) {
+                result.emplace_back(value);
+            }
+            return entity_t(std::move(result));
+        }
+        case REAL_ARRAY:
+        case LIST: {
+            auto result = list_t();
+            result.reserve(this->size());
+            for (auto i = 0uz; i < this->size(); ++i) {
+                result.push_back(this->at(i));
+            }
+            return entity_t(std::move(result));
+        }
+        case TUPLE: {
+            // Tuples are built by pushing to the front.
+            auto result = tuple_t();
+            for (auto i = this->size(); i-- > 0;) {
+                result.push(this->at(i));
+            }
+            return entity_t(std::move(result));
+        }
+        case DICT: {
+            auto result = dict_t();
+            result.reserve(this->size());
+            for (auto i = 0uz; i < this->size(); ++i) {
+                result.insert_or_assign(this->child(2 * i).to_entity(), this->child(2 * i + 1).to_entity());
+            }
+            return entity_t(std::move(result));
+        }
+    }
+    throw_corrupt("invalid record");
+}
+
+bool serializable(entity_t const& value) {
+    switch (value.kind()) {
+    case entity_t::FUNC:
+    case entity_t::SEQ:
+    case entity_t::CHAN:
+    case entity_t::FUTURE:
+        return false;
+    case entity_t::LIST:
+        return stdr::all_of(value.get<list_t>(), serializable);
+    case entity_t::TUPLE:
+        return stdr::all_of(list_t(value), serializable);
+    case entity_t::DICT:
+        return stdr::all_of(value.get<dict_t>(), [](auto const& binding) {
+            return serializable(binding.first) && serializable(binding.second);
+        });
+    default:
+        return true;
+    }
+}
+
+std::string encode(entity_t const& value) {
+    auto out = encoder();
+    out.write(value);
+    return std::move(out).finish();
+}
+
+entity_t decode(std::string_view data) {
+    return record_view::root(data).to_entity();
+}
+
+std::size_t save(stdf::path const& path, entity_t const& value) {
+    auto data = encode(value);
+    auto temp = path;
+    temp += ".tmp";
+    {
+        auto file = std::ofstream(temp, std::ios::binary | std::ios::trunc);
+        if (not file.write(data.data(), std::streamsize(data.size())) || not file.flush()) {
+            throw_standard_error("Cannot write " + temp.string());
+        }
+    }
+    auto err = std::error_code();
+    stdf::rename(temp, path, err);
+    if (err) {
+        stdf::remove(temp, err);
+        throw_standard_error("Cannot write " + path.string());
+    }
+    return data.size();
+}
+
+entity_t load(stdf::path const& path) {
+    auto file = mapped_file(path);
+    return decode(file.bytes());
+}
+
+} // namespace ysh
@@ -0,0 +1,135 @@
+#include "../include/session.hpp"
+#include "../include/expression.hpp"
+#include "../include/plugin.hpp"
+#include "../include/serialize.hpp"
+
+namespace ysh {
+
+using types::dict_t;
+using types::func_t;
+using types::int_t;
+using types::list_t;
+using types::str_t;
+using types::throw_standard_error;
+using types::tuple_t;
+
+static constexpr auto k_session_version = 2;
+
+/**
+ * @brief What the snapshot depends on: the format version, then the path, size and modification time
+ * of each source, in order.
+ */
+static entity_t stamp(std::vector<stdf::path> const& sources) {
+    auto result = list_t { entity_t(k_session_version) };
+    for (auto const& source : sources) {
+        auto err = std::error_code();
+        auto size = stdf::file_size(source, err);
+        auto mtime = stdf::last_write_time(source, err);
+        if (err) {
+            // A missing source never matches, so the snapshot is never restored.
+            return entity_t(list_t());
+        }
+        result.emplace_back(str_t(stdf::absolute(source).string()));
+        result.emplace_back(int_t(size));
+        result.emplace_back(int_t(std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count()));
+    }
+    return entity_t(std::move(result));
+}
+
+std::size_t save_session(stdf::path const& path, std::vector<stdf::path> const& sources) {
+    auto& session = interpreter::current();
+    // A snapshot left by an earlier run would be restored instead of running the sources, so it goes
+    // as soon as a new one can't be taken.
+    auto const refuse = [&path](std::string const& reason) {
+        auto err = std::error_code();
+        stdf::remove(path, err);
+        throw_standard_error("Cannot snapshot the session: " + reason);
+    };
+    // Commands are code: only those of plugins are registered again, by loading the plugins again.
+    for (auto const& [name, command] : session.command_map) {
+        if (not session.plugin_commands.contains(name)) {
+            refuse("it registered the command " + std::string(name));
+        }
+    }
+    auto plugins = list_t();
+    for (auto const& plugin : session.plugins) {
+        plugins.emplace_back(str_t(plugin.string()));
+    }
+    // Funcs are code too: only those written in the scripts are compiled again, from their source.
+    auto variables = dict_t();
+    auto functions = dict_t();
+    for (auto const& [name, variable] : session.variables) {
+        auto key = entity_t(str_t(std::string_view(name)));
+        auto const* written = variable.value.kind() == entity_t::FUNC ? variable.value.get<func_t>().target<abstraction_t>() : nullptr;
+        if (written) {
+            auto source = list_t { entity_t(str_t(written->param)), entity_t(str_t(*written->body->source)) };
+            functions.insert_or_assign(std::move(key), entity_t(std::move(source)));
+        }
+        else if (serializable(variable.value)) {
+            variables.insert_or_assign(std::move(key), variable.value);
+        }
+        else {
+            refuse("the variable " + std::string(name) + " holds a " + entity_t::name(variable.value.kind()));
+        }
+    }
+    auto snapshot = tuple_t();
+    snapshot.push(entity_t(std::move(plugins)));
+    snapshot.push(entity_t(std::move(functions)));
+    snapshot.push(entity_t(std::move(variables)));
+    snapshot.push(stamp(sources));
+    stdf::create_directories(path.parent_path().empty() ? "." : path.parent_path());
+    return save(path, entity_t(std::move(snapshot)));
+}
+
+bool restore_session(stdf::path const& path, std::vector<stdf::path> const& sources) {
+    // The names of the restored variables are views into the snapshot, so it stays mapped.
+    static auto mutex = std::mutex();
+    static auto snapshots = std::vector<mapped_file>();
+    try {
+        auto file = mapped_file(path);
+        auto root = record_view::root(file.bytes());
+        if (root.tag() != record_view::TUPLE || root.size() != 4) {
+            return false;
+        }
+        auto expected = stamp(sources);
+        if (expected.get<list_t>().empty() || not root.child(0).to_entity().equivalent(expected)) {
+            return false;
+        }
+        auto variables = root.child(1);
+        auto functions = root.child(2);
+        auto plugins = root.child(3);
+        if (variables.tag() != record_view::DICT || functions.tag() != record_view::DICT || plugins.kind() != entity_t::LIST) {
+            return false;
+        }
+        auto restored = env_t();
+        for (auto i = 0uz; i < variables.size(); ++i) {
+            restored.emplace(variables.child(2 * i).as_str(), variable_t { .value = variables.child(2 * i + 1).to_entity() });
+        }
+        for (auto i = 0uz; i < functions.size(); ++i) {
+            auto source = functions.child(2 * i + 1);
+            if (source.kind() != entity_t::LIST || source.size() != 2) {
+                return false;
+            }
+            auto func = abstraction(std::string(source.child(0).as_str()), source.child(1).as_str());
+            if (func.kind() != entity_t::FUNC) {
+                return false;
+            }
+            restored.emplace(functions.child(2 * i).as_str(), variable_t { .value = std::move(func) });
+        }
+        // Loading a plugin registers its commands, so the variables are only restored once they all load.
+        for (auto i = 0uz; i < plugins.size(); ++i) {
+            load_plugin(std::string(plugins.child(i).as_str()));
+        }
+        for (auto& [name, variable] : restored) {
+            assign(interpreter::current().variables, name, std::move(variable.value));
+        }
+        auto lock = std::lock_guard(mutex);
+        snapshots.push_back(std::move(file));
+        return true;
+    }
+    catch (types::error_t const&) {
+        return false;
+    }
+}
+
+} // namespace ysh
@@ -1,5 +1,12 @@
 #include "../include/ysh.hpp"
+#include "../include/expression.hpp"
+#include "../include/builtins.hpp"
+#include "../include/daemon.hpp"
+#include "../include/event_loop.hpp"
 #include "../include/lambda.hpp"
+#include "../include/pipeline.hpp"
+#include "../include/script_cache.hpp"
+#include "../include/session.hpp"
 
 namespace ysh {
 
@@ -55,6 +62,7 @@ public:
             case '>':
             case '|':
             case '&':
+            case ';':
                 type = YSH_OPERATOR; break;
             default:
                 type = YSH_NAME; break;
@@ -105,6 +113,7 @@ public:
         if (m_handle) {
             m_handle.resume();
             if (m_handle.done()) {
+                m_handle.destroy();
                 m_handle = nullptr;
             }
         }
@@ -147,103 +156,89 @@ private:
 };
 
 
-entity_t evaluate(input_t expr, env_t& env) {
-    auto const first = [](auto&& first, auto&&... rest) {
-        return first;
-    };
-    auto const second = [](auto&& first, auto&& second, auto&&... rest) {
-        return second;
-    };
-
-    auto const app = [](auto&& f, entity_t const& arg_1, entity_t const& arg_2) -> decltype(f(arg_1, arg_2)) {
-        using function_type = entity_t (*)(decltype(arg_1), decltype(arg_2));
-        if constexpr (std::is_same_v<TYPE(f), input_t>) {
-            switch (function(f)) {
-                case YSH_ABSTR:  return operator_abstract(arg_1, arg_2);
-                case YSH_ADD:    return arg_1 + arg_2;
-                case YSH_AND:    return arg_1 & arg_2;
-                case YSH_APP:    return operator_apply(arg_1, arg_2);
-                case YSH_ASSIGN: return const_cast<entity_t&>(arg_1) = arg_2;
-                case YSH_CONCAT: return operator_concat(arg_1, arg_2);
-                case YSH_DIV:    return arg_1 / arg_2;
-                case YSH_EQ:     return arg_1 == arg_2;
-                case YSH_GE:     return entity_t(arg_1 >= arg_2);
-                case YSH_GT:     return arg_1 > arg_2;
-                case YSH_LE:     return arg_1 <= arg_2;
-                case YSH_LT:     return arg_1 < arg_2;
-                case YSH_MOD:    return arg_1 % arg_2;
-                case YSH_MUL:    return arg_1 * arg_2;
-                case YSH_NE:     return arg_1 != arg_2;
-                case YSH_OR:     return arg_1 | arg_2;
-                case YSH_POW:    return arg_1 ^ arg_2;
-                case YSH_SEQ:    return arg_2;
-                case YSH_SHL:    return arg_1 << arg_2;
-                case YSH_SHR:    return arg_1 >> arg_2;
-                case YSH_SUB:    return arg_1 - arg_2;
-            }
-        }
-        else {
+entity_t const& assign(env_t& env, input_t name, entity_t value) {
+    auto& var = env[name];
+    var.value = std::move(value);
+    var.generation = next_generation();
+    return var.value;
+}
 
-        }
-    };
+/**
+ * @brief The arguments bound to each option, indexed by @ref order, and the direct ones last.
+ */
+static std::vector<std::vector<input_t>>& argument_slots() {
+    static thread_local std::vector<std::vector<input_t>> arguments(64);
+    return arguments;
+}
 
-    std::string spaced_expr;
-    // Add spaces around operators. e.g. "a+b<<3" -> "a + b << 3"
-    for (auto ch : expr) {
-        if (ispunct(ch)) {
-            spaced_expr += ' ';
-            spaced_expr += ch;
-            spaced_expr += ' ';
-        } 
-        else {
-            spaced_expr += ch;
+int execute(input_t cmd, std::vector<input_t> const& args) {
+    auto& session = interpreter::current();
+    if (auto it = session.command_map.find(cmd); it != session.command_map.end()) {
+        // The command's arguments replace the caller's only while it runs.
+        auto saved_arguments = std::vector<std::vector<input_t>>(argument_slots().size());
+        auto saved_options = local_options();
+        saved_arguments.swap(argument_slots());
+        auto const restore = [&] {
+            argument_slots().swap(saved_arguments);
+            local_options() = saved_options;
+        };
+        try {
+            auto options = session.option_maps.find(cmd);
+            prepare(args, options == session.option_maps.end() ? optmap_t() : options->second);
+            auto result = it->second(args);
+            restore();
+            return result;
+        }
+        catch (...) {
+            restore();
+            throw;
         }
     }
-    // Split the expression into tokens.
-    auto tokens = spaced_expr | stdv::split(' ') 
-                              | stdv::filter([](auto const& token) {
-                                    return !token.empty();
-                                })
-                              | stdv::transform([](auto const& token) {
-                                    return input_t(token.begin(), token.end());
-                              });
-    
-    auto postfix_tokens = shunting_yard({ tokens.begin(), tokens.end() });
-    auto operands = std::stack<entity_t>();
 
-    for (auto token : postfix_tokens) {
-        if (is_identifier(token)) {
-            operands.push(g_variables[token]);
-        }
-        else if (is_integer(token)) {
-            int value;
-            std::from_chars(token.data(), token.data() + token.size(), value);
-            operands.emplace(value);
-        }
-        else if (is_floating_point(token)) {
-            double value;
-            std::from_chars(token.data(), token.data() + token.size(), value);
-            operands.emplace(value);
-        }
-        else if (is_operator(token)) {
-            auto rhs = operands.top();
-            operands.pop();
-            auto lhs = operands.top();
-            operands.pop();
-            operands.push(app(token, lhs, rhs));
-        }
+    auto owned = std::vector<std::string> { std::string(cmd) };
+    for (auto arg : args) {
+        owned.emplace_back(arg);
+    }
+    auto argv = std::vector<char*>();
+    for (auto& arg : owned) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    auto const failed = "Error: " + std::string(cmd) + ": ";
+    auto pid = fork();
+    if (pid == 0) {
+        exec_child(argv.data(), failed);
+    }
+    if (pid < 0) {
+        std::cerr << "Error: failed to run " << cmd << "\n";
+        return EXIT_FAILURE;
     }
+    return wait_child(pid);
+}
+
+entity_t evaluate(input_t expr, env_t& env) {
+    auto& cache = expression_cache::local();
+    auto const& compiled = cache.compile(expr);
+    // Whatever the expression evaluates in turn mustn't drop it from the cache.
+    auto pinned = expression_cache::pin(cache);
+    if (auto memo = cache.recall(compiled, env)) {
+        return *std::move(memo);
+    }
+    auto result = run(compiled, env);
+    cache.remember(compiled, env, result);
+    return result;
 }
 
-inline std::vector<input_t> forward_args(int argc, char* argv[]) {
+std::vector<input_t> forward_args(int argc, char* argv[]) {
     auto result = std::vector<input_t>();
-    for (auto i = 0; i < argc; ++i) {
-        result[i] = input_t(argv[i], strnlen(argv[i], 256));
+    // The program name isn't an argument.
+    for (auto i = 1; i < argc; ++i) {
+        result.push_back(input_t(argv[i], strnlen(argv[i], 256)));
     }
     return result;
 }
 
-inline enum_t generate_opts(std::vector<input_t> const& opts) {
+enum_t generate_opts(std::vector<input_t> const& opts) {
     auto result = enum_t();
     for (auto const& opt : opts) {
         for (auto ch : opt) {
@@ -253,9 +248,14 @@ inline enum_t generate_opts(std::vector<input_t> const& opts) {
     return result;
 }
 
-inline bool get_line(std::istream& is, std::string& line) {
+void get_hint(std::string&) {
+    // No completion yet: a tab is kept as typed.
+}
+
+bool get_line(std::istream& is, std::string& line) {
     char ch;
-    while (is >> ch) {
+    // Not >>, which would skip the spaces and the newline.
+    while (is.get(ch)) {
         if (ch == '\n') {
             return true;
         }
@@ -267,6 +267,29 @@ inline bool get_line(std::istream& is, std::string& line) {
     return false;       // EOF
 }
 
+static interpreter*& bound_interpreter() noexcept {
+    static thread_local interpreter* session = nullptr;
+    return session;
+}
+
+interpreter::scope::scope(interpreter& session) noexcept
+    : m_previous(std::exchange(bound_interpreter(), &session)) {}
+
+interpreter::scope::~scope() {
+    bound_interpreter() = m_previous;
+}
+
+interpreter::interpreter() {
+    auto err = std::error_code();
+    current_path = stdf::current_path(err);
+}
+
+interpreter& interpreter::current() noexcept {
+    static auto fallback = interpreter();
+    auto* session = bound_interpreter();
+    return session ? *session : fallback;
+}
+
 std::istream& input_stream(input_t name) {
     if (name == "stdin") {
         return std::cin;
@@ -317,30 +340,49 @@ bool is_string(input_t token) {
 }
 
 std::vector<input_t>& local_arguments(char opt) {
-    static thread_local std::vector<std::vector<input_t>> arguments(64);
     if (opt == '\0') {
-        return arguments.back();
+        return argument_slots().back();
     }
-    return arguments[order(opt)];
+    return argument_slots()[order(opt)];
 }
 
 std::vector<input_t>& local_arguments(enum_t opt) {
-    auto power = std::size_t(opt);
-    auto ord = 0;
-    while (power > 0) {
-        power >>= 1;
-        ++ord;
+    // option() sets the bit at order(), so that's where the slot is.
+    if (opt == 0) {
+        return argument_slots().back();
     }
-    if (ord >= order('a') && ord <= order('z')) {
+    return argument_slots()[std::countr_zero(opt)];
+}
+
+enum_t& local_options() {
+    static thread_local auto options = enum_t();
+    return options;
+}
 
+variable_t const* lookup(env_t const& env, input_t name) {
+    if (auto it = env.find(name); it != env.end()) {
+        return &it->second;
+    }
+    auto& variables = interpreter::current().variables;
+    if (auto it = variables.find(name); it != variables.end()) {
+        return &it->second;
+    }
+    if (auto it = builtins().find(name); it != builtins().end()) {
+        return &it->second;
     }
+    return nullptr;
 }
 
-inline enum_t option(char opt) {
+generation_t next_generation() noexcept {
+    static auto counter = std::atomic<generation_t>();
+    return ++counter;
+}
+
+enum_t option(char opt) {
     return 1ull << order(opt);
 }
 
-inline int order(char opt) {
+int order(char opt) {
     if (opt >= '0' && opt <= '9') {
         return opt - '0' + 1;
     }
@@ -355,9 +397,11 @@ inline int order(char opt) {
 
 static std::unordered_map<input_t, char, typename input_t::hash> optmap = {
     { "continue", 'c' },
+    { "daemon", 'd' },
     { "help", 'h' },
     { "output-stream", 'o' },
-    { "separate-process", 'p' }
+    { "separate-process", 'p' },
+    { "snapshot", 's' }
 };
 
 std::ostream& output_stream(input_t name) {
@@ -386,7 +430,7 @@ static token_generator parse(input_t line) {
     auto end = line.end();
     auto it = begin;
 
-    static auto compound = std::unordered_map<char, char> {
+    static auto const compound = std::unordered_map<char, char> {
         { '(', ')' },
         { '{', '}' },
         { '[', ']' },
@@ -395,27 +439,62 @@ static token_generator parse(input_t line) {
         { '`', '`' }
     };
 
-    auto left = '\0';
     auto s = std::stack<char>();
-    auto term = '\0';
+    auto const quoted = [&s] {
+        return not s.empty() && (s.top() == '\'' || s.top() == '"' || s.top() == '`');
+    };
 
     while (it != end) {
         auto ch = *it;
         // Yield a token as spaces are the delimiters.
         switch (ch) {
         case ' ':
-            co_yield { begin, it };
-            begin = ++it;
-            continue;
-        case '(': case '[': case '{': case '\'': case '"': case '`':
+            if (s.empty()) {
+                if (begin != it) {
+                    co_yield { begin, it };
+                }
+                begin = ++it;
+                continue;
+            }
+            break;
+        case '#':
+            // A comment runs to the end of the line.
+            if (s.empty() && begin == it) {
+                co_yield { begin, end };
+                co_return;
+            }
+            break;
+        case '\'': case '"': case '`':
+            if (quoted() && ch == s.top()) {
+                s.pop();
+                if (s.empty()) {
+                    co_yield { begin, ++it };
+                    begin = it;
+                    continue;
+                }
+                break;
+            }
+            [[fallthrough]];
+        case '(': case '[': case '{':
+            // Within quotes, brackets and other quotes are plain characters.
+            if (quoted()) {
+                break;
+            }
+            // A compound token doesn't have to be separated from the one before it.
+            if (s.empty() && begin != it) {
+                co_yield { begin, it };
+                begin = it;
+            }
             s.push(ch);
             break;
         case ')': case ']': case '}':
+            if (quoted()) {
+                break;
+            }
             if (s.empty()) {
                 throw std::runtime_error("unbalanced parentheses");
             }
-            if (compound[s.top()] == ch) {
-                auto top = s.top();
+            if (compound.at(s.top()) == ch) {
                 s.pop();
                 if (s.empty()) {
                     co_yield { begin, ++it };
@@ -425,22 +504,30 @@ static token_generator parse(input_t line) {
             }
             break;
         case '\\':
-            ++it;
-            if (it == end) {
+            // The escaped character is skipped along with the backslash.
+            if (++it == end) {
                 throw std::runtime_error("unexpected end of line");
             }
-            auto escape = *it;
-            switch (escape) {
-                
-            }
-        default: break;
+            break;
+        default:
+            break;
         }
+        ++it;
+    }
+    if (not s.empty()) {
+        throw std::runtime_error("unbalanced parentheses");
+    }
+    if (begin != end) {
+        co_yield { begin, end };
     }
-
 }
 
 enum_t prepare(std::vector<input_t> const& args, optmap_t const& optmap) {
-    enum_t result;
+    auto result = enum_t();
+    // A command line replaces whatever was bound before, e.g. in an interpreter forked from a server.
+    for (auto& slot : argument_slots()) {
+        slot.clear();
+    }
 
     auto const add_long_opt = [&optmap](auto&& opt_name) {
         auto long_opt = opt_name.substr(opt_name.begin() + 2);
@@ -450,11 +537,16 @@ enum_t prepare(std::vector<input_t> const& args, optmap_t const& optmap) {
         return option(optmap.at(long_opt));
     };
 
-    auto const add_short_opt = [&optmap](auto&& opt) {
-        if (not optmap.contains(opt)) {
-            throw std::runtime_error("unknown option: " + opt);
+    // Short options may be grouped, e.g. -abc.
+    auto const add_short_opt = [&optmap](auto&& opts) {
+        auto result = enum_t();
+        for (auto ch : std::string_view(opts).substr(1)) {
+            if (stdr::none_of(optmap, [ch](auto const& entry) { return entry.second == ch; })) {
+                throw std::runtime_error("unknown option: -" + std::string(1, ch));
+            }
+            result |= option(ch);
         }
-        return option(optmap.at(opt));
+        return result;
     };
 
     for (auto arg : args) {
@@ -494,6 +586,7 @@ enum_t prepare(std::vector<input_t> const& args, optmap_t const& optmap) {
             local_arguments().push_back(arg);
         }
     }
+    local_options() = result;
     return result;
 }
 
@@ -504,11 +597,14 @@ int run_separate_process(returning<int> auto&& program) {
         exit(program());
     }
     else {
-        int status;
-        if (waitpid(pid, &status, 0) == -1) {
-            std::cerr << "Error: waitpid() failed.\n";
+        int status = 0;
+        if (pid < 0) {
+            std::cerr << "Error: fork() failed.\n";
             return EXIT_FAILURE;
         }
+        auto& loop = event_loop::local();
+        loop.watch_child(pid, [&status](int exited) { status = exited; });
+        loop.run();
         if (WIFEXITED(status)) {
             int returned = WEXITSTATUS(status);
             std::cerr << "Shell exited with status " << returned << "\n";
@@ -533,23 +629,26 @@ int run_separate_process(returning<int> auto&& program) {
 }
 
 int shell(std::istream& is, std::ostream& os) {
-    std::string line, partial_line;
-    bool continued = true;
-    while (true) {
-        bool new_line = true;
-        while (new_line && (continued = get_line(is, partial_line))) {
+    auto more = true;
+    while (more) {
+        auto line = std::string();
+        while (true) {
+            auto partial_line = std::string();
+            more = get_line(is, partial_line);
             line += partial_line;
-            new_line = (line.size() - line.find_last_not_of('\\')) % 2 == 0;
-            if (new_line) {
-                line.pop_back();
+            // A line ending with an odd number of backslashes continues on the next one.
+            auto continued = (line.size() - line.find_last_not_of('\\')) % 2 == 0;
+            if (not more || not continued) {
+                break;
             }
+            line.pop_back();
         }
-        if (not continued) {
-            break;
+        try {
+            execute(tokenize({ line.begin(), line.end() }), os);
+        }
+        catch (std::exception const& e) {
+            std::cerr << "Error: " << e.what() << "\n";
         }
-
-        auto tokens = tokenize({ line.begin(), line.end() });
-        line.clear();
     }
     if (is.bad()) {
         std::cerr << "Error: input stream is bad.\n";
@@ -588,9 +687,6 @@ std::vector<input_t> shunting_yard(std::vector<input_t> const& tokens) {
             s.pop();
         }
         else {
-            while (i + 1 < size && is_operator(tokens[i + 1])) {
-                result.push_back(tokens[++i]);
-            }
             result.push_back(token);
         }
     }
@@ -601,7 +697,7 @@ std::vector<input_t> shunting_yard(std::vector<input_t> const& tokens) {
     return result;
 }
 
-void swap_streams(std::ios_base& s1, std::ios_base& s2) {
+void swap_streams(std::ios_base&, std::ios_base&) {
 
 }
 
@@ -615,18 +711,23 @@ std::vector<std::pair<token_t, input_t>> tokenize(input_t const& line) {
 }
 
 int ysh(enum_t opts) {
-    bool show_help = opts | option('h');
-    bool start_shell = opts | option('c');
-    bool separate_process = opts | option('p');
+    bool show_help = opts & option('h');
+    bool start_shell = opts & option('c');
+    bool separate_process = opts & option('p');
+    bool use_snapshot = opts & option('s');
+    bool serve_requests = opts & option('d');
 
-    auto& ostrm = opts | option('o') ? output_stream(local_arguments('o')[0]) : std::cout;
+    auto& ostrm = opts & option('o') ? output_stream(local_arguments('o')[0]) : std::cout;
     auto& istrm = local_arguments().empty() ? std::cin : input_stream(local_arguments()[0]);
 
     if (show_help) {
-        ostrm << "usage: ysh [-i input-stream] [-o ouput-stream] [-chp]\n"
+        ostrm << "usage: ysh [-i input-stream] [-o output-stream] [-cdhps]\n"
               << "\t-c --continue\n"
               << "\t\tContinue the shell after the input stream is exhausted.\n"
               << "\t\tIgnored if the input stream is stdin.\n"
+              << "\t-d --daemon [socket-path]\n"
+              << "\t\tServe runs forwarded by thin clients from a pool of interpreters, warmed up by the\n"
+              << "\t\tinput stream if it's not stdin. The socket defaults to $YSH_SOCKET.\n"
               << "\t-h --help\n"
               << "\t\tShow this help message on startup.\n"
               << "\t-i --input-stream\n"
@@ -634,20 +735,66 @@ int ysh(enum_t opts) {
               << "\t-o --output-stream\n"
               << "\t\tSpecify the output stream (can be altered later).\n"
               << "\t-p --separate-process\n"
-              << "\t\tRun the shell in a separate process.\n";
+              << "\t\tRun the shell in a separate process.\n"
+              << "\t-s --snapshot [snapshot-path]\n"
+              << "\t\tRestore the variables, Funcs and plugins set up by the input stream (with let) from a\n"
+              << "\t\tsnapshot instead of running it, unless it changed since or does more than set them up\n"
+              << "\t\t(say, prints or runs a command).\n"
+              << "\t\tThe snapshot defaults to <input-stream>.snapshot.\n";
+    }
+
+    // Scripts run from their compiled form, cached under __yshcache__ next to them, or straight from the
+    // stream if that can't be loaded.
+    auto script = std::shared_ptr<compiled_script const>();
+    if (&istrm != &std::cin) {
+        try {
+            script = load_script(std::string(local_arguments()[0]));
+        }
+        catch (std::exception const&) {
+            // Run from the stream.
+        }
+    }
+
+    // Snapshots are only taken of init scripts, which can be stamped, i.e. not of stdin. A snapshot
+    // holds nothing but the state the script leaves, so it only stands in for a script that does
+    // nothing but bind names and load plugins: one that prints or runs anything runs every time.
+    auto sources = std::vector<stdf::path>();
+    auto snapshot = stdf::path();
+    if (use_snapshot && script && not script->has_effects()) {
+        sources.emplace_back(std::string(local_arguments()[0]));
+        snapshot = local_arguments('s').empty() ? stdf::path(sources[0]) += ".snapshot" : stdf::path(std::string(local_arguments('s')[0]));
+    }
+    auto restored = not sources.empty() && restore_session(snapshot, sources);
+
+    // A server only runs an init script, if there's one: stdin is left to the clients.
+    if (not restored && not (serve_requests && &istrm == &std::cin)) {
+        auto const run = [&istrm, &ostrm, &script] {
+            return script ? shell(*script, ostrm) : shell(istrm, ostrm);
+        };
+        int retval;
+        if (separate_process) {
+            retval = run_separate_process(run);
+        }
+        else {
+            retval = run();
+        }
+        if (retval != EXIT_SUCCESS) {
+            return retval;
+        }
+        if (not sources.empty()) {
+            try {
+                save_session(snapshot, sources);
+            }
+            catch (std::exception const& e) {
+                std::cerr << "Warning: failed to save the snapshot: " << e.what() << "\n";
+            }
+        }
     }
 
-    int retval;
-    if (separate_process) {
-        retval = run_separate_process([&istrm, &ostrm] {
-            return shell(istrm, ostrm);
-        });
-    }
-    else {
-        retval = shell(istrm, ostrm);
-    }
-    if (retval != EXIT_SUCCESS) {
-        return retval;
+    if (serve_requests) {
+        // The interpreters are forked from here, so they start out with whatever the init script set.
+        auto socket = local_arguments('d').empty() ? default_socket() : stdf::path(std::string(local_arguments('d')[0]));
+        return serve(socket, std::max(std::thread::hardware_concurrency(), 2u));
     }
 
     if (start_shell && &istrm != &std::cin) {
@@ -658,7 +805,7 @@ int ysh(enum_t opts) {
     return EXIT_SUCCESS;
 }
 
-inline int ysh_main(int argc, char* argv[]) {
+int ysh_main(int argc, char* argv[]) {
     return ysh(prepare(forward_args(argc, argv), optmap));
 }
 
@@ -0,0 +1,97 @@
+#include "check.hpp"
+#include "../include/bigint.hpp"
+
+using namespace ysh;
+using types::bigint_t;
+
+/**
+ * @brief A value of @param limbs random limbs, the top one nonzero, drawn from @param random.
+ */
+static bigint_t random_bigint(std::mt19937_64& random, std::size_t limbs, bool negative = false) {
+    auto mag = bigint_t::magnitude_type(limbs);
+    for (auto& limb : mag) {
+        limb = bigint_t::limb_type(random());
+    }
+    mag.back() |= 1;
+    return bigint_t::from_limbs(std::move(mag), negative);
+}
+
+/**
+ * @brief 2 ^ @param bits - 1, i.e. @param bits one bits, built without multiplying.
+ */
+static bigint_t ones(std::size_t bits) {
+    return (bigint_t(1) << bits) - bigint_t(1);
+}
+
+/**
+ * @brief Whether the quotient and remainder of @param lhs by @param rhs are consistent with each other:
+ * lhs == q * rhs + r, |r| < |rhs|, and r has the sign of lhs.
+ */
+static bool divides_back(bigint_t const& lhs, bigint_t const& rhs) {
+    auto [quotient, remainder] = bigint_t::divmod(lhs, rhs);
+    auto const abs = [](bigint_t const& x) { return x.negative() ? -x : x; };
+    return quotient * rhs + remainder == lhs && abs(remainder) < abs(rhs) &&
+        (remainder.zero() || remainder.negative() == lhs.negative());
+}
+
+int main() {
+    auto random = std::mt19937_64(29);
+
+    // Products of operands past the Karatsuba threshold (32 limbs), checked against ones computed
+    // with shifts and additions only.
+    auto const nines = bigint_t::parse(std::string(1400, '9'));
+    auto const ten_700 = bigint_t::parse("1" + std::string(700, '0'));
+    CHECK((ten_700 + bigint_t(1)) * (ten_700 - bigint_t(1)) == nines);
+    CHECK(nines.to_string() == std::string(1400, '9'));
+    for (auto bits : { 1000uz, 1025uz, 3000uz, 4099uz }) {
+        // (2^n - 1)^2 == 2^2n - 2^(n+1) + 1
+        CHECK(ones(bits) * ones(bits) == (bigint_t(1) << 2 * bits) - (bigint_t(1) << (bits + 1)) + bigint_t(1));
+    }
+    for (auto [lsize, rsize] : { std::pair(40uz, 40uz), std::pair(100uz, 33uz), std::pair(257uz, 64uz) }) {
+        auto a = random_bigint(random, lsize);
+        auto b = random_bigint(random, rsize, true);
+        auto c = random_bigint(random, 5);
+        CHECK(a * (b + c) == a * b + a * c);
+        CHECK((a * b) * c == a * (b * c));
+        CHECK(a * b == b * a);
+        CHECK((a * b).negative());
+    }
+
+    // Knuth's division, checked both ways, including divisors whose top limb forces the estimated
+    // quotient digit to be corrected.
+    for (auto [lsize, rsize] : { std::pair(8uz, 3uz), std::pair(40uz, 39uz), std::pair(100uz, 33uz), std::pair(64uz, 2uz) }) {
+        for (auto negative : { false, true }) {
+            auto a = random_bigint(random, lsize, negative);
+            auto b = random_bigint(random, rsize, not negative);
+            CHECK(divides_back(a, b));
+            CHECK((a * b) / b == a);
+            CHECK(((a * b) % b).zero());
+        }
+    }
+    CHECK(divides_back(ones(32 * 9), ones(32 * 4)));
+    CHECK(divides_back(ones(32 * 9), bigint_t(1) << (32 * 4 - 1)));
+    CHECK(divides_back((bigint_t(1) << 32 * 6) + bigint_t(1), ones(32 * 2) << 31));
+    CHECK(bigint_t::divmod(ones(32 * 9), ones(32 * 9)).first == bigint_t(1));
+    CHECK(divides_back(bigint_t(7), ones(100)));
+
+    // Int arithmetic that overflows is promoted to a bigint, and back once the result fits again.
+    CHECK(test::eval("9223372036854775807 + 1").kind() == entity_t::BIGINT);
+    CHECK(types::str_t(test::eval("9223372036854775807 + 1")).view() == "9223372036854775808");
+    CHECK(test::eval("9223372036854775807 + 1 - 1").kind() == entity_t::INT);
+    CHECK(test::eval("(0 - 9223372036854775807 - 1) * (0 - 1)").kind() == entity_t::BIGINT);
+    CHECK(test::eval("2 ^ 64 / 2 ^ 60") == entity_t(16));
+    CHECK(test::eval("2 ^ 64 / 2 ^ 60").kind() == entity_t::INT);
+    CHECK(test::eval("3 ^ 200 % 3 ^ 199") == entity_t(0));
+    CHECK(test::eval("2 ^ 100 - 2 ^ 100").kind() == entity_t::INT);
+
+    // Powers too large to compute fail right away, but not those of 0, 1 and -1.
+    CHECK(test::eval("2 ^ 10000000000000").kind() == entity_t::ERROR);
+    CHECK(test::eval("(2 ^ 64) ^ 100000000").kind() == entity_t::ERROR);
+    CHECK(test::eval("2 ^ 100000").kind() == entity_t::BIGINT);
+    CHECK(test::eval("1 ^ 10000000000000") == entity_t(1));
+    CHECK(test::eval("(0 - 1) ^ 10000000000001") == entity_t(-1));
+    CHECK(test::eval("(0 - 1) ^ (2 ^ 70 + 1)") == entity_t(-1));
+    CHECK(test::eval("0 ^ (2 ^ 70)") == entity_t(0));
+
+    return test::result();
+}
@@ -0,0 +1,74 @@
+#include "check.hpp"
+#include "../include/builtins.hpp"
+#include "../include/parallel.hpp"
+
+using namespace ysh;
+using types::func_t;
+using types::int_t;
+using types::list_t;
+
+/**
+ * @brief Call the built-in function @param name with @param args, as a Tuple if there are several.
+ */
+static entity_t call(std::string_view name, auto... args) {
+    auto func = func_t(builtins().at(input_t(name)).value);
+    if constexpr (sizeof...(args) == 1) {
+        return func(entity_t(args)...);
+    }
+    else {
+        auto list = list_t { entity_t(args)... };
+        return func(entity_t(types::tuple_t(list.begin(), list.end())));
+    }
+}
+
+static list_t iota(std::size_t size) {
+    auto result = list_t();
+    for (auto i = 0uz; i < size; ++i) {
+        result.emplace_back(int_t(i));
+    }
+    return result;
+}
+
+int main() {
+    auto const large = k_parallel_threshold * 4;
+
+    // A Func of the host is called in order, on the calling thread, however large the List.
+    auto const caller = std::this_thread::get_id();
+    auto seen = std::vector<int_t>();
+    auto on_caller = true;
+    auto record = func_t([&](entity_t x) {
+        on_caller = on_caller && std::this_thread::get_id() == caller;
+        seen.push_back(int_t(x));
+        return x + entity_t(1);
+    });
+    auto mapped = call("map", record, iota(large));
+    CHECK(on_caller);
+    CHECK(seen.size() == large && stdr::is_sorted(seen));
+    CHECK(mapped.get<list_t>().back() == entity_t(int_t(large)));
+
+    seen.clear();
+    auto even = func_t([&](entity_t x) {
+        on_caller = on_caller && std::this_thread::get_id() == caller;
+        seen.push_back(int_t(x));
+        return entity_t(int_t(x) % 2 == 0);
+    });
+    auto filtered = call("filter", even, iota(large));
+    CHECK(on_caller);
+    CHECK(seen.size() == large && stdr::is_sorted(seen));
+    CHECK(filtered.get<list_t>().size() == large / 2);
+
+    // A built-in without side effects may run on the pool, with the same result.
+    auto pairs = list_t();
+    for (auto i = 0uz; i < large; ++i) {
+        pairs.emplace_back(list_t { entity_t(int_t(i)), entity_t(int_t(1)) });
+    }
+    auto sums = call("map", builtins().at("sum").value, pairs);
+    CHECK(sums.get<list_t>().size() == large);
+    CHECK(sums.get<list_t>()[41] == entity_t(42));
+    CHECK(sums.get<list_t>().back() == entity_t(int_t(large)));
+
+    // Small Lists and Seqs still map and filter.
+    CHECK(call("map", record, iota(3)).get<list_t>() == list_t { entity_t(1), entity_t(2), entity_t(3) });
+    CHECK(call("count", call("filter", even, call("seq", iota(10)))) == entity_t(5));
+    return test::result();
+}
@@ -0,0 +1,156 @@
+#include "check.hpp"
+#include "../include/channel.hpp"
+
+using namespace ysh;
+
+/**
+ * @brief Call @param body, which should return within a few seconds. If it hangs instead, its threads
+ * are blocked on a channel for good, so the checks end there and then.
+ */
+static void within_seconds(std::invocable auto&& body) {
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    auto thread = std::thread([&body, done] {
+        body();
+        done->store(true);
+    });
+    for (auto i = 0; i < 500 && not done->load(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(done->load());
+    if (not done->load()) {
+        std::_Exit(test::result());
+    }
+    thread.join();
+}
+
+int main() {
+    // A small SPSC channel passes every value in order, with each side sleeping on the other in turn.
+    {
+        auto channel = spsc_channel<int>(2);
+        auto producer = std::thread([&channel] {
+            for (auto i = 0; i < 100000; ++i) {
+                channel.push(i);
+            }
+            channel.close();
+        });
+        auto in_order = 0;
+        while (auto value = channel.pop()) {
+            in_order += *value == in_order;
+        }
+        producer.join();
+        CHECK(in_order == 100000);
+    }
+
+    // Closing wakes a consumer sleeping on an empty channel, and hanging up a producer on a full one.
+    {
+        auto channel = spsc_channel<int>(2);
+        auto ended = false;
+        within_seconds([&] {
+            auto consumer = std::thread([&] { ended = not channel.pop(); });
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            channel.close();
+            consumer.join();
+        });
+        CHECK(ended);
+    }
+    {
+        auto channel = spsc_channel<int>(2);
+        auto pushed = 0;
+        within_seconds([&] {
+            auto producer = std::thread([&] {
+                while (channel.push(pushed)) {
+                    ++pushed;
+                }
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            channel.hang_up();
+            producer.join();
+        });
+        CHECK(pushed == 2);
+    }
+
+    // Values from several producers to several consumers each arrive once, none lost or duplicated, and
+    // the values of a producer reach a consumer in the order they were pushed.
+    {
+        constexpr auto producers = 4;
+        constexpr auto consumers = 4;
+        constexpr auto count = 20000;
+        auto channel = mpmc_channel<int>(8, producers);
+        auto received = std::vector<std::vector<int>>(consumers);
+        auto threads = std::vector<std::thread>();
+        for (auto p = 0; p < producers; ++p) {
+            threads.emplace_back([&channel, p] {
+                for (auto i = 0; i < count; ++i) {
+                    channel.push(p * count + i);
+                }
+                channel.close();
+            });
+        }
+        for (auto c = 0; c < consumers; ++c) {
+            threads.emplace_back([&channel, &mine = received[c]] {
+                while (auto value = channel.pop()) {
+                    mine.push_back(*value);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto all = std::vector<int>();
+        auto ordered = true;
+        for (auto const& mine : received) {
+            auto last = std::vector<int>(producers, -1);
+            for (auto value : mine) {
+                ordered &= value > std::exchange(last[value / count], value);
+            }
+            all.insert(all.end(), mine.begin(), mine.end());
+        }
+        stdr::sort(all);
+        CHECK(ordered);
+        CHECK(all.size() == producers * count);
+        CHECK(stdr::equal(all, stdv::iota(0, producers * count)));
+    }
+
+    // The last of its producers to close the channel wakes every consumer sleeping on it, and hanging up
+    // wakes every producer waiting for room.
+    {
+        auto channel = mpmc_channel<int>(2, 2);
+        auto ended = std::atomic<int>();
+        within_seconds([&] {
+            auto threads = std::vector<std::thread>();
+            for (auto c = 0; c < 3; ++c) {
+                threads.emplace_back([&] { ended += not channel.pop(); });
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            channel.close();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            CHECK(ended == 0);
+            channel.close();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+        CHECK(ended == 3);
+    }
+    {
+        auto channel = mpmc_channel<int>(2, 3);
+        auto failed = std::atomic<int>();
+        within_seconds([&] {
+            auto threads = std::vector<std::thread>();
+            for (auto p = 0; p < 3; ++p) {
+                threads.emplace_back([&channel, &failed, p] {
+                    while (channel.push(p)) {}
+                    ++failed;
+                });
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            channel.hang_up();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+        CHECK(failed == 3);
+    }
+
+    return test::result();
+}
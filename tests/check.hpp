@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../include/ysh.hpp"
+
+#include <fcntl.h>
+
+/**
+ * @brief A minimal harness for the behavioural checks under tests/. Each *_test.cpp is a program of its
+ * own, linked with the objects of src/ and with -lfmt -ldl -lpthread, which exits with the number of
+ * failed checks.
+ */
+namespace ysh::test {
+
+inline int failures = 0;
+
+inline void report(bool passed, char const* what, char const* file, int line) {
+    if (not passed) {
+        ++failures;
+        std::cerr << file << ':' << line << ": check failed: " << what << "\n";
+    }
+}
+
+#define CHECK(...) ::ysh::test::report(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+
+/**
+ * @brief Call @param body.
+ * @return std::string What it wrote to stdout, including what the processes it started wrote.
+ */
+inline std::string capture(std::invocable auto&& body) {
+    std::cout.flush();
+    auto file = std::tmpfile();
+    auto saved = ::dup(STDOUT_FILENO);
+    ::dup2(::fileno(file), STDOUT_FILENO);
+    body();
+    std::cout.flush();
+    ::dup2(saved, STDOUT_FILENO);
+    ::close(saved);
+    auto result = std::string();
+    auto buffer = std::array<char, 4096>();
+    std::rewind(file);
+    for (auto count = 0uz; (count = std::fread(buffer.data(), 1, buffer.size(), file)) != 0;) {
+        result.append(buffer.data(), count);
+    }
+    std::fclose(file);
+    return result;
+}
+
+/**
+ * @brief Run @param script as the shell would run it from stdin.
+ * @return std::string What it wrote to stdout.
+ */
+inline std::string run(std::string const& script) {
+    return capture([&script] {
+        auto is = std::istringstream(script);
+        shell(is, std::cout);
+    });
+}
+
+/**
+ * @brief A directory of its own under the temporary directory, removed with everything in it when
+ * the check ends.
+ */
+class scratch_dir {
+public:
+    scratch_dir() {
+        auto pattern = (stdf::temp_directory_path() / "ysh-test-XXXXXX").string();
+        m_path = ::mkdtemp(pattern.data());
+    }
+
+    scratch_dir(scratch_dir const&) = delete;
+
+    scratch_dir& operator =(scratch_dir const&) = delete;
+
+    ~scratch_dir() {
+        auto err = std::error_code();
+        stdf::remove_all(m_path, err);
+    }
+
+    /**
+     * @brief The file @param name in the directory, written with @param contents.
+     */
+    stdf::path write(std::string const& name, std::string_view contents) const {
+        auto path = m_path / name;
+        std::ofstream(path, std::ios::binary) << contents;
+        return path;
+    }
+
+    [[nodiscard]]
+    stdf::path const& path() const noexcept {
+        return m_path;
+    }
+
+private:
+    stdf::path m_path;
+};
+
+/**
+ * @brief The value of the expression @param expr (without the surrounding parentheses).
+ */
+inline entity_t eval(std::string const& expr) {
+    auto scratch = env_t();
+    return evaluate(input_t(std::string_view(expr)), scratch);
+}
+
+/**
+ * @brief The exit code for the checks run so far.
+ */
+inline int result() {
+    if (failures == 0) {
+        std::cerr << "all checks passed\n";
+    }
+    return failures;
+}
+
+} // namespace ysh::test
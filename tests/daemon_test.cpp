@@ -0,0 +1,118 @@
+#include "check.hpp"
+#include "../include/daemon.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+using namespace ysh;
+
+/**
+ * @brief Start a process listening on @param path as the user @param uid, which accepts a single
+ * connection and exits with 0 if nothing was sent on it. Returns once it listens.
+ */
+static pid_t listen_as(stdf::path const& path, uid_t uid) {
+    auto address = sockaddr_un {};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    auto listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ::bind(listener, reinterpret_cast<sockaddr const*>(&address), sizeof(address));
+    int ready[2];
+    ::pipe(ready);
+    auto pid = ::fork();
+    if (pid == 0) {
+        // The credentials of a listening socket are those of the process that called listen.
+        if (::setuid(uid) != 0 || ::listen(listener, 1) != 0) {
+            std::_Exit(2);
+        }
+        ::close(ready[1]);
+        auto fd = ::accept(listener, nullptr, nullptr);
+        auto byte = char();
+        std::_Exit(::recv(fd, &byte, 1, 0) == 0 ? 0 : 1);
+    }
+    ::close(listener);
+    ::close(ready[1]);
+    auto byte = char();
+    ::read(ready[0], &byte, 1);
+    ::close(ready[0]);
+    return pid;
+}
+
+int main() {
+    // The program name isn't an argument.
+    char program[] = "ysh", help[] = "-h", script[] = "init.ysh";
+    char* argv[] = { program, help, script, nullptr };
+    CHECK(forward_args(1, argv).empty());
+    CHECK(forward_args(3, argv) == std::vector<input_t> { "-h", "init.ysh" });
+
+    // Options, packs and plain arguments are bound, and a new command line replaces them.
+    auto const optmap = optmap_t { { "help", 'h' }, { "output-stream", 'o' }, { "snapshot", 's' } };
+    auto opts = prepare({ "-h", "[--output-stream out.txt]", "init.ysh" }, optmap);
+    CHECK(opts & option('h'));
+    CHECK(opts & option('o'));
+    CHECK(not (opts & option('s')));
+    CHECK(local_arguments('o') == std::vector<input_t> { "out.txt" });
+    CHECK(local_arguments() == std::vector<input_t> { "init.ysh" });
+    opts = prepare({ "other.ysh" }, optmap);
+    CHECK(opts == 0);
+    CHECK(local_arguments('o').empty());
+    CHECK(local_arguments() == std::vector<input_t> { "other.ysh" });
+    auto unknown = false;
+    try {
+        prepare({ "-x" }, optmap);
+    }
+    catch (std::runtime_error const&) {
+        unknown = true;
+    }
+    CHECK(unknown);
+
+    // A request and its descriptors go through a socket whole.
+    int pair[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair);
+    CHECK(peer_is_owner(pair[0]));
+    auto const sent = request_t { .arguments = { "ysh", "-c" }, .environment = { "A=1", "B=" }, .directory = "/tmp" };
+    auto const stdio = std::array { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    CHECK(send_request(pair[0], sent, stdio));
+    auto fds = std::vector<int>();
+    auto received = receive_request(pair[1], fds);
+    CHECK(received && received->arguments == sent.arguments && received->environment == sent.environment);
+    CHECK(received && received->directory == sent.directory);
+    CHECK(fds.size() == 3 && stdr::all_of(fds, [](int fd) { return ::fcntl(fd, F_GETFD) >= 0; }));
+    for (auto fd : fds) {
+        ::close(fd);
+    }
+    ::close(pair[0]);
+    ::close(pair[1]);
+
+    // Without a server, nothing is forwarded.
+    auto dir = test::scratch_dir();
+    CHECK(not forward_request(dir.path() / "none.sock", 3, argv));
+
+    // Without a server, the client executes the interpreter it's told to, as long as it's not itself.
+    auto const fall_back = [&dir, &argv](char const* interpreter) {
+        auto pid = ::fork();
+        if (pid == 0) {
+            ::setenv("YSH_SOCKET", (dir.path() / "none.sock").c_str(), 1);
+            ::setenv("YSH_INTERPRETER", interpreter, 1);
+            std::_Exit(client_main(3, argv));
+        }
+        auto status = 0;
+        ::waitpid(pid, &status, 0);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    };
+    CHECK(fall_back("/bin/true") == 0);
+    CHECK(fall_back("/bin/false") == 1);
+    CHECK(fall_back(stdf::read_symlink("/proc/self/exe").c_str()) == 127);
+    CHECK(fall_back((dir.path() / "missing").c_str()) == 127);
+
+    // Nor is anything sent to a server of another user, which only root can start here.
+    if (::getuid() == 0) {
+        auto path = dir.path() / "other.sock";
+        auto pid = listen_as(path, 65534);
+        CHECK(not forward_request(path, 3, argv));
+        auto status = 0;
+        ::waitpid(pid, &status, 0);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    return test::result();
+}
@@ -0,0 +1,145 @@
+#include "check.hpp"
+#include "../include/dict.hpp"
+
+using namespace ysh;
+using types::dict_t;
+using types::int_t;
+using types::real_t;
+
+static entity_t key(int_t value) {
+    return entity_t(value);
+}
+
+/**
+ * @brief Whether @param dict binds exactly the keys of @param model, to the same values.
+ */
+static bool matches(dict_t const& dict, std::unordered_map<int_t, int_t> const& model) {
+    if (dict.size() != model.size()) {
+        return false;
+    }
+    auto seen = 0uz;
+    for (auto const& [k, v] : dict) {
+        auto it = model.find(int_t(k));
+        if (it == model.end() || v != entity_t(it->second)) {
+            return false;
+        }
+        ++seen;
+    }
+    return seen == model.size() && stdr::all_of(model, [&dict](auto const& pair) {
+        auto const* value = dict.find(key(pair.first));
+        return value && *value == entity_t(pair.second);
+    });
+}
+
+int main() {
+    // Keys inserted past several resizes are all found, and erased ones aren't.
+    auto dict = dict_t();
+    for (auto i = int_t(0); i < 10000; ++i) {
+        CHECK(dict.try_emplace(key(i), key(i * i)).second);
+    }
+    CHECK(dict.size() == 10000);
+    auto found = 0;
+    for (auto i = int_t(0); i < 10000; ++i) {
+        auto const* value = dict.find(key(i));
+        found += value && *value == key(i * i);
+    }
+    CHECK(found == 10000);
+    for (auto i = int_t(0); i < 10000; i += 2) {
+        CHECK(dict.erase(key(i)));
+    }
+    CHECK(not dict.erase(key(0)));
+    CHECK(dict.size() == 5000);
+    CHECK(not dict.contains(key(4)) && dict.contains(key(5)));
+    // Erased keys can be bound again.
+    for (auto i = int_t(0); i < 10000; i += 2) {
+        CHECK(dict.try_emplace(key(i), key(-i)).second);
+    }
+    CHECK(dict.size() == 10000);
+    CHECK(*dict.find(key(4)) == key(-4) && *dict.find(key(5)) == key(25));
+
+    // Chans all hash alike, so 28 of them fill the group of 16 slots they start probing at, and spill
+    // over into the other group. Erasing those in the full group leaves tombstones, so that the 12 left
+    // leave no room to grow into, and inserting again rehashes in place. Which group comes first in
+    // slot order depends on the hash, so both halves are tried.
+    for (auto from_front : { false, true }) {
+        auto chans = dict_t();
+        for (auto i = int_t(0); i < 28; ++i) {
+            chans.try_emplace(entity_t(types::chan_t(1)), key(i));
+        }
+        auto slot_order = std::vector<entity_t>();
+        for (auto const& [chan, value] : chans) {
+            slot_order.push_back(chan);
+        }
+        auto erased = from_front ? std::span(slot_order).first(16) : std::span(slot_order).last(16);
+        for (auto const& chan : erased) {
+            CHECK(chans.erase(chan));
+        }
+        for (auto i = int_t(100); i < 120; ++i) {
+            chans.try_emplace(key(i), key(i));
+        }
+        CHECK(chans.size() == 32);
+        CHECK(stdr::none_of(erased, [&chans](entity_t const& chan) { return chans.contains(chan); }));
+        auto kept = from_front ? std::span(slot_order).subspan(16) : std::span(slot_order).first(12);
+        CHECK(stdr::all_of(kept, [&chans](entity_t const& chan) { return chans.contains(chan); }));
+        CHECK(stdr::all_of(stdv::iota(100, 120), [&chans](int_t i) { return chans.contains(key(i)); }));
+    }
+
+    // A working set that keeps being erased and replaced, through resizes and tombstones, never loses or
+    // revives a key. Checked against a std::unordered_map.
+    auto churn = dict_t();
+    auto model = std::unordered_map<int_t, int_t>();
+    auto random = std::mt19937_64(33);
+    auto consistent = true;
+    for (auto round = 0; round < 200000; ++round) {
+        auto k = int_t(random() % 1600);
+        switch (random() % 4) {
+        case 0:
+        case 1:
+            consistent &= churn.erase(key(k)) == (model.erase(k) == 1);
+            break;
+        case 2:
+            consistent &= churn.insert_or_assign(key(k), key(round)) == not model.contains(k);
+            model[k] = round;
+            break;
+        default:
+            consistent &= churn.try_emplace(key(k), key(round)).second == model.try_emplace(k, round).second;
+            break;
+        }
+        if (round % 20000 == 0) {
+            consistent &= matches(churn, model);
+        }
+    }
+    CHECK(consistent);
+    CHECK(matches(churn, model));
+    auto copy = churn;
+    CHECK(copy == churn);
+    CHECK(matches(copy, model));
+
+    // Keys that compare equal are the same key, whatever their type: 1 and 1.0, or 2 ^ 70 and 2.0 ^ 70.
+    auto mixed = dict_t();
+    CHECK(mixed.try_emplace(key(1), entity_t("int")).second);
+    CHECK(not mixed.try_emplace(entity_t(real_t(1.0)), entity_t("real")).second);
+    CHECK(*mixed.find(entity_t(real_t(1.0))) == entity_t("int"));
+    CHECK(not mixed.insert_or_assign(entity_t(real_t(1.0)), entity_t("real")));
+    CHECK(mixed.size() == 1 && *mixed.find(key(1)) == entity_t("real"));
+    CHECK(not mixed.contains(entity_t(real_t(1.5))));
+    CHECK(not mixed.contains(entity_t("1")));
+    CHECK(mixed.erase(entity_t(real_t(1.0))));
+    CHECK(mixed.empty() && not mixed.contains(key(1)));
+    auto const big = test::eval("2 ^ 70");
+    CHECK(mixed.try_emplace(big, key(70)).second);
+    CHECK(mixed.contains(entity_t(std::ldexp(real_t(1), 70))));
+    CHECK(not mixed.try_emplace(test::eval("2.0 ^ 70"), key(0)).second);
+    for (auto i = int_t(0); i < 1000; ++i) {
+        mixed.try_emplace(key(i), key(i));
+    }
+    auto equivalent = 0;
+    for (auto i = int_t(0); i < 1000; ++i) {
+        auto const* value = mixed.find(entity_t(real_t(i)));
+        equivalent += value && *value == key(i);
+    }
+    CHECK(equivalent == 1000);
+    CHECK(mixed.size() == 1001);
+
+    return test::result();
+}
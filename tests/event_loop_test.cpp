@@ -0,0 +1,71 @@
+#include "check.hpp"
+#include "../include/event_loop.hpp"
+
+#include <signal.h>
+
+using namespace ysh;
+
+/**
+ * @brief What a child exec'ing @param program writes to stderr, and its exit code.
+ */
+static std::pair<std::string, int> exec_failure(char const* program) {
+    int fds[2];
+    ::pipe(fds);
+    auto pid = ::fork();
+    if (pid == 0) {
+        ::dup2(fds[1], STDERR_FILENO);
+        auto argv = std::array<char*, 2> { const_cast<char*>(program), nullptr };
+        exec_child(argv.data(), "Error: ");
+    }
+    ::close(fds[1]);
+    auto result = std::string();
+    auto buffer = std::array<char, 256>();
+    for (auto count = ssize_t(); (count = ::read(fds[0], buffer.data(), buffer.size())) > 0;) {
+        result.append(buffer.data(), std::size_t(count));
+    }
+    ::close(fds[0]);
+    return { result, wait_child(pid) };
+}
+
+int main() {
+    // An interrupt sent to the shell while it waits for a child doesn't take it down, even with another
+    // thread of its own alive to take it: here, that of a Future.
+    auto release = std::atomic<bool>();
+    auto idle = types::future_t([&release] {
+        release.wait(false);
+        return entity_t(types::int_t(0));
+    });
+    auto pid = ::fork();
+    if (pid == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        ::kill(::getppid(), SIGINT);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::_Exit(3);
+    }
+    CHECK(wait_child(pid) == 3);
+    release = true;
+    release.notify_all();
+    CHECK(idle.get() == entity_t(types::int_t(0)));
+
+    // Neither does writing to a child that exited, from a thread of the shell.
+    int fds[2];
+    ::pipe(fds);
+    ::close(fds[0]);
+    auto written = types::future_t([fd = fds[1]] {
+        return entity_t(types::int_t(::write(fd, "x", 1) < 0 && errno == EPIPE));
+    });
+    CHECK(written.get() == entity_t(types::int_t(1)));
+    ::close(fds[1]);
+
+    // The processes those threads start block nothing, and die of SIGPIPE as they would anywhere else.
+    auto status = test::run("async job { grep SigBlk /proc/self/status }\nawait job\n");
+    CHECK(status.find("SigBlk:\t0000000000000000") != std::string::npos);
+    auto piped = test::run("async job { yes | head -n 2 }\nawait job\n");
+    CHECK(piped.find("y\ny") != std::string::npos);
+
+    // A program that can't be run is reported without anything that could deadlock after a fork.
+    CHECK(exec_failure("/nonexistent/program") == std::pair { std::string("Error: No such file or directory\n"), 127 });
+    CHECK(exec_failure("/etc/passwd/program") == std::pair { "Error: exec failed with errno " + std::to_string(ENOTDIR) + "\n", 127 });
+
+    return test::result();
+}
@@ -0,0 +1,105 @@
+#include "check.hpp"
+#include "../include/expression.hpp"
+
+using namespace ysh;
+
+/**
+ * @brief The opcodes of @param expr once compiled, and so optimized.
+ */
+static std::vector<opcode_t> opcodes(std::string_view expr) {
+    auto result = std::vector<opcode_t>();
+    for (auto const& inst : compile(input_t(expr)).code) {
+        result.push_back(inst.opcode);
+    }
+    return result;
+}
+
+int main() {
+    // Constants are folded.
+    CHECK(opcodes("60 * 60 * 24") == std::vector { YSH_PUSH });
+    CHECK(test::eval("60 * 60 * 24") == entity_t(86400));
+    CHECK(opcodes("(1 + 2) ; 3") == std::vector { YSH_PUSH });
+
+    // The identities of arithmetic aren't applied to variables, which may hold anything.
+    CHECK(opcodes("x + 0") == std::vector { YSH_LOAD, YSH_PUSH, YSH_APPLY });
+    CHECK(opcodes("x * 1") == std::vector { YSH_LOAD, YSH_PUSH, YSH_APPLY });
+    CHECK(opcodes("x / 4.0") == std::vector { YSH_LOAD, YSH_PUSH, YSH_APPLY });
+    CHECK(opcodes("(x < y) + 0.0") == std::vector { YSH_LOAD, YSH_LOAD, YSH_APPLY, YSH_PUSH, YSH_APPLY });
+
+    // They are where the operands are known to be numbers, e.g. the results of comparisons, so the
+    // programs get shorter.
+    CHECK(opcodes("(x < y) * 1") == std::vector { YSH_LOAD, YSH_LOAD, YSH_APPLY });
+    CHECK(opcodes("1 * (x = y)") == std::vector { YSH_LOAD, YSH_LOAD, YSH_APPLY });
+    CHECK(opcodes("((x < y) + 0.5 * 2) - 0") == std::vector { YSH_LOAD, YSH_LOAD, YSH_APPLY, YSH_PUSH, YSH_APPLY });
+    CHECK(opcodes("0 + (x >= y) / 1") == std::vector { YSH_LOAD, YSH_LOAD, YSH_APPLY });
+
+    // Squaring is an instruction of its own, whatever is squared.
+    CHECK(opcodes("x ^ 2") == std::vector { YSH_LOAD, YSH_SQUARE });
+    CHECK(opcodes("(x + y) ^ 2") == std::vector { YSH_LOAD, YSH_LOAD, YSH_APPLY, YSH_SQUARE });
+    CHECK(test::eval("\"str\" + 0").kind() == entity_t::ERROR);
+    CHECK(test::eval("\"str\" - 0").kind() == entity_t::ERROR);
+    CHECK(test::eval("\"str\" ^ 1").kind() == entity_t::ERROR);
+
+    auto& variables = interpreter::current().variables;
+    assign(variables, "s", entity_t("str"));
+    assign(variables, "n", entity_t(5));
+    CHECK(test::eval("s + 0").kind() == entity_t::ERROR);
+    CHECK(test::eval("s / 1").kind() == entity_t::ERROR);
+    CHECK(test::eval("n + 0") == entity_t(5));
+    CHECK(test::eval("n ^ 2") == entity_t(25));
+    CHECK(test::eval("n / 4.0") == entity_t(types::real_t(1.25)));
+    CHECK(test::eval("(n < 6) * 1") == entity_t(1));
+    CHECK(test::eval("s ^ 2").kind() == entity_t::ERROR);
+    assign(variables, "r", entity_t(types::real_t(1.5)));
+    CHECK(test::eval("r ^ 2") == entity_t(types::real_t(2.25)));
+    assign(variables, "big", entity_t(types::int_t(1) << 40));
+    CHECK(test::eval("big ^ 2") == test::eval("big * big"));
+    CHECK(test::eval("big ^ 2").kind() == entity_t::BIGINT);
+    assign(variables, "xs", entity_t(types::list_t { entity_t(2), entity_t(types::real_t(0.5)) }));
+    CHECK(test::eval("xs ^ 2") == entity_t(types::list_t { entity_t(4), entity_t(types::real_t(0.25)) }));
+
+    // Anything else is squared as ^ would, failing the same way: a bigint too large to square, and
+    // a value of a kind ^ doesn't take.
+    auto const error = [](std::string const& expr) {
+        auto value = test::eval(expr);
+        return value.kind() == entity_t::ERROR ? value.get<types::error_t>().msg : std::string();
+    };
+    assign(variables, "two", entity_t(2));
+    assign(variables, "huge", test::eval("3 ^ 331000"));
+    CHECK(test::eval("huge").kind() == entity_t::BIGINT);
+    CHECK(error("huge ^ 2") == "Integer overflow.");
+    CHECK(error("huge ^ two") == "Integer overflow.");
+    CHECK(not error("s ^ 2").empty());
+    CHECK(error("s ^ 2") == error("s ^ two"));
+    CHECK(error("s ^ 2").find("(^)") != std::string::npos);
+    assign(variables, "pair", test::eval("1, 2"));
+    CHECK(test::eval("pair").kind() == entity_t::TUPLE);
+    CHECK(not error("pair ^ 2").empty());
+    CHECK(error("pair ^ 2") == error("pair ^ two"));
+
+    // The left-hand side of ; is dropped as long as computing it can't throw.
+    CHECK(opcodes("n ; 3") == std::vector { YSH_PUSH });
+    CHECK(opcodes("(s - 1) ; 3") == std::vector { YSH_LOAD, YSH_PUSH, YSH_APPLY, YSH_PUSH, YSH_APPLY });
+    CHECK(test::eval("n ; 3") == entity_t(3));
+
+    // An expression stays in the cache while it's evaluated, however many others it evaluates.
+    auto& cache = expression_cache::local();
+    auto const* outer = &cache.compile(input_t("n * 2"));
+    {
+        auto pinned = expression_cache::pin(cache);
+        for (auto i = 0; i < 10000; ++i) {
+            cache.compile(input_t(std::string_view("n + " + std::to_string(i))));
+        }
+        CHECK(&cache.compile(input_t("n * 2")) == outer);
+    }
+    auto evaluated = 0;
+    assign(variables, "many", entity_t(types::func_t([&evaluated](entity_t x) {
+        for (auto i = 0; i < 10000; ++i) {
+            evaluated += int(types::int_t(test::eval("n + " + std::to_string(i))) == 5 + i);
+        }
+        return x;
+    })));
+    CHECK(test::eval("(many $ n) * 2 + (many $ 1)") == entity_t(11));
+    CHECK(evaluated == 20000);
+    return test::result();
+}
@@ -0,0 +1,74 @@
+#include "check.hpp"
+#include "../include/builtins.hpp"
+#include "../include/ffi.hpp"
+
+using namespace ysh;
+using types::func_t;
+using types::int_t;
+using types::list_t;
+using types::real_t;
+using types::str_t;
+
+/**
+ * @brief Call the Func @param func with @param args, as a Tuple if there are several.
+ */
+static entity_t call(entity_t const& func, auto... args) {
+    if (func.kind() != entity_t::FUNC) {
+        return func;
+    }
+    if constexpr (sizeof...(args) == 1) {
+        return func.get<func_t>()(entity_t(args)...);
+    }
+    else {
+        auto list = list_t { entity_t(args)... };
+        return func.get<func_t>()(entity_t(types::tuple_t(list.begin(), list.end())));
+    }
+}
+
+/**
+ * @brief Bind @param symbol of @param library through the ffi built-in.
+ */
+static entity_t ffi(std::string library, std::string symbol, std::string signature) {
+    return call(builtins().at("ffi").value, str_t(std::move(library)), str_t(std::move(symbol)), str_t(std::move(signature)));
+}
+
+/**
+ * @brief Whether @param result is an Error whose message starts with @param prefix.
+ */
+static bool fails_with(entity_t const& result, std::string_view prefix) {
+    return result.kind() == entity_t::ERROR && result.get<types::error_t>().msg.starts_with(prefix);
+}
+
+int main() {
+    // Doubles go in and come back as Reals, from Ints too.
+    auto pow = ffi("libm.so.6", "pow", "d(dd)");
+    CHECK(pow.kind() == entity_t::FUNC);
+    CHECK(call(pow, 2.0, 10.0) == entity_t(real_t(1024.0)));
+    CHECK(call(pow, int_t(3), int_t(2)) == entity_t(real_t(9.0)));
+
+    // An int result is only the low half of the register, a long result all of it.
+    auto abs = ffi("libc.so.6", "abs", "i(i)");
+    CHECK(call(abs, int_t(-5)) == entity_t(5));
+    CHECK(call(abs, int_t(-5)).kind() == entity_t::INT);
+    auto labs = ffi("libc.so.6", "labs", "l(l)");
+    CHECK(call(labs, int_t(-1) << 40) == entity_t(int_t(1) << 40));
+
+    // Integer and double parameters are assigned registers of their own, whatever their order.
+    auto ldexp = ffi("libm.so.6", "ldexp", "d(di)");
+    CHECK(call(ldexp, 0.75, int_t(4)) == entity_t(real_t(12.0)));
+    auto strlen = ffi("libc.so.6", "strlen", "l(s)");
+    CHECK(call(strlen, str_t(std::string("hello"))) == entity_t(5));
+
+    // Arguments of the wrong kind or number are Errors.
+    CHECK(fails_with(call(abs, str_t(std::string("5"))), "Expected an Int for parameter 1"));
+    CHECK(fails_with(call(abs, int_t(1) << 40), "Expected an Int for parameter 1"));
+    CHECK(fails_with(call(pow, 1.0, 2.0, 3.0), "Expected a tuple of 2 arguments"));
+
+    // So are unknown libraries and symbols, and signatures that don't fit the registers.
+    CHECK(fails_with(ffi("libm.so.6", "no_such_function", "d(d)"), "Symbol not found: no_such_function"));
+    CHECK(fails_with(ffi("libno-such-library.so", "pow", "d(dd)"), "Failed to load library"));
+    CHECK(fails_with(ffi("libc.so.6", "abs", "i(iiiiiii)"), "Too many parameters"));
+    CHECK(fails_with(ffi("libm.so.6", "pow", "d(ddddddddd)"), "Too many parameters"));
+    CHECK(fails_with(ffi("libm.so.6", "pow", "f(dd)"), "Malformed signature"));
+    return test::result();
+}
@@ -0,0 +1,60 @@
+#include "check.hpp"
+#include "../include/io_ring.hpp"
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+using namespace ysh;
+
+static std::string read_stream(stdf::path const& path) {
+    auto file = std::ifstream(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+int main() {
+    auto& ring = io_ring::local();
+    std::cerr << (ring.is_uring() ? "reading through io_uring\n" : "reading with plain system calls\n");
+    auto dir = test::scratch_dir();
+
+    // Files larger than a buffer, empty ones and missing ones, in batches of several rings' worth.
+    auto paths = std::vector<std::string>();
+    auto contents = std::vector<std::string>();
+    for (auto i = 0uz; i < k_ring_files * 2 + 3; ++i) {
+        paths.push_back((dir.path() / ("file" + std::to_string(i))).string());
+        contents.push_back(std::string(i * k_ring_buffer_size / 16, char('a' + i % 26)));
+    }
+    auto views = std::vector<std::string_view>(contents.begin(), contents.end());
+    auto written = ring.write(paths, views);
+    CHECK(stdr::all_of(written, [](int error) { return error == 0; }));
+    paths.push_back((dir.path() / "missing").string());
+    auto read = ring.read(paths);
+    CHECK(read.size() == paths.size());
+    for (auto i = 0uz; i < contents.size(); ++i) {
+        CHECK(read[i].error == 0 && read[i].data == contents[i]);
+    }
+    CHECK(read.back().error == ENOENT && read.back().data.empty());
+
+    // A file of /proc comes a page at a time, so its reads are short long before its end.
+    auto const maps = std::vector<std::string> { "/proc/self/smaps" };
+    auto smaps = ring.read(maps).front();
+    CHECK(smaps.error == 0);
+    CHECK(smaps.data.size() > 4096 && smaps.data.ends_with('\n'));
+    CHECK(smaps.data.size() > read_stream(maps.front()).size() / 2);
+
+    // A FIFO can't seek, and its writer sends it in pieces.
+    auto fifo = (dir.path() / "fifo").string();
+    ::mkfifo(fifo.c_str(), 0600);
+    auto pid = ::fork();
+    if (pid == 0) {
+        auto fd = ::open(fifo.c_str(), O_WRONLY);
+        for (auto piece : { "one\n", "two\n", "three\n" }) {
+            ::write(fd, piece, std::strlen(piece));
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        std::_Exit(0);
+    }
+    auto piped = ring.read(std::vector { fifo }).front();
+    ::waitpid(pid, nullptr, 0);
+    CHECK(piped.error == 0 && piped.data == "one\ntwo\nthree\n");
+    return test::result();
+}
@@ -0,0 +1,60 @@
+#include "check.hpp"
+#include "../include/libysh.hpp"
+
+using namespace ysh;
+
+/**
+ * @brief What converting the value of @param expr to @tparam T throws, or "" if it converts.
+ */
+template<typename T>
+static std::string conversion_error(embedded_interpreter& ysh, std::string const& expr) {
+    try {
+        ysh.evaluate<T>(expr);
+        return "";
+    }
+    catch (types::error_t const& e) {
+        return e.what();
+    }
+}
+
+int main() {
+    auto ysh = embedded_interpreter();
+
+    // Strings go both ways, as copies or as views into the Str for the length of the call.
+    ysh.define("shout", [](std::string s) { return s + "!"; });
+    ysh.define("length", [](std::string_view s) { return s.size(); });
+    ysh.define("first", [](char const* s) { return std::string(1, s[0]); });
+    ysh.define("joined", [](std::vector<std::string_view> const& parts) {
+        auto result = std::string();
+        for (auto part : parts) {
+            result += part;
+        }
+        return result;
+    });
+    ysh.define("starts", [](std::string_view s, std::string_view prefix) { return s.starts_with(prefix); });
+    CHECK(ysh.evaluate<std::string>("shout $ \"hey\"") == "hey!");
+    CHECK(ysh.evaluate<int>("length $ \"hello\"") == 5);
+    CHECK(ysh.evaluate<std::string>("first $ \"ysh\"") == "y");
+    ysh.set("parts", std::vector<std::string> { "a", "b", "c" });
+    CHECK(ysh.evaluate<std::string>("joined $ parts") == "abc");
+    CHECK(ysh.evaluate<bool>("starts $ (\"yellow\", \"ye\")"));
+
+    // Concatenated Strs are laid out once for the view.
+    ysh.set("long", std::string(types::str_t::k_chunk_size, 'x'));
+    CHECK(ysh.evaluate<int>("length $ (long + long)") == 2 * int(types::str_t::k_chunk_size));
+
+    // An argument of another kind is an Error, not a crash.
+    CHECK(ysh.evaluate("length $ 3").kind() == entity_t::ERROR);
+
+    // An Int that doesn't fit the native type says so, whether it's held as an int_t or a bigint_t.
+    CHECK(conversion_error<int>(ysh, "2 ^ 40").starts_with("Int out of range for int32"));
+    CHECK(conversion_error<std::int64_t>(ysh, "2 ^ 100").starts_with("Int out of range for int64"));
+    CHECK(conversion_error<unsigned>(ysh, "0 - 1").starts_with("Int out of range for uint32"));
+    CHECK(conversion_error<std::int64_t>(ysh, "2 ^ 62").empty());
+
+    // Other values round-trip.
+    ysh.define("scale", [](double x) { return x * 2.5; });
+    ysh.set("xs", std::vector { 1, 2, 3 });
+    CHECK(ysh.evaluate<double>("sum $ (map $ (scale, xs))") == 15.0);
+    return test::result();
+}
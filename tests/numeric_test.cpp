@@ -0,0 +1,98 @@
+#include "check.hpp"
+#include "../include/numeric.hpp"
+
+using namespace ysh;
+using types::bigint_t;
+using types::int_t;
+using types::real_t;
+
+/**
+ * @brief Whether parsing @param text is refused, as a grammar error.
+ */
+static bool malformed(std::string_view text) {
+    try {
+        parse_number(text);
+        return false;
+    }
+    catch (types::error_t const&) {
+        return true;
+    }
+}
+
+/**
+ * @brief Whether @param value formats to text that parses back to it, bit for bit.
+ */
+static bool round_trips(real_t value) {
+    auto parsed = parse_number(format_real(value));
+    return parsed.kind() == entity_t::REAL && std::signbit(real_t(parsed)) == std::signbit(value) &&
+           (real_t(parsed) == value || (std::isnan(real_t(parsed)) && std::isnan(value)));
+}
+
+int main() {
+    // Integers in every base, with separators between digits, and signs.
+    CHECK(parse_number("42") == entity_t(42));
+    CHECK(parse_number("1_000_000") == entity_t(1000000));
+    CHECK(parse_number("0x7fff_ffff") == entity_t(0x7fffffff));
+    CHECK(parse_number("0X1F") == entity_t(31));
+    CHECK(parse_number("0b1010") == entity_t(10));
+    CHECK(parse_number("0o755") == entity_t(0755));
+    CHECK(parse_number("-5") == entity_t(-5));
+    CHECK(parse_number("+7") == entity_t(7));
+
+    // Reals, with fractions or exponents.
+    CHECK(parse_number("3.14") == entity_t(real_t(3.14L)));
+    CHECK(parse_number("1.5e+3") == entity_t(real_t(1500)));
+    CHECK(parse_number("6.02e23") == entity_t(real_t(6.02e23L)));
+    CHECK(parse_number("1e-9") == entity_t(real_t(1e-9L)));
+    CHECK(parse_number("1_0.5") == entity_t(real_t(10.5)));
+    CHECK(parse_number("1e3").kind() == entity_t::REAL);
+
+    // Underscores only separate digits, and every part has some.
+    for (auto text : { "0x_1", "1__0", "1_", "_1", "1e", "1e+", "0x", "0b", "1.", "1.e3", "0b102", "0o8", "1x" }) {
+        CHECK(malformed(text));
+    }
+
+    // Integers that don't fit in an Int are promoted, from the first one past the limit.
+    CHECK(parse_number("9223372036854775807") == entity_t(std::numeric_limits<int_t>::max()));
+    CHECK(parse_number("9223372036854775807").kind() == entity_t::INT);
+    CHECK(parse_number("9223372036854775808").kind() == entity_t::BIGINT);
+    CHECK(parse_number("9223372036854775808").get<bigint_t>().to_string() == "9223372036854775808");
+    CHECK(parse_number("-9223372036854775808") == entity_t(std::numeric_limits<int_t>::min()));
+    CHECK(parse_number("-9223372036854775808").kind() == entity_t::INT);
+    CHECK(parse_number("-9223372036854775809").kind() == entity_t::BIGINT);
+    CHECK(parse_number("0x1_0000_0000_0000_0000").get<bigint_t>().to_string() == "18446744073709551616");
+
+    // The literal is measured up to the first character that can't be part of a number, so that one
+    // running into a name is refused whole.
+    CHECK(number_length("12+3") == 2);
+    CHECK(number_length("0x1f+2") == 4);
+    CHECK(number_length("1.5e3)") == 5);
+    CHECK(number_length("12abc") == 5);
+    CHECK(malformed("12abc"));
+
+    // Reals are formatted as the shortest text that reads back as the same Real.
+    CHECK(format_real(2) == "2.0");
+    CHECK(format_real(0.1L) == "0.1");
+    CHECK(format_real(1500) == "1500.0");
+    CHECK(format_real(-0.0L) == "-0.0");
+    CHECK(format_real(1e300L) == "1e+300");
+    CHECK(parse_number("1e-99999") == entity_t(real_t(0)));
+    CHECK(parse_number("1e99999") == entity_t(std::numeric_limits<real_t>::infinity()));
+    for (auto value : { real_t(0.1L), real_t(1) / 3, real_t(2) / 3, real_t(123456.789L), real_t(5e-324L), real_t(-0.0L),
+                        std::numeric_limits<real_t>::max(), std::numeric_limits<real_t>::min(),
+                        std::numeric_limits<real_t>::denorm_min(), std::numeric_limits<real_t>::epsilon() }) {
+        CHECK(round_trips(value));
+    }
+    auto random = std::mt19937_64(42);
+    auto exponent = std::uniform_int_distribution(-4000, 4000);
+    auto mantissa = std::uniform_real_distribution<real_t>(1, 10);
+    auto failed = 0;
+    for (auto i = 0; i < 10000; ++i) {
+        failed += not round_trips(std::ldexp(mantissa(random), exponent(random)));
+    }
+    CHECK(failed == 0);
+
+    CHECK(format_int(0) == "0");
+    CHECK(format_int(std::numeric_limits<int_t>::min()) == "-9223372036854775808");
+    return test::result();
+}
@@ -0,0 +1,158 @@
+#include "check.hpp"
+#include "../include/pipeline.hpp"
+
+using namespace ysh;
+
+/**
+ * @brief A command printing its arguments, one per line.
+ */
+static int words_main(std::vector<input_t> const& args) {
+    for (auto arg : args) {
+        local_stdout() << arg << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief A command writing the number of values coming in.
+ */
+static int count_main(std::vector<input_t> const&) {
+    local_output().write(entity_t(types::int_t(local_input().drain().size())));
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief A command writing the first two values coming in, and reading no more.
+ */
+static int firsts_main(std::vector<input_t> const&) {
+    for (auto i = 0; i < 2; ++i) {
+        if (auto value = local_input().read()) {
+            local_output().write(std::move(*value));
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// How many values forever wrote, the last time it ran.
+static auto forever_written = std::atomic<types::int_t>();
+
+/**
+ * @brief A command writing the Ints from 0 on, for as long as the next stage reads them.
+ */
+static int forever_main(std::vector<input_t> const&) {
+    auto i = types::int_t(0);
+    while (local_output().write(entity_t(i))) {
+        ++i;
+    }
+    forever_written = i;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run @param line on the current thread, with the values out of it rendered to the returned text.
+ */
+static std::string run_here(std::string const& line) {
+    auto os = std::ostringstream();
+    execute(tokenize(input_t(std::string_view(line))), os);
+    return std::move(os).str();
+}
+
+int main() {
+    // Parenthesized arguments are evaluated, quoted ones are passed as they are.
+    CHECK(test::run("echo (1 + 2 * 3)\n") == "7\n");
+    CHECK(test::run("echo \"(1 + 2)\" '(3)'\n") == "(1 + 2) (3)\n");
+    CHECK(test::run("echo a (2 * 3) b\n") == "a 6 b\n");
+    // A command whose argument is an Error isn't run.
+    CHECK(test::run("echo (1 / 0)\n").empty());
+
+    // A Func stage with arguments is applied to a Tuple of them and of its input.
+    CHECK(test::run("seq 1 9 | take 2\n") == "1\n2\n");
+    CHECK(test::run("seq 1 9 | take (1 + 2)\n") == "1\n2\n3\n");
+
+    // What an in-process command prints is passed on, whether the stages run one after the other or side
+    // by side, and pipelines running on several threads at once each get their own.
+    interpreter::current().command_map.emplace("words", words_main);
+    interpreter::current().command_map.emplace("count", count_main);
+    interpreter::current().command_map.emplace("firsts", firsts_main);
+    interpreter::current().command_map.emplace("forever", forever_main);
+    for (auto side_by_side : { false, true }) {
+        g_side_by_side = side_by_side;
+        CHECK(run_here("words a b c | take 2") == "a\nb\n");
+        CHECK(run_here("words a b c | count") == "3\n");
+        CHECK(run_here("words a b | count | take 1") == "2\n");
+        CHECK(run_here("words a b c | count | words z") == "z\n");
+        CHECK(run_here("seq 1 5 | count") == "5\n");
+
+        // What an external command prints is read as it's printed, so a producer that never ends is
+        // stopped by SIGPIPE once the stages after it read no more.
+        CHECK(run_here("yes | take (3)") == "y\ny\ny\n");
+        CHECK(run_here("yes | cat | take 2") == "y\ny\n");
+        CHECK(run_here("yes | firsts") == "y\ny\n");
+        CHECK(run_here("yes | take 2 | firsts | count") == "2\n");
+        if (side_by_side) {
+            // And the other way around: values are rendered into an external stage as they're written.
+            CHECK(test::capture([] { run_here("forever | head -n 2"); }) == "0\n1\n");
+            CHECK(run_here("forever | head -n 3 | take 5") == "0\n1\n2\n");
+
+            // A Func stage reading from a command holds it back to what its channel has room for, and
+            // once it reads no more, the command's writes fail.
+            CHECK(run_here("forever | take 3") == "0\n1\n2\n");
+            CHECK(forever_written >= 3 && forever_written <= 1024 + 3);
+        }
+        auto mixed = std::atomic<int>();
+        auto threads = std::vector<std::thread>();
+        for (auto i = 0; i < 4; ++i) {
+            threads.emplace_back([&mixed, i] {
+                auto word = std::string(1, char('p' + i));
+                for (auto round = 0; round < 100; ++round) {
+                    if (run_here("words " + word + " x | take 1") != word + "\n") {
+                        ++mixed;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(mixed == 0);
+    }
+
+    // Adjacent Func stages run as one loop on the current thread, even side by side: each value goes
+    // through all of them before the next is generated, and only the command before them gets a thread.
+    // Threads joined before may take a moment to leave /proc, so the count is only bounded.
+    auto tasks = [] {
+        return std::distance(stdf::directory_iterator("/proc/self/task"), stdf::directory_iterator());
+    };
+    auto calls = std::string();
+    auto most = 0z;
+    auto elsewhere = false;
+    auto const here = std::this_thread::get_id();
+    auto note = [&](char name) {
+        return types::func_t([&, name](entity_t x) {
+            calls += name;
+            most = std::max(most, tasks());
+            elsewhere |= std::this_thread::get_id() != here;
+            return x;
+        });
+    };
+    assign(interpreter::current().variables, "f", entity_t(note('f')));
+    assign(interpreter::current().variables, "g", entity_t(note('g')));
+    auto const before = tasks();
+    CHECK(run_here("words a b c d e | map (f) | filter (g) | take 3") == "a\nb\nc\n");
+    CHECK(calls == "fgfgfg");
+    CHECK(most <= before + 1);
+    CHECK(not elsewhere);
+
+    // The values out of the last stage are rendered as they come: each is out before the next is made.
+    auto os = std::ostringstream();
+    auto rendered = std::string();
+    assign(interpreter::current().variables, "seen", entity_t(types::func_t([&os, &rendered](entity_t x) {
+        rendered += std::to_string(stdr::count(os.view(), '\n'));
+        return x;
+    })));
+    execute(tokenize(input_t(std::string_view("yes | map (seen) | take 3"))), os);
+    CHECK(os.view() == "y\ny\ny\n");
+    CHECK(rendered == "012");
+
+    return test::result();
+}
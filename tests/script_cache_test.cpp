@@ -0,0 +1,36 @@
+#include "check.hpp"
+#include "../include/script_cache.hpp"
+
+using namespace ysh;
+
+int main() {
+    auto dir = test::scratch_dir();
+    auto path = dir.write("lines.ysh", "echo one\necho (1 + \necho two\necho (40 + 2)\n");
+
+    // A line that can't be tokenized is reported when it's reached, and the others still run, from
+    // the compiled form and from the cache alike.
+    auto script = load_script(path);
+    CHECK(not script->cached());
+    CHECK(script->size() == 4);
+    CHECK(test::capture([&] { shell(*script, std::cout); }) == "one\ntwo\n42\n");
+    script = load_script(path);
+    CHECK(script->cached());
+    CHECK(test::capture([&] { shell(*script, std::cout); }) == "one\ntwo\n42\n");
+    CHECK(stdf::exists(compiled_script::cache_path(path)));
+
+    // The expressions the script primed the cache with outlive it.
+    script.reset();
+    CHECK(test::run("echo (40 + 2)\n") == "42\n");
+    CHECK(test::eval("40 + 2") == entity_t(42));
+
+    // A changed script is compiled again.
+    dir.write("lines.ysh", "echo (6 * 7) three\n");
+    script = load_script(path);
+    CHECK(not script->cached());
+    CHECK(test::capture([&] { shell(*script, std::cout); }) == "42 three\n");
+
+    // Continued lines are joined before they're tokenized.
+    path = dir.write("continued.ysh", "echo a \\\nb\n");
+    CHECK(test::capture([&] { shell(*load_script(path), std::cout); }) == "a b\n");
+    return test::result();
+}
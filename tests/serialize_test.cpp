@@ -0,0 +1,139 @@
+#include "check.hpp"
+#include "../include/serialize.hpp"
+
+using namespace ysh;
+using types::bigint_t;
+using types::dict_t;
+using types::int_t;
+using types::list_t;
+using types::real_t;
+using types::str_t;
+using types::tuple_t;
+
+/**
+ * @brief Whether @param value decodes from its encoding as an equal value of the same kind.
+ */
+static bool round_trips(entity_t const& value) {
+    auto decoded = decode(encode(value));
+    if (decoded.kind() != value.kind()) {
+        return false;
+    }
+    if (value.kind() == entity_t::ERROR) {
+        return decoded.get<types::error_t>().msg == value.get<types::error_t>().msg;
+    }
+    return decoded.equivalent(value);
+}
+
+/**
+ * @brief Whether decoding @param data is refused as corrupt.
+ */
+static bool corrupt(std::string_view data) {
+    try {
+        std::ignore = decode(data);
+        return false;
+    }
+    catch (types::error_t const& error) {
+        return error.msg.starts_with("Corrupt binary data");
+    }
+}
+
+/**
+ * @brief Overwrite the bytes of @param value at @param offset of @param data.
+ */
+template<typename T>
+static void patch(std::string& data, std::size_t offset, T const& value) {
+    std::memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+int main() {
+    // Every kind that can be encoded round-trips, and Lists of one kind of number become arrays.
+    auto big = bigint_t::parse("-123456789012345678901234567890123456789");
+    auto dict = dict_t();
+    dict.insert_or_assign(entity_t("one"), entity_t(1));
+    dict.insert_or_assign(entity_t(2), entity_t(list_t { entity_t("two") }));
+    auto tuple = list_t { entity_t(1), entity_t("a"), entity_t(real_t(0.5L)) };
+    auto ints = list_t { entity_t(1), entity_t(-2), entity_t(std::numeric_limits<int_t>::max()) };
+    auto reals = list_t { entity_t(real_t(0.1L)), entity_t(-real_t(0)), entity_t(std::numeric_limits<real_t>::max()) };
+    for (auto const& value : { entity_t(42), entity_t(std::numeric_limits<int_t>::min()), entity_t(real_t(1) / 3), entity_t(big),
+                               entity_t(""), entity_t(str_t(std::string("a\0b", 3))), entity_t(types::error_t("failed")), entity_t(list_t()),
+                               entity_t(list_t { entity_t(1), entity_t("mixed") }), entity_t(tuple_t(tuple.begin(), tuple.end())),
+                               entity_t(dict), entity_t(dict_t()), entity_t(ints), entity_t(reals) }) {
+        CHECK(round_trips(value));
+    }
+    CHECK(decode(encode(entity_t(big))).kind() == entity_t::BIGINT);
+    CHECK(record_view::root(encode(entity_t(big))).tag() == record_view::BIGINT);
+    CHECK(record_view::root(encode(entity_t(dict))).tag() == record_view::DICT);
+    CHECK(record_view::root(encode(entity_t(ints))).tag() == record_view::INT_ARRAY);
+    CHECK(record_view::root(encode(entity_t(reals))).tag() == record_view::REAL_ARRAY);
+    CHECK(not serializable(entity_t(types::func_t([](entity_t x) { return x; }))));
+
+    // Truncated buffers are refused wherever they're cut, and so are foreign headers.
+    auto nested = encode(entity_t(list_t { entity_t(big), entity_t(dict), entity_t(ints), entity_t(reals), entity_t("end") }));
+    auto cut = 0uz;
+    for (auto size = 0uz; size < nested.size(); ++size) {
+        cut += corrupt(std::string_view(nested).substr(0, size));
+    }
+    CHECK(cut == nested.size());
+    auto magic = nested;
+    magic[0] = 'X';
+    CHECK(corrupt(magic));
+    auto version = nested;
+    patch(version, 8, std::uint32_t(2));
+    CHECK(corrupt(version));
+
+    // A child offset at or before its parent is refused, so a corrupt table can't make a cycle.
+    auto strs = encode(entity_t(list_t { entity_t("a"), entity_t("b") }));
+    auto const table = 16uz + 16;
+    for (auto offset : { std::uint64_t(16), std::uint64_t(8), std::uint64_t(0) }) {
+        auto looped = strs;
+        patch(looped, table, offset);
+        CHECK(corrupt(looped));
+    }
+    auto wild = strs;
+    patch(wild, table, std::uint64_t(1) << 40);
+    CHECK(corrupt(wild));
+
+    // Records are read in place: a child is reached without decoding its siblings, even a broken one.
+    auto broken = strs;
+    auto second = std::uint64_t();
+    std::memcpy(&second, broken.data() + table + 8, sizeof(second));
+    patch(broken, second, std::uint32_t(99));
+    auto root = record_view::root(broken);
+    CHECK(root.size() == 2);
+    CHECK(root.child(0).as_str() == "a");
+    CHECK(root.child(0).as_str().data() >= broken.data() && root.child(0).as_str().data() < broken.data() + broken.size());
+    CHECK(root.at(0) == entity_t("a"));
+    CHECK(corrupt(broken));
+
+    // Arrays are used straight from the buffer, and Dicts are read a binding at a time.
+    auto mixed = encode(entity_t(list_t { entity_t(ints), entity_t(reals), entity_t(dict) }));
+    auto view = record_view::root(mixed);
+    auto ints_view = view.child(0).ints();
+    CHECK(ints_view.size() == 3 && ints_view[2] == std::numeric_limits<int_t>::max());
+    CHECK(reinterpret_cast<char const*>(ints_view.data()) > mixed.data());
+    CHECK(view.child(0).at(1) == entity_t(-2));
+    CHECK(view.child(1).reals()[0] == real_t(0.1L));
+    CHECK(view.child(1).at(2) == entity_t(std::numeric_limits<real_t>::max()));
+    CHECK(view.child(2).size() == 2);
+    CHECK(view.child(2).child(0).as_str() == "one");
+    CHECK(view.child(2).child(1).as_int() == 1);
+
+    // A saved file is mapped, and read in the same way.
+    auto dir = test::scratch_dir();
+    auto path = dir.path() / "value.bin";
+    CHECK(save(path, entity_t(list_t { entity_t(ints), entity_t("saved") })) > 0);
+    auto file = mapped_file(path);
+    auto saved = record_view::root(file.bytes());
+    CHECK(saved.child(0).ints()[1] == -2);
+    CHECK(saved.at(1) == entity_t("saved"));
+    CHECK(load(path).equivalent(entity_t(list_t { entity_t(ints), entity_t("saved") })));
+    dir.write("empty.bin", "");
+    try {
+        std::ignore = load(dir.path() / "empty.bin");
+        CHECK(false);
+    }
+    catch (types::error_t const& error) {
+        CHECK(error.msg.starts_with("Corrupt binary data"));
+    }
+    return test::result();
+}
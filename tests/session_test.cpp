@@ -0,0 +1,129 @@
+#include "check.hpp"
+#include "../include/expression.hpp"
+#include "../include/session.hpp"
+
+using namespace ysh;
+using types::func_t;
+
+/**
+ * @brief Whether saving the session throws, i.e. refuses to take a snapshot.
+ */
+static bool refused(stdf::path const& path, std::vector<stdf::path> const& sources) {
+    try {
+        save_session(path, sources);
+        return false;
+    }
+    catch (types::error_t const&) {
+        return true;
+    }
+}
+
+/**
+ * @brief Run ysh as @code ysh -s script @endcode would.
+ * @return std::string What it wrote to stdout.
+ */
+static std::string run_with_snapshot(stdf::path const& script) {
+    auto args = std::vector<std::string> { "ysh", "-s", script.string() };
+    auto argv = std::vector<char*>();
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    return test::capture([&argv] { ysh_main(int(argv.size()), argv.data()); });
+}
+
+int main() {
+    auto dir = test::scratch_dir();
+    auto const sources = std::vector { dir.write("init.ysh", "echo init\n") };
+    auto const snapshot = dir.path() / "init.snapshot";
+    auto& session = interpreter::current();
+
+    // Plain values round-trip.
+    assign(session.variables, "answer", entity_t(42));
+    assign(session.variables, "names", entity_t(types::list_t { entity_t("a"), entity_t("b") }));
+    CHECK(save_session(snapshot, sources) > 0);
+    session.variables.clear();
+    CHECK(restore_session(snapshot, sources));
+    CHECK(session.variables.at("answer").value == entity_t(42));
+    CHECK(session.variables.at("names").value.kind() == entity_t::LIST);
+
+    // A changed source makes the snapshot stale.
+    dir.write("init.ysh", "echo changed init\n");
+    CHECK(not restore_session(snapshot, sources));
+    CHECK(save_session(snapshot, sources) > 0);
+
+    // A Func written in a script is saved as its source, and compiled again.
+    assign(session.variables, "twice", abstraction("x", "x + x"));
+    CHECK(save_session(snapshot, sources) > 0);
+    session.variables.clear();
+    CHECK(restore_session(snapshot, sources));
+    CHECK(test::eval("twice $ 21") == entity_t(42));
+    session.variables.erase("twice");
+
+    // A Func of the host can't be saved, and neither can a session holding one: the snapshot goes, so
+    // that the sources run again, and define it again.
+    assign(session.variables, "twice", entity_t(func_t([](entity_t x) { return x + x; })));
+    CHECK(refused(snapshot, sources));
+    CHECK(not stdf::exists(snapshot));
+    CHECK(not restore_session(snapshot, sources));
+    session.variables.erase("twice");
+
+    // Nor one holding a Func within a List.
+    assign(session.variables, "funcs", entity_t(types::list_t { entity_t(func_t([](entity_t x) { return x; })) }));
+    CHECK(refused(snapshot, sources));
+    session.variables.erase("funcs");
+    CHECK(save_session(snapshot, sources) > 0);
+
+    // Nor one a command was registered in, other than by a plugin.
+    session.command_map.emplace("hello", [](std::vector<input_t> const&) { return 0; });
+    CHECK(refused(snapshot, sources));
+    CHECK(not stdf::exists(snapshot));
+
+    // The plugins are loaded again instead, so a snapshot is stale once one of them no longer loads.
+    session.plugins.push_back(dir.path() / "gone.so");
+    session.plugin_commands.insert("hello");
+    CHECK(save_session(snapshot, sources) > 0);
+    CHECK(not restore_session(snapshot, sources));
+    session.plugins.clear();
+    session.plugin_commands.clear();
+    session.command_map.erase("hello");
+
+    // A script that prints runs every time: the snapshot couldn't reproduce what it does.
+    auto const printing = dir.write("print.ysh", "echo (x <- 41)\necho (40 + 2)\n");
+    auto const first = run_with_snapshot(printing);
+    CHECK(first == "41\n42\n");
+    CHECK(run_with_snapshot(printing) == first);
+    CHECK(not stdf::exists(stdf::path(printing) += ".snapshot"));
+
+    // Names bound with let are the session's, for the lines after them too.
+    CHECK(run_with_snapshot(dir.write("bound.ysh", "let x (40 + 1)\necho (x + 1)\n")) == "42\n");
+
+    // A let applying a Func may do anything (say, write a file), so its script runs every time.
+    auto const applying = dir.write("apply.ysh", "let n (sum $ (1 .. 3))\n");
+    CHECK(run_with_snapshot(applying).empty());
+    CHECK(not stdf::exists(stdf::path(applying) += ".snapshot"));
+
+    // A script that does nothing but bind names is left alone once its snapshot is taken, and what it
+    // bound is restored from the snapshot instead.
+    auto const quiet = dir.write("quiet.ysh",
+                                 "# set up the session\n"
+                                 "let limit (60 * 60)\n"
+                                 "let greeting \"hello\"\n"
+                                 "let twice (\"x\" -> \"x + x\") # a Func\n"
+                                 "let quad (\"x\" -> \"twice $ (twice $ x)\")\n");
+    session.variables.clear();
+    CHECK(run_with_snapshot(quiet).empty());
+    CHECK(stdf::exists(stdf::path(quiet) += ".snapshot"));
+    CHECK(session.variables.size() == 4);
+    CHECK(test::eval("quad $ limit") == entity_t(14400));
+
+    // Were the script run, limit would be 3600 again.
+    assign(session.variables, "limit", entity_t(7));
+    CHECK(save_session(stdf::path(quiet) += ".snapshot", { quiet }) > 0);
+    session.variables.clear();
+    CHECK(run_with_snapshot(quiet).empty());
+    CHECK(session.variables.at("limit").value == entity_t(7));
+    CHECK(session.variables.at("greeting").value == entity_t("hello"));
+    CHECK(test::eval("quad $ limit") == entity_t(28));
+    CHECK(test::eval("twice $ greeting") == entity_t("hellohello"));
+    return test::result();
+}